@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Store.hpp"
+#include "memory_manager.hpp"
+
+using EntityStore::Entity;
+using EntityStore::EntityId;
+using EntityStore::Properties;
+using EntityStore::PropertyId;
+using EntityStore::Store;
+
+constexpr auto kNumberOfTitles{100};
+constexpr auto kNumberOfTimestamps{1000};
+
+Properties createProperties(const EntityId id) {
+  return Properties()
+      .set<PropertyId::Title>("Title " + std::to_string(id % kNumberOfTitles))
+      .set<PropertyId::Timestamp>(static_cast<double>(id % kNumberOfTimestamps));
+}
+
+EntityStore::RootStore createStore(const size_t numberOfEntities) {
+  EntityStore::RootStore store;
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    store.insert(id, createProperties(id));
+  }
+  return store;
+}
+
+// The same predicate object is used by both paths, the only difference is the type through which it is called: the
+// virtual path sees only the EntityPredicate base class, while the inlined path sees the concrete (final) type.
+template <typename TPredicate, bool kIsInlined>
+void filter(benchmark::State &state, const TPredicate &predicate) {
+  const auto store = createStore(static_cast<size_t>(state.range(0)));
+  for (auto _: state) {
+    if constexpr (kIsInlined) {
+      benchmark::DoNotOptimize(store.filterIdsInlined(predicate, nullptr));
+    } else {
+      benchmark::DoNotOptimize(store.filterIds(static_cast<const EntityStore::EntityPredicate &>(predicate), nullptr));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+template <bool kIsInlined>
+static void Query(benchmark::State &state) {
+  const std::string title{"Title 42"};
+  const EntityStore::SimpleQueryEntityPredicate<std::string, std::string> predicate(PropertyId::Title, title);
+  filter<decltype(predicate), kIsInlined>(state, predicate);
+}
+
+template <bool kIsInlined>
+static void RangeQuery(benchmark::State &state) {
+  const double minValue{100.0};
+  const double maxValue{110.0};
+  const EntityStore::RangeQueryEntityPredicate<double, double, double> predicate(PropertyId::Timestamp, minValue,
+                                                                                 maxValue);
+  filter<decltype(predicate), kIsInlined>(state, predicate);
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define BENCH(name)                                                                                                    \
+  BENCHMARK_TEMPLATE(name, false)->RangeMultiplier(100)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);       \
+  BENCHMARK_TEMPLATE(name, true)->RangeMultiplier(100)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond)
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH(Query);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH(RangeQuery);
+
+// The ids are random, so the lookups are spread all over the id index just like the accesses of a real application,
+// which doesn't know how the ids are laid out in the index. The entities have no properties, so the largest stores
+// still fit into the memory: 100M entities need roughly 10GB.
+template <typename TIdIndex>
+static void PointLookup(benchmark::State &state) {
+  constexpr size_t kNumberOfLookups{1'000'000};
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  std::mt19937_64 generator{42U}; // NOLINT(cert-msc32-c,cert-msc51-cpp)
+  std::vector<EntityId> ids(numberOfEntities);
+  std::generate(ids.begin(), ids.end(), generator);
+
+  EntityStore::BasicRootStore<TIdIndex> store;
+  for (const auto id: ids) {
+    store.insert(id, EntityStore::Properties());
+  }
+
+  std::vector<EntityId> idsToLookup(kNumberOfLookups);
+  std::uniform_int_distribution<size_t> indexDistribution{0U, numberOfEntities - 1U};
+  std::generate(idsToLookup.begin(), idsToLookup.end(), [&] { return ids[indexDistribution(generator)]; });
+  ids.clear();
+  ids.shrink_to_fit();
+
+  for (auto _: state) {
+    for (const auto id: idsToLookup) {
+      benchmark::DoNotOptimize(store.tryGet(id));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kNumberOfLookups));
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define BENCH_LOOKUP(idIndex)                                                                                          \
+  BENCHMARK_TEMPLATE(PointLookup, idIndex)                                                                             \
+      ->RangeMultiplier(10)                                                                                            \
+      ->Range(1'000'000, 100'000'000)                                                                                  \
+      ->Unit(benchmark::kMillisecond)
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_LOOKUP(EntityStore::FlatIdIndex);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_LOOKUP(EntityStore::NodeIdIndex);
+
+// The benchmarks below measure the operations through the public interface of Store. The entities are created before
+// the measured loops, so only the work of the store is measured. If the memory tracking is enabled (see
+// ENABLE_MEMORY_TRACKING_FOR_ENTITY_STORE), then the number of allocations and the peak memory usage of an iteration
+// are reported too.
+std::vector<Entity> createEntities(const size_t numberOfEntities) {
+  std::vector<Entity> entities;
+  entities.reserve(numberOfEntities);
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    entities.emplace_back(id, createProperties(id));
+  }
+  return entities;
+}
+
+Store createFilledStore(const std::vector<Entity> &entities) {
+  auto store = Store::create();
+  for (const auto &entity: entities) {
+    store.insert(entity.id(), entity.properties());
+  }
+  return store;
+}
+
+// The ids are shuffled, so the accesses are spread all over the store.
+std::vector<EntityId> createShuffledIds(const size_t numberOfEntities) {
+  std::vector<EntityId> ids(numberOfEntities);
+  std::iota(ids.begin(), ids.end(), EntityId{0});
+  std::shuffle(ids.begin(), ids.end(), std::mt19937_64{42U}); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+  return ids;
+}
+
+void setItemsProcessed(benchmark::State &state, const size_t itemsPerIteration) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * itemsPerIteration));
+}
+
+static void StoreInsert(benchmark::State &state) {
+  const auto entities = createEntities(static_cast<size_t>(state.range(0)));
+  for (auto _: state) {
+    auto store = createFilledStore(entities);
+    benchmark::DoNotOptimize(store.contains(0));
+  }
+  setItemsProcessed(state, entities.size());
+}
+
+// Every entity is inserted by its own batch, so if the batches reserved exactly the memory they need, then every batch
+// would reallocate the whole store.
+static void StoreSmallInsertBatches(benchmark::State &state) {
+  const auto entities = createEntities(static_cast<size_t>(state.range(0)));
+  for (auto _: state) {
+    auto store = Store::create();
+    for (const auto &entity: entities) {
+      store.insertBatch(std::span<const Entity>{&entity, 1U});
+    }
+    benchmark::DoNotOptimize(store.contains(0));
+  }
+  setItemsProcessed(state, entities.size());
+}
+
+static void StoreUpdate(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  auto store = createFilledStore(createEntities(numberOfEntities));
+  const auto ids = createShuffledIds(numberOfEntities);
+  const auto update = Properties().set<PropertyId::Timestamp>(42.0);
+  for (auto _: state) {
+    for (const auto id: ids) {
+      benchmark::DoNotOptimize(store.update(id, update));
+    }
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+static void StoreGet(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto store = createFilledStore(createEntities(numberOfEntities));
+  const auto ids = createShuffledIds(numberOfEntities);
+  for (auto _: state) {
+    for (const auto id: ids) {
+      benchmark::DoNotOptimize(&store.get(id));
+    }
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+static void StoreRemove(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto entities = createEntities(numberOfEntities);
+  const auto ids = createShuffledIds(numberOfEntities);
+  for (auto _: state) {
+    state.PauseTiming();
+    auto store = createFilledStore(entities);
+    state.ResumeTiming();
+    for (const auto id: ids) {
+      benchmark::DoNotOptimize(store.remove(id));
+    }
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+// Every second entity is removed before shrinking, so half of the store has to be moved.
+static void StoreShrink(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto entities = createEntities(numberOfEntities);
+  for (auto _: state) {
+    state.PauseTiming();
+    auto store = createFilledStore(entities);
+    for (EntityId id{0}; id < numberOfEntities; id += 2) {
+      store.remove(id);
+    }
+    state.ResumeTiming();
+    store.shrink();
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+static void StoreQuery(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto store = createFilledStore(createEntities(numberOfEntities));
+  const std::string title{"Title 42"};
+  for (auto _: state) {
+    benchmark::DoNotOptimize(store.query<PropertyId::Title>(title));
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+static void StoreRangeQuery(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto store = createFilledStore(createEntities(numberOfEntities));
+  for (auto _: state) {
+    benchmark::DoNotOptimize(store.rangeQuery<PropertyId::Timestamp>(100.0, 110.0));
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+// A child store updates or replaces 1% of the entities of its parent, then only the commit (if kIsCommitted is true) or
+// the rollback is measured.
+template <bool kIsCommitted>
+static void NestedFinish(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  const auto numberOfChanges = std::max(numberOfEntities / 100U, size_t{1U});
+  auto store = createFilledStore(createEntities(numberOfEntities));
+  const auto ids = createShuffledIds(numberOfEntities);
+  const auto update = Properties().set<PropertyId::Timestamp>(42.0);
+  for (auto _: state) {
+    state.PauseTiming();
+    auto child = store.createChild();
+    for (size_t index{0U}; index < numberOfChanges; ++index) {
+      const auto id = ids[index];
+      if (index % 2U == 0U) {
+        child.update(id, update);
+      } else {
+        child.remove(id);
+        child.insert(id, createProperties(id));
+      }
+    }
+    state.ResumeTiming();
+    if constexpr (kIsCommitted) {
+      child.commit();
+    } else {
+      child.rollback();
+    }
+  }
+  setItemsProcessed(state, numberOfChanges);
+}
+
+// Every entity is inserted by its own child store, e.g. a lot of small transactions. The commits must not reallocate the
+// whole store, otherwise it becomes quadratic.
+static void StoreSmallCommits(benchmark::State &state) {
+  const auto entities = createEntities(static_cast<size_t>(state.range(0)));
+  for (auto _: state) {
+    auto store = Store::create();
+    for (const auto &entity: entities) {
+      auto child = store.createChild();
+      child.insert(entity.id(), entity.properties());
+      child.commit();
+    }
+    benchmark::DoNotOptimize(store.contains(0));
+  }
+  setItemsProcessed(state, entities.size());
+}
+
+// Every level of the chain touches a few entities, then the point reads and the queries are measured through the
+// deepest level.
+Store &createChain(std::vector<Store> &chain, const size_t numberOfEntities, const size_t depth) {
+  constexpr size_t kTouchedEntitiesPerLevel{10U};
+  chain.push_back(createFilledStore(createEntities(numberOfEntities)));
+  const auto update = Properties().set<PropertyId::Timestamp>(42.0);
+  for (size_t level{0U}; level < depth; ++level) {
+    chain.push_back(chain.back().createChild());
+    for (size_t index{0U}; index < kTouchedEntitiesPerLevel; ++index) {
+      chain.back().update(static_cast<EntityId>((level * kTouchedEntitiesPerLevel + index) % numberOfEntities), update);
+    }
+  }
+  return chain.back();
+}
+
+static void DeeplyNestedGet(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  std::vector<Store> chain;
+  const auto &deepest = createChain(chain, numberOfEntities, static_cast<size_t>(state.range(1)));
+  const auto ids = createShuffledIds(numberOfEntities);
+  for (auto _: state) {
+    for (const auto id: ids) {
+      benchmark::DoNotOptimize(&deepest.get(id));
+    }
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+static void DeeplyNestedQuery(benchmark::State &state) {
+  const auto numberOfEntities = static_cast<size_t>(state.range(0));
+  std::vector<Store> chain;
+  const auto &deepest = createChain(chain, numberOfEntities, static_cast<size_t>(state.range(1)));
+  const std::string title{"Title 42"};
+  for (auto _: state) {
+    benchmark::DoNotOptimize(deepest.query<PropertyId::Title>(title));
+  }
+  setItemsProcessed(state, numberOfEntities);
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define BENCH_STORE(name) BENCHMARK(name)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMicrosecond)
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreInsert);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCHMARK(StoreSmallInsertBatches)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreUpdate);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreGet);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreRemove);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreShrink);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreQuery);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_STORE(StoreRangeQuery);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCHMARK_TEMPLATE(NestedFinish, true)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMicrosecond);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCHMARK_TEMPLATE(NestedFinish, false)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMicrosecond);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCHMARK(StoreSmallCommits)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define BENCH_NESTING(name)                                                                                            \
+  BENCHMARK(name)                                                                                                      \
+      ->ArgsProduct({benchmark::CreateRange(1'000, 10'000'000, 10), {1, 8, 64}})                                       \
+      ->ArgNames({"entities", "depth"})                                                                                \
+      ->Unit(benchmark::kMicrosecond)
+
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_NESTING(DeeplyNestedGet);
+// NOLINTNEXTLINE(cppcoreguidelines-owning-memory,cppcoreguidelines-avoid-non-const-global-variables)
+BENCH_NESTING(DeeplyNestedQuery);
+
+int main(int argc, char **argv) {
+  ::benchmark::RegisterMemoryManager(&getMemoryManager());
+  ::benchmark::Initialize(&argc, argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::RegisterMemoryManager(nullptr);
+}
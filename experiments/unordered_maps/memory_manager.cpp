@@ -1,5 +1,7 @@
 #include "memory_manager.hpp"
 
+#include <algorithm>
+#include <functional>
 #include <malloc.h>
 #include <new>
 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+
+namespace EntityStore {
+
+enum class ChangeType {
+  Inserted,
+  Updated,
+  Removed,
+};
+
+// For an insertion the mask contains the properties of the inserted entity, for an update the properties that were set
+// by the update (even if their values didn't change), and it is empty for a removal.
+struct ChangeEvent {
+  using PropertyMask = EntityStore::PropertyMask;
+
+  ChangeType type;
+  EntityId id;
+  PropertyMask changedProperties;
+
+  friend bool operator==(const ChangeEvent &lhs, const ChangeEvent &rhs) = default;
+};
+
+// A single-producer single-consumer ring buffer of change events without locks. The store publishes the events of a
+// modification (or of a whole commit of a child store) as a single batch, so a consumer never sees half of a batch,
+// unless it limits the number of drained events. The store never waits for the consumers: if a batch doesn't fit into
+// the buffer, then it is dropped and the subscription is marked as overflown, so the consumer knows it has to
+// resynchronize, e.g. by a full query.
+class ChangeSubscription {
+public:
+  // The capacity is rounded up to a power of two, so the positions can be wrapped by masking.
+  explicit ChangeSubscription(const size_t capacity);
+
+  ChangeSubscription(const ChangeSubscription &) = delete;
+  ChangeSubscription(ChangeSubscription &&) = delete;
+  ChangeSubscription &operator=(const ChangeSubscription &) = delete;
+  ChangeSubscription &operator=(ChangeSubscription &&) = delete;
+  ~ChangeSubscription() = default;
+
+  [[nodiscard]] size_t capacity() const;
+
+  // Called by the store. Returns false if the batch was dropped.
+  bool publish(std::span<const ChangeEvent> events);
+
+  // Called by the consumer. Appends at most maxEvents of the published events to the vector in the order they were
+  // published, and returns their number.
+  size_t drain(std::vector<ChangeEvent> &events, const size_t maxEvents = std::numeric_limits<size_t>::max());
+  // Returns true if any batch was dropped since the last call.
+  [[nodiscard]] bool checkAndClearOverflow();
+
+private:
+  // The producer and the consumer write different cache lines, so they don't invalidate each other's cache line on
+  // every batch.
+  static constexpr size_t kCacheLineSize{64U};
+
+  std::vector<ChangeEvent> m_events;
+  size_t m_positionMask;
+  alignas(kCacheLineSize) std::atomic<size_t> m_writePosition{0U};
+  alignas(kCacheLineSize) std::atomic<size_t> m_readPosition{0U};
+  std::atomic<bool> m_isOverflown{false};
+};
+
+} // namespace EntityStore
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+
+namespace EntityStore {
+
+// The result of the queries. The ids are stored in a sorted vector without duplicates, so:
+//  * it needs only one allocation instead of one node per id as a hash set would,
+//  * the set operations (intersection, union, difference) are linear merges of the two vectors,
+//  * the lookup of a single id is a binary search, which is O(log n) instead of the O(1) of a hash set. As the results
+//  are usually iterated or combined instead of searched, this is a good tradeoff.
+class EntityIdSet {
+public:
+  using ConstIterator = std::vector<EntityId>::const_iterator;
+  // To make it usable with the standard algorithms and range based for loops
+  using value_type = EntityId;
+  using const_iterator = ConstIterator;
+
+  EntityIdSet() = default;
+  EntityIdSet(std::initializer_list<EntityId> ids);
+  EntityIdSet(const EntityIdSet &) = default;
+  EntityIdSet(EntityIdSet &&) = default;
+  EntityIdSet &operator=(const EntityIdSet &) = default;
+  EntityIdSet &operator=(EntityIdSet &&) = default;
+  ~EntityIdSet() = default;
+
+  // Sorts the ids and removes the duplicates.
+  [[nodiscard]] static EntityIdSet fromUnsorted(std::vector<EntityId> ids);
+  // The ids must be sorted in ascending order without duplicates, it is checked only by an assert.
+  [[nodiscard]] static EntityIdSet fromSorted(std::vector<EntityId> ids);
+
+  [[nodiscard]] size_t size() const;
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] ConstIterator begin() const;
+  [[nodiscard]] ConstIterator end() const;
+
+  // Returns 1 if the set contains the id, 0 otherwise, the same as std::unordered_set::count does.
+  [[nodiscard]] size_t count(const EntityId id) const;
+  [[nodiscard]] bool contains(const EntityId id) const;
+
+  [[nodiscard]] const std::vector<EntityId> &ids() const &;
+  [[nodiscard]] std::vector<EntityId> &&ids() &&;
+
+  EntityIdSet &operator&=(const EntityIdSet &other);
+  EntityIdSet &operator|=(const EntityIdSet &other);
+  EntityIdSet &operator-=(const EntityIdSet &other);
+
+  friend EntityIdSet operator&(const EntityIdSet &lhs, const EntityIdSet &rhs);
+  friend EntityIdSet operator|(const EntityIdSet &lhs, const EntityIdSet &rhs);
+  friend EntityIdSet operator-(const EntityIdSet &lhs, const EntityIdSet &rhs);
+
+  friend bool operator==(const EntityIdSet &lhs, const EntityIdSet &rhs) = default;
+
+private:
+  explicit EntityIdSet(std::vector<EntityId> &&sortedIds);
+
+  std::vector<EntityId> m_ids;
+};
+
+} // namespace EntityStore
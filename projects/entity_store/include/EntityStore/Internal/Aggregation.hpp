@@ -0,0 +1,478 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+
+namespace EntityStore {
+
+// The aggregators fold the matching entities into a single result inside the scan loops of the stores, so the
+// aggregations don't have to collect the ids of the matching entities and look them up again. The stores start from a
+// copy of an empty aggregator for every part they scan separately (e.g. the chunks of a parallel scan, or the levels of
+// a nested store), and merge the partial results at the end.
+template <typename TAggregator>
+concept EntityAggregator = std::copyable<TAggregator> &&
+    requires(TAggregator &aggregator, const TAggregator &other, const EntityId id, const Properties &properties) {
+  aggregator.add(id, properties);
+  aggregator.merge(other);
+};
+
+// Most of the aggregators are interested only in the values of a single property, they can be used as an
+// EntityAggregator through PropertyAggregator.
+template <typename TAggregator, typename TValue>
+concept AggregatorOf =
+    std::copyable<TAggregator> && requires(TAggregator &aggregator, const TAggregator &other, const TValue &value) {
+      aggregator.add(value);
+      aggregator.merge(other);
+    };
+
+// The entities that don't have the property are skipped.
+template <PropertyId Id, AggregatorOf<PropertyValueType<Id>> TAggregator>
+class PropertyAggregator {
+public:
+  explicit PropertyAggregator(TAggregator aggregator)
+    : m_aggregator{std::move(aggregator)} {
+  }
+
+  void add(const EntityId /*id*/, const Properties &properties) {
+    const auto *valuePtr = properties.template tryGet<Id>();
+    if (valuePtr != nullptr) {
+      m_aggregator.add(*valuePtr);
+    }
+  }
+
+  void merge(const PropertyAggregator &other) {
+    m_aggregator.merge(other.m_aggregator);
+  }
+
+  [[nodiscard]] const TAggregator &valueAggregator() const & {
+    return m_aggregator;
+  }
+
+  [[nodiscard]] TAggregator valueAggregator() && {
+    return std::move(m_aggregator);
+  }
+
+private:
+  TAggregator m_aggregator;
+};
+
+template <typename TValue>
+class CountAggregator {
+public:
+  void add(const TValue & /*value*/) {
+    ++m_count;
+  }
+
+  void merge(const CountAggregator &other) {
+    m_count += other.m_count;
+  }
+
+  [[nodiscard]] size_t result() const {
+    return m_count;
+  }
+
+private:
+  size_t m_count{0U};
+};
+
+// Keeps the value for which the comparator returns true against every other value, i.e. std::less gives the minimum.
+template <typename TValue, typename TComparator>
+class ExtremumAggregator {
+public:
+  void add(const TValue &value) {
+    if (!m_extremum.has_value() || TComparator{}(value, *m_extremum)) {
+      m_extremum = value;
+    }
+  }
+
+  void merge(const ExtremumAggregator &other) {
+    if (other.m_extremum.has_value()) {
+      add(*other.m_extremum);
+    }
+  }
+
+  [[nodiscard]] const std::optional<TValue> &result() const & {
+    return m_extremum;
+  }
+
+  [[nodiscard]] std::optional<TValue> result() && {
+    return std::move(m_extremum);
+  }
+
+private:
+  std::optional<TValue> m_extremum;
+};
+
+template <typename TValue>
+using MinAggregator = ExtremumAggregator<TValue, std::less<>>;
+template <typename TValue>
+using MaxAggregator = ExtremumAggregator<TValue, std::greater<>>;
+
+template <typename TValue>
+class SumAggregator {
+public:
+  static_assert(std::is_arithmetic_v<TValue>, "Only arithmetic values can be summed");
+
+  void add(const TValue &value) {
+    m_sum += value;
+  }
+
+  void merge(const SumAggregator &other) {
+    m_sum += other.m_sum;
+  }
+
+  [[nodiscard]] TValue result() const {
+    return m_sum;
+  }
+
+private:
+  TValue m_sum{};
+};
+
+// Counts the values in the [bounds[i], bounds[i + 1]) buckets, the values outside of [bounds.front(), bounds.back())
+// are not counted. The bounds must be strictly increasing.
+template <typename TValue>
+class HistogramAggregator {
+public:
+  explicit HistogramAggregator(std::vector<TValue> bounds)
+    : m_bounds{std::move(bounds)}
+    , m_counts(m_bounds.empty() ? 0U : m_bounds.size() - 1U, 0U) {
+  }
+
+  void add(const TValue &value) {
+    const auto it = std::upper_bound(m_bounds.begin(), m_bounds.end(), value);
+    if (it == m_bounds.begin() || it == m_bounds.end()) {
+      return;
+    }
+    ++m_counts[static_cast<size_t>(std::distance(m_bounds.begin(), it)) - 1U];
+  }
+
+  void merge(const HistogramAggregator &other) {
+    for (size_t index{0U}; index < m_counts.size(); ++index) {
+      m_counts[index] += other.m_counts[index];
+    }
+  }
+
+  [[nodiscard]] const std::vector<size_t> &result() const & {
+    return m_counts;
+  }
+
+  [[nodiscard]] std::vector<size_t> result() && {
+    return std::move(m_counts);
+  }
+
+private:
+  std::vector<TValue> m_bounds;
+  std::vector<size_t> m_counts;
+};
+
+// Collects the (id, value) pairs of the entities that have the property, so only the value of the property is copied
+// instead of the whole properties of the entities. The parts are scanned in arbitrary order, so the pairs are sorted by
+// the id only in the result.
+template <PropertyId Id>
+class ProjectionAggregator {
+public:
+  using Pair = std::pair<EntityId, PropertyValueType<Id>>;
+
+  void add(const EntityId id, const Properties &properties) {
+    const auto *valuePtr = properties.template tryGet<Id>();
+    if (valuePtr != nullptr) {
+      m_pairs.emplace_back(id, *valuePtr);
+    }
+  }
+
+  void merge(const ProjectionAggregator &other) {
+    m_pairs.insert(m_pairs.end(), other.m_pairs.begin(), other.m_pairs.end());
+  }
+
+  [[nodiscard]] std::vector<Pair> result() && {
+    std::sort(m_pairs.begin(), m_pairs.end(),
+              [](const Pair &lhs, const Pair &rhs) { return lhs.first < rhs.first; });
+    return std::move(m_pairs);
+  }
+
+private:
+  std::vector<Pair> m_pairs;
+};
+
+// The aggregators that need only the first few entities in the order of a property can be fed by walking an ordered
+// index of the property from indexStart, so the store can stop as soon as the aggregator is full instead of scanning
+// every entity.
+template <typename TAggregator>
+concept IndexOrderedAggregator = EntityAggregator<TAggregator> && requires(const TAggregator &aggregator) {
+  { aggregator.orderPropertyId() } -> std::same_as<PropertyId>;
+  { aggregator.order() } -> std::same_as<SortOrder>;
+  { aggregator.indexStart() } -> std::same_as<std::optional<std::pair<Property, EntityId>>>;
+  { aggregator.isFull() } -> std::same_as<bool>;
+};
+
+// Keeps the first limit keys in the specified order that come after the start key (if there is any) in a bounded heap,
+// so finding the top-K of N entities is O(N log K) and needs only O(K) memory. The keys are tuples that end with the id
+// of the entity, so they are unique and the entities with equal values are ordered by their id.
+template <typename TKey>
+class TopKAggregator {
+public:
+  using Key = TKey;
+
+  TopKAggregator(const size_t limit, const SortOrder order)
+    : m_limit{limit}
+    , m_order{order} {
+  }
+
+  void merge(const TopKAggregator &other) {
+    for (const auto &key: other.m_keys) {
+      if (isCandidate(key)) {
+        push(key);
+      }
+    }
+  }
+
+  // Only the keys that come after the specified one are kept, so the next page of a query can be found by starting
+  // after the last key of the previous page.
+  void startAfter(TKey key) {
+    m_start = std::move(key);
+  }
+
+  [[nodiscard]] SortOrder order() const {
+    return m_order;
+  }
+
+  [[nodiscard]] size_t limit() const {
+    return m_limit;
+  }
+
+  [[nodiscard]] bool isFull() const {
+    return m_keys.size() >= m_limit;
+  }
+
+  // Returns the kept keys in the requested order.
+  [[nodiscard]] std::vector<TKey> result() && {
+    std::sort_heap(m_keys.begin(), m_keys.end(), makeComparator());
+    return std::move(m_keys);
+  }
+
+  [[nodiscard]] std::vector<EntityId> ids() && {
+    const auto keys = std::move(*this).result();
+    std::vector<EntityId> result;
+    result.reserve(keys.size());
+    std::transform(keys.begin(), keys.end(), std::back_inserter(result), &TopKAggregator::idOf);
+    return result;
+  }
+
+  [[nodiscard]] static EntityId idOf(const TKey &key) {
+    return std::get<std::tuple_size_v<TKey> - 1U>(key);
+  }
+
+protected:
+  // The key view can be a tuple of references, so the key has to be constructed only if it is kept.
+  template <typename TKeyView>
+  [[nodiscard]] bool isCandidate(const TKeyView &key) const {
+    if (m_limit == 0U || (m_start.has_value() && !precedes(*m_start, key))) {
+      return false;
+    }
+    return !isFull() || precedes(key, m_keys.front());
+  }
+
+  // The heap is ordered by the comparator, so the last kept key is always on the top of it.
+  void push(TKey key) {
+    const auto comparator = makeComparator();
+    if (isFull()) {
+      std::pop_heap(m_keys.begin(), m_keys.end(), comparator);
+      m_keys.back() = std::move(key);
+    } else {
+      m_keys.push_back(std::move(key));
+    }
+    std::push_heap(m_keys.begin(), m_keys.end(), comparator);
+  }
+
+  [[nodiscard]] const std::optional<TKey> &start() const {
+    return m_start;
+  }
+
+private:
+  template <typename TLhs, typename TRhs>
+  [[nodiscard]] bool precedes(const TLhs &lhs, const TRhs &rhs) const {
+    return m_order == SortOrder::Ascending ? lhs < rhs : rhs < lhs;
+  }
+
+  [[nodiscard]] auto makeComparator() const {
+    return [this](const TKey &lhs, const TKey &rhs) { return precedes(lhs, rhs); };
+  }
+
+  size_t m_limit;
+  SortOrder m_order;
+  std::optional<TKey> m_start;
+  std::vector<TKey> m_keys;
+};
+
+// Orders the entities by their ids.
+class OrderByIdAggregator : public TopKAggregator<std::tuple<EntityId>> {
+public:
+  using TopKAggregator::TopKAggregator;
+
+  void add(const EntityId id, const Properties & /*properties*/) {
+    if (isCandidate(std::tuple<EntityId>{id})) {
+      push(std::tuple<EntityId>{id});
+    }
+  }
+};
+
+// Orders the entities by the value of the property, the entities that don't have the property are skipped.
+template <PropertyId Id>
+class OrderByAggregator : public TopKAggregator<std::tuple<PropertyValueType<Id>, EntityId>> {
+public:
+  static_assert(!std::is_pointer_v<PropertyValueType<Id>>, "The pointers cannot be compared meaningfully");
+
+  using Base = TopKAggregator<std::tuple<PropertyValueType<Id>, EntityId>>;
+  using Base::Base;
+
+  void add(const EntityId id, const Properties &properties) {
+    const auto *valuePtr = properties.template tryGet<Id>();
+    if (valuePtr != nullptr && this->isCandidate(std::tie(*valuePtr, id))) {
+      this->push(typename Base::Key{*valuePtr, id});
+    }
+  }
+
+  [[nodiscard]] PropertyId orderPropertyId() const {
+    return Id;
+  }
+
+  [[nodiscard]] std::optional<std::pair<Property, EntityId>> indexStart() const {
+    if (!this->start().has_value()) {
+      return std::nullopt;
+    }
+    const auto &[value, id] = *this->start();
+    return std::pair{Property{std::in_place_type<PropertyValueType<Id>>, value}, id};
+  }
+};
+
+// The aggregators that the public functions of Store can use for a property. The pointers cannot be compared
+// meaningfully, so they cannot be ordered, and only the arithmetic values can be summed.
+template <PropertyId Id, typename TValue = PropertyValueType<Id>>
+struct StoreAggregatorsOf {
+  using type = std::tuple<PropertyAggregator<Id, CountAggregator<TValue>>, ProjectionAggregator<Id>,
+                          PropertyAggregator<Id, MinAggregator<TValue>>, PropertyAggregator<Id, MaxAggregator<TValue>>,
+                          PropertyAggregator<Id, HistogramAggregator<TValue>>, OrderByAggregator<Id>>;
+};
+
+template <PropertyId Id, typename TValue>
+requires std::is_arithmetic_v<TValue>
+struct StoreAggregatorsOf<Id, TValue> {
+  using type = std::tuple<PropertyAggregator<Id, CountAggregator<TValue>>, ProjectionAggregator<Id>,
+                          PropertyAggregator<Id, MinAggregator<TValue>>, PropertyAggregator<Id, MaxAggregator<TValue>>,
+                          PropertyAggregator<Id, HistogramAggregator<TValue>>, OrderByAggregator<Id>,
+                          PropertyAggregator<Id, SumAggregator<TValue>>>;
+};
+
+template <PropertyId Id, typename TValue>
+requires std::is_pointer_v<TValue>
+struct StoreAggregatorsOf<Id, TValue> {
+  using type = std::tuple<PropertyAggregator<Id, CountAggregator<TValue>>, ProjectionAggregator<Id>>;
+};
+
+template <typename TVariant, typename... TAggregatorLists>
+struct JoinAggregators {
+  using type = TVariant;
+};
+
+template <typename... TAlternatives, typename... TAggregators, typename... TAggregatorLists>
+struct JoinAggregators<std::variant<TAlternatives...>, std::tuple<TAggregators...>, TAggregatorLists...>
+  : JoinAggregators<std::variant<TAlternatives..., TAggregators...>, TAggregatorLists...> {};
+
+template <size_t... Indices>
+auto makeStoreAggregator(std::index_sequence<Indices...>) ->
+    typename JoinAggregators<std::variant<OrderByIdAggregator>,
+                             typename StoreAggregatorsOf<static_cast<PropertyId>(Indices)>::type...>::type;
+
+// Every aggregator that the public functions of Store can use. It is generated from the properties, so the scans can be
+// compiled for each of them in the source files of the stores without listing the properties there.
+using StoreAggregator = decltype(makeStoreAggregator(std::make_index_sequence<asUnderlying(PropertyId::LAST) + 1>{}));
+
+// Type erases an aggregator, so the stores without inlined aggregate functions can be aggregated through the virtual
+// IStore::aggregate. There is a virtual call per matching entity, but the matching entities are visited in the same
+// pass as the predicate is evaluated, so the store can keep them unchanged until the aggregation is finished.
+class AnyAggregator {
+public:
+  template <EntityAggregator TAggregator>
+  requires(!std::same_as<TAggregator, AnyAggregator>)
+  explicit AnyAggregator(TAggregator aggregator)
+    : m_aggregator{std::make_unique<Model<TAggregator>>(std::move(aggregator))} {
+  }
+
+  AnyAggregator(const AnyAggregator &other)
+    : m_aggregator{other.m_aggregator->clone()} {
+  }
+
+  AnyAggregator(AnyAggregator &&) noexcept = default;
+
+  AnyAggregator &operator=(const AnyAggregator &other) {
+    if (this != &other) {
+      m_aggregator = other.m_aggregator->clone();
+    }
+    return *this;
+  }
+
+  AnyAggregator &operator=(AnyAggregator &&) noexcept = default;
+  ~AnyAggregator() = default;
+
+  void add(const EntityId id, const Properties &properties) {
+    m_aggregator->add(id, properties);
+  }
+
+  // The other aggregator must wrap the same type of aggregator.
+  void merge(const AnyAggregator &other) {
+    m_aggregator->merge(*other.m_aggregator);
+  }
+
+  template <EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator get() && {
+    return std::move(static_cast<Model<TAggregator> &>(*m_aggregator).aggregator);
+  }
+
+private:
+  struct Concept { // NOLINT(cppcoreguidelines-special-member-functions)
+    virtual ~Concept() = default;
+    virtual void add(const EntityId id, const Properties &properties) = 0;
+    virtual void merge(const Concept &other) = 0;
+    [[nodiscard]] virtual std::unique_ptr<Concept> clone() const = 0;
+  };
+
+  template <EntityAggregator TAggregator>
+  struct Model final : Concept {
+    explicit Model(TAggregator &&aggregatorToWrap)
+      : aggregator{std::move(aggregatorToWrap)} {
+    }
+
+    void add(const EntityId id, const Properties &properties) override {
+      aggregator.add(id, properties);
+    }
+
+    void merge(const Concept &other) override {
+      aggregator.merge(static_cast<const Model &>(other).aggregator);
+    }
+
+    [[nodiscard]] std::unique_ptr<Concept> clone() const override {
+      return std::make_unique<Model>(TAggregator{aggregator});
+    }
+
+    TAggregator aggregator;
+  };
+
+  std::unique_ptr<Concept> m_aggregator;
+};
+
+} // namespace EntityStore
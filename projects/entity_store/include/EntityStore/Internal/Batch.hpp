@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "utils/containers/DynamicBitset.hpp"
+
+namespace EntityStore {
+
+// The result of a batch operation: the bit at the position of an item is set if the operation was successful on it,
+// e.g. the entity was inserted, because the store didn't contain it before.
+using BatchResult = utils::containers::DynamicBitset;
+
+// The batch operations take a span of either mutable or const entities: the properties of the mutable ones can be moved
+// into the store, while the const ones have to be copied.
+template <typename TEntity>
+decltype(auto) forwardProperties(TEntity &entity) {
+  if constexpr (std::is_const_v<TEntity>) {
+    return entity.properties();
+  } else {
+    return std::move(entity).properties();
+  }
+}
+
+// The batches reserve the memory for all of their items up front, but reserving exactly the required size would defeat
+// the geometric growth of the containers: a series of small batches would reallocate the whole container for every
+// batch. Therefore the capacity is at least doubled whenever it has to grow.
+template <typename TVector>
+void reserveGeometrically(TVector &vector, const size_t requiredCapacity) {
+  if (requiredCapacity > vector.capacity()) {
+    vector.reserve(std::max(requiredCapacity, 2U * vector.capacity()));
+  }
+}
+
+template <typename TMap>
+void reserveMapGeometrically(TMap &map, const size_t requiredSize) {
+  if constexpr (requires { map.bucket_count(); }) {
+    // The standard maps rehash on every reserve that changes their number of buckets, it might even shrink them.
+    if (static_cast<float>(requiredSize) <= static_cast<float>(map.bucket_count()) * map.max_load_factor()) {
+      return;
+    }
+    map.reserve(std::max(requiredSize, 2U * map.size()));
+  } else {
+    // The flat map of robin_hood grows by powers of two and reserve never shrinks it.
+    map.reserve(requiredSize);
+  }
+}
+
+template <typename TItems, typename TFunc>
+BatchResult processBatch(TItems &items, TFunc &&func) {
+  BatchResult result(items.size());
+  for (size_t index{0U}; index < items.size(); ++index) {
+    if (func(items[index])) {
+      result.set(index);
+    }
+  }
+  return result;
+}
+
+} // namespace EntityStore
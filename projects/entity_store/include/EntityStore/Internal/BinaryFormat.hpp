@@ -0,0 +1,107 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+#include "EntityStore/StoreExceptions.hpp"
+#include "utils/Assert.hpp"
+
+namespace EntityStore {
+
+// The persisted files (snapshots, write-ahead logs) store the values in their in-memory representation, so they can be
+// written and read by a simple memcpy. This is only portable between little endian machines, which covers every
+// platform this project is built for.
+static_assert(std::endian::native == std::endian::little, "The binary format assumes little endian byte order");
+
+class BinaryWriter {
+public:
+  template <typename T>
+  void write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be written directly");
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  // Overwrites an already written value, e.g. to fill a header after its content is written.
+  template <typename T>
+  void writeAt(const size_t offset, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be written directly");
+    MY_ASSERT(offset + sizeof(T) <= m_buffer.size(), "The value has to be written before it can be overwritten");
+    std::memcpy(m_buffer.data() + offset, &value, sizeof(T));
+  }
+
+  // The strings are prefixed by their length as a 32-bit value, because longer strings are not expected as properties.
+  void writeString(const std::string_view value);
+
+  [[nodiscard]] std::span<const std::byte> bytes() const;
+  [[nodiscard]] size_t size() const;
+  void clear();
+  // Drops the bytes that were written after the first size bytes.
+  void truncate(const size_t size);
+
+private:
+  std::vector<std::byte> m_buffer;
+};
+
+// Reads the values written by BinaryWriter. Every read is checked, so a truncated or corrupted file results in an
+// InvalidPersistedDataException instead of reading out of bounds.
+class BinaryReader {
+public:
+  explicit BinaryReader(std::span<const std::byte> bytes);
+
+  template <typename T>
+  [[nodiscard]] T read() {
+    static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be read directly");
+    T value;
+    std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  // The returned view points into the read bytes, so it is valid as long as they are.
+  [[nodiscard]] std::string_view readString();
+  // NaN cannot be set as the value of a property, so it can only be read from corrupted data.
+  [[nodiscard]] double readDoubleProperty();
+
+  [[nodiscard]] bool atEnd() const;
+  [[nodiscard]] size_t position() const;
+  [[nodiscard]] size_t remainingSize() const;
+
+private:
+  [[nodiscard]] std::span<const std::byte> take(const size_t size);
+
+  std::span<const std::byte> m_bytes;
+  size_t m_position{0U};
+};
+
+// The present properties of an entity are persisted as a mask where the bit of the property id is set, followed by the
+// values of the present properties in the order of their ids.
+using SerializedPropertyMask = uint32_t;
+static_assert(asUnderlying(PropertyId::LAST) < std::numeric_limits<SerializedPropertyMask>::digits,
+              "The properties don't fit into the property mask");
+
+template <typename TFunc>
+void forEachPresentProperty(const Properties &properties, TFunc &&func) {
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    const auto propertyId = static_cast<PropertyId>(propertyIndex);
+    if (properties.hasProperty(propertyId)) {
+      properties.visit(propertyId, [&func, propertyId](const auto &value) { func(propertyId, value); });
+    }
+  }
+}
+
+[[nodiscard]] SerializedPropertyMask serializePropertyMask(const PropertyMask &mask);
+// Throws InvalidPersistedDataException if the mask contains unknown properties.
+[[nodiscard]] PropertyMask deserializePropertyMask(const SerializedPropertyMask mask);
+
+} // namespace EntityStore
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+
+namespace EntityStore {
+
+class IStore;
+
+// The changes of a child store that are committed into its parent at once. The removals are applied first, then the
+// updates and the insertions. An entity that was removed and inserted again by the child is in both removed and
+// inserted, so this order gives the same result as applying the changes entity by entity.
+struct ChangeSet {
+  std::vector<EntityId> removed;
+  std::vector<Entity> updated;
+  std::vector<Entity> inserted;
+
+  [[nodiscard]] bool empty() const;
+};
+
+// Applies the changes by the batch operations of the store. Throws std::logic_error if any of the changes cannot be
+// applied, e.g. an updated entity doesn't exist in the store.
+void applyChangesByBatches(IStore &store, ChangeSet &&changes);
+
+} // namespace EntityStore
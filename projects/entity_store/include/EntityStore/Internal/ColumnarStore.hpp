@@ -0,0 +1,137 @@
+#pragma once
+
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
+#include "EntityStore/Internal/StringDictionary.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+#include "utils/containers/DynamicBitset.hpp"
+
+namespace EntityStore {
+
+// An IStore implementation that stores the entities in a structure-of-arrays layout: every property has its own column
+// which is a contiguous array of the property's type and a bitmap that tells which entities have the property. The
+// entities are identified by their slot, which is the same index in every column.
+//
+// This makes the queries that can be described by an IndexLookup a tight linear scan over a single column, but makes
+// the access to the whole Properties of an entity more expensive, because it has to be assembled from the columns. To
+// be able to return a pointer as the IStore interface requires, the Properties assembled by the point reads are cached
+// until the entity is removed, and they are refreshed by the updates. The queries and aggregations assemble the
+// Properties without caching them. Therefore this store is worth to use when the queries are more frequent than the
+// point reads.
+//
+// The string columns are dictionary encoded: every distinct string is stored once, and the column contains only their
+// codes. It saves a lot of memory for the properties with a few distinct values (e.g. titles), and makes the equality
+// lookups a scan over integers.
+class ColumnarStore : public IStore {
+public:
+  ColumnarStore() = default;
+  ColumnarStore(const ColumnarStore &) = delete;
+  ColumnarStore(ColumnarStore &&) = delete;
+  ColumnarStore &operator=(const ColumnarStore &) = delete;
+  ColumnarStore &operator=(ColumnarStore &&) = delete;
+  ~ColumnarStore() override = default;
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  // The column scans are cheap enough, so they are always evaluated on the calling thread.
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  // The columns make the scans fast enough, so secondary indices are not supported.
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+private:
+  struct NoDictionary {};
+
+  template <PropertyId Id>
+  struct Column {
+    static constexpr PropertyId propertyId = Id;
+    using ValueType = PropertyValueType<Id>;
+    static constexpr bool kIsDictionaryEncoded = std::is_same_v<ValueType, std::string>;
+    using StoredType = std::conditional_t<kIsDictionaryEncoded, StringDictionary::Code, ValueType>;
+
+    // The dictionary encoded columns store the codes of the values, the other ones the values themselves.
+    std::vector<StoredType> values;
+    utils::containers::DynamicBitset hasValue;
+    [[no_unique_address]] std::conditional_t<kIsDictionaryEncoded, StringDictionary, NoDictionary> dictionary;
+    // Set when a string of a dictionary encoded column is overwritten or removed, so the dictionary might contain
+    // strings that are not used by any entity. Only shrink drops them, and only if this is set.
+    // It has no default member initializer, because then the defaulted constructor of the store would need it before
+    // the store is complete. The tuple of the columns value-initializes it to false instead.
+    bool mightHaveUnusedStrings;
+  };
+
+  template <size_t... Indices>
+  static std::tuple<Column<static_cast<PropertyId>(Indices)>...> makeColumns(std::index_sequence<Indices...>);
+
+  using Columns = decltype(makeColumns(std::make_index_sequence<asUnderlying(PropertyId::LAST) + 1>{}));
+
+  [[nodiscard]] std::optional<size_t> tryGetSlot(const EntityId id) const;
+  // Calls the function with the slots whose value matches the lookup. Returns false if the lookup cannot be served by
+  // the columns, because the type of its bounds doesn't match the type of the property.
+  template <typename TFunc>
+  bool forEachCandidateSlot(const IndexLookup &lookup, TFunc &&func) const;
+  void reserve(const size_t numberOfSlots);
+  size_t allocateSlot(const EntityId id);
+  void moveSlot(const size_t oldSlot, const size_t newSlot);
+  void removeLastSlot();
+  void writeProperties(const size_t slot, const Properties &properties);
+  [[nodiscard]] Properties assembleProperties(const size_t slot) const;
+  [[nodiscard]] const Properties &getCachedProperties(const size_t slot) const;
+
+  std::vector<EntityId> m_ids;
+  utils::containers::DynamicBitset m_usedSlots;
+  std::vector<size_t> m_emptySlots;
+  std::unordered_map<EntityId, size_t> m_slotById;
+  Columns m_columns{};
+  // Only the point reads fill it, under the exclusive lock of the mutex, see getCachedProperties.
+  mutable std::shared_mutex m_cacheMutex;
+  mutable std::vector<std::optional<Properties>> m_cachedProperties;
+};
+
+} // namespace EntityStore
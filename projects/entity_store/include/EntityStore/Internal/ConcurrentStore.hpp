@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Properties.hpp"
+
+namespace EntityStore {
+
+class ConcurrentStoreSnapshot;
+
+// A store that can be read by many threads while a single writer modifies it. It is based on the Left-Right technique:
+// there are two instances of the entities, one of them is visible to the readers, while the writer modifies the other
+// one. On commit the two instances swap their roles, then the writer waits until the readers leave the previously
+// visible instance and applies the same modifications on it. The readers never wait for the writer, they only
+// increment and decrement a counter, so they scale with the number of cores. In return the memory usage is doubled and
+// every modification is applied twice.
+//
+// The IStore functions belong to the writer, so they see the uncommitted modifications and they must not be called
+// concurrently with each other. The readers see the committed state through the snapshots.
+class ConcurrentStore final : public IStore {
+public:
+  ConcurrentStore() = default;
+  ConcurrentStore(const ConcurrentStore &) = delete;
+  ConcurrentStore(ConcurrentStore &&) = delete;
+  ConcurrentStore &operator=(const ConcurrentStore &) = delete;
+  ConcurrentStore &operator=(ConcurrentStore &&) = delete;
+  ~ConcurrentStore() override = default;
+
+  // Can be called from any thread at any time. The snapshot sees the state of the last commit until it is destroyed, so
+  // it has to be short lived: the next commit waits until the readers of the previous state are gone.
+  [[nodiscard]] std::unique_ptr<ConcurrentStoreSnapshot> createSnapshot() const;
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  // The returned pointer is valid until the next commit.
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  // Makes the modifications visible to the new snapshots. It waits for the snapshots of the previously committed state,
+  // so the committing thread must not hold such a snapshot, otherwise std::logic_error is thrown instead of waiting
+  // forever. The snapshots that were created by other threads are not detected, even if they were passed to the
+  // committing thread.
+  void commit() override;
+  // Throws away the uncommitted modifications by copying the visible instance, so it is expensive.
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+private:
+  friend class ConcurrentStoreSnapshot;
+
+  // The modifications are recorded, so they can be applied on the other instance after the commit.
+  struct Operation {
+    enum class Kind {
+      Insert,
+      Update,
+      Remove,
+      CreateIndex,
+      DropIndex,
+      Shrink,
+      Compact,
+    };
+
+    Kind kind;
+    EntityId id{0};
+    Properties properties{};
+    PropertyId propertyId{PropertyId::LAST};
+    IndexType indexType{IndexType::Hash};
+    size_t maxMovedEntities{0U};
+    bool isCompacted{false};
+  };
+
+  // The instances that are pinned by the snapshots that were created by a thread, so a commit can detect that it would
+  // wait for a snapshot of its own thread. A snapshot can be destroyed by another thread, or even after its thread
+  // exited, so the pins are shared by the thread and its snapshots.
+  struct ThreadPins {
+    std::mutex mutex;
+    std::vector<std::pair<const ConcurrentStore *, size_t>> pinnedInstances;
+  };
+
+  [[nodiscard]] RootStore &writableInstance();
+  [[nodiscard]] const RootStore &writableInstance() const;
+  [[nodiscard]] size_t pinVisibleInstance() const;
+  void unpinInstance(const size_t instanceIndex) const;
+  [[nodiscard]] static const std::shared_ptr<ThreadPins> &pinsOfThisThread();
+  [[nodiscard]] bool isPinnedByThisThread(const size_t instanceIndex) const;
+  static void applyOperation(RootStore &store, Operation &&operation);
+
+  std::array<RootStore, 2> m_instances;
+  std::atomic<size_t> m_visibleInstanceIndex{0U};
+  // The number of the readers of the instances. Every reader increments the counter of the instance it reads, so they
+  // share a cache line, but it is much cheaper than any kind of lock.
+  mutable std::array<std::atomic<size_t>, 2> m_numberOfReaders{};
+  std::vector<Operation> m_uncommittedOperations;
+};
+
+// The committed state of a ConcurrentStore for reading. It is read only, the modifications throw std::logic_error. It
+// must not outlive the ConcurrentStore it was created from.
+class ConcurrentStoreSnapshot final : public IStore {
+public:
+  ConcurrentStoreSnapshot(const ConcurrentStore &store, const size_t instanceIndex);
+  ConcurrentStoreSnapshot(const ConcurrentStoreSnapshot &) = delete;
+  ConcurrentStoreSnapshot(ConcurrentStoreSnapshot &&) = delete;
+  ConcurrentStoreSnapshot &operator=(const ConcurrentStoreSnapshot &) = delete;
+  ConcurrentStoreSnapshot &operator=(ConcurrentStoreSnapshot &&) = delete;
+  ~ConcurrentStoreSnapshot() override;
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+private:
+  [[noreturn]] static void throwReadOnly();
+
+  const ConcurrentStore &m_store;
+  size_t m_instanceIndex;
+  std::shared_ptr<ConcurrentStore::ThreadPins> m_threadPins;
+};
+
+} // namespace EntityStore
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+#include "utils/containers/DynamicBitset.hpp"
+
+namespace EntityStore {
+
+// The set of the empty slots of a store. Every slot has a bit, and every word of the slot bits has a bit in a summary
+// bitset, so the smallest empty slot can be found by skipping 4096 full slots at once. Together with a hint of the
+// first word that might contain an empty slot, every operation is amortized constant time.
+class EmptySlots {
+public:
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] size_t size() const;
+
+  // The slot must not be in the set.
+  void insert(const size_t slot);
+  // The slot must be in the set.
+  void erase(const size_t slot);
+  // Removes and returns the smallest slot. The set must not be empty.
+  [[nodiscard]] size_t extractFirst();
+
+  void clear();
+
+private:
+  utils::containers::DynamicBitset m_slots;
+  utils::containers::DynamicBitset m_nonEmptyWords;
+  // There is no empty slot in the words before this one.
+  size_t m_firstCandidateWord{0U};
+  size_t m_size{0U};
+};
+
+} // namespace EntityStore
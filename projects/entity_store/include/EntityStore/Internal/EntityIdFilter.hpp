@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+
+namespace EntityStore {
+
+// A Bloom filter of entity ids: it never forgets an inserted id, but it might claim to contain an id that wasn't
+// inserted. Both bits of an id are in the same word, so a lookup touches only a single cache line. The ids are hashed
+// separately from the lookup, so a hash can be checked against many filters (e.g. every level of a nested store).
+class EntityIdFilter {
+public:
+  [[nodiscard]] static uint64_t hash(const EntityId id);
+
+  // The filter has to be reset with a bigger capacity before inserting into a full filter, otherwise the false positive
+  // rate grows quickly.
+  void insert(const EntityId id);
+  [[nodiscard]] bool mayContain(const uint64_t idHash) const;
+  [[nodiscard]] bool isFull() const;
+  void reset(const size_t capacity);
+
+private:
+  std::vector<uint64_t> m_words;
+  size_t m_numberOfIds{0U};
+};
+
+} // namespace EntityStore
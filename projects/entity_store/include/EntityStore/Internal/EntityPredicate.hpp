@@ -1,13 +1,37 @@
 #pragma once
 
-#include <unordered_set>
+#include <concepts>
+#include <type_traits>
+#include <utility>
 
+#include "EntityStore/EntityIdSet.hpp"
 #include "EntityStore/Internal/Entity.hpp"
 #include "EntityStore/Properties.hpp"
 
 namespace EntityStore {
 
-// TODO(antaljanosbenjamin) Use concept instead of base class
+// Every type that can be called with an id and the properties of an entity can be used as a predicate. The virtual
+// interface of the stores needs the EntityPredicate base class, but the inlined filter functions (see filterIdsInlined)
+// accept any type that satisfies this concept, so the calls to the predicate can be inlined into their scan loops. As
+// the predicates below are final, the calls through their concrete type are not virtual either.
+template <typename TPredicate>
+concept EntityPredicateLike = requires(const TPredicate &predicate, const EntityId &id, const Properties &properties) {
+  { predicate(id, properties) } -> std::convertible_to<bool>;
+};
+
+// The parallel scans evaluate the same predicate on many threads. A predicate that has state shared by the threads
+// (e.g. the counters of the instrumentation) can provide a chunkPredicate function that returns a single-threaded
+// version of itself. The scan loops call the function with it for every chunk, and with the predicate itself otherwise.
+template <EntityPredicateLike TPredicate, typename TFunc>
+decltype(auto) withChunkPredicate(const TPredicate &predicate, TFunc &&func) {
+  if constexpr (requires { predicate.chunkPredicate(); }) {
+    const auto chunkPredicate = predicate.chunkPredicate();
+    return std::forward<TFunc>(func)(chunkPredicate);
+  } else {
+    return std::forward<TFunc>(func)(predicate);
+  }
+}
+
 class EntityPredicate {
 public:
   EntityPredicate() = default;
@@ -66,18 +90,25 @@ private:
   const TMaxQueryValue &m_maxValue;
 };
 
+class AllEntitiesPredicate final : public EntityPredicate {
+public:
+  bool operator()(const EntityId & /*id*/, const Properties & /*properties*/) const override {
+    return true;
+  }
+};
+
 class IgnoreIds final : public EntityPredicate {
 public:
-  explicit IgnoreIds(std::unordered_set<EntityId> ignoredIds)
+  explicit IgnoreIds(EntityIdSet ignoredIds)
     : m_ignoredIds{std::move(ignoredIds)} {
   }
 
   bool operator()(const EntityId &id, const Properties & /*properties*/) const override {
-    return m_ignoredIds.find(id) == m_ignoredIds.end();
+    return !m_ignoredIds.contains(id);
   }
 
 private:
-  const std::unordered_set<EntityId> m_ignoredIds;
+  const EntityIdSet m_ignoredIds;
 };
 
 // TODO(antaljanosbenjamin) Check fuchsia-trailing-return
@@ -101,7 +132,11 @@ private:
 template <typename TLhsPredicate, typename TRhsPredicate>
 CompositePredicate(TLhsPredicate &&lhs, TRhsPredicate &&rhs) -> CompositePredicate<TLhsPredicate, TRhsPredicate>;
 
+// Constrained to the predicates, otherwise it would be a better match than the operators of the other types (e.g.
+// EntityIdSet) in this namespace when they are called with non-const arguments.
 template <typename TLhsPredicate, typename TRhsPredicate>
+requires std::derived_from<std::remove_cvref_t<TLhsPredicate>, EntityPredicate> &&
+    std::derived_from<std::remove_cvref_t<TRhsPredicate>, EntityPredicate>
 CompositePredicate<TLhsPredicate, TRhsPredicate> operator|(TLhsPredicate &&lhs, TRhsPredicate &&rhs) {
   return CompositePredicate<TLhsPredicate, TRhsPredicate>{std::forward<TLhsPredicate>(lhs),
                                                           std::forward<TRhsPredicate>(rhs)};
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "EntityStore/EntityIdSet.hpp"
 #include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityIdFilter.hpp"
+#include "EntityStore/Properties.hpp"
 
 namespace EntityStore {
 
@@ -20,14 +26,19 @@ public:
   void insert();
   void update();
   void remove();
+  // Records the properties that were set by an update, so only they have to be updated in the parent.
+  void addUpdatedProperties(const PropertyMask &propertyIds);
 
   [[nodiscard]] bool needsToInsertToParent() const;
   [[nodiscard]] bool needsToUpdateInParent() const;
   [[nodiscard]] bool needsToRemoveFromParent() const;
   [[nodiscard]] const EntityState &state() const;
+  // Only meaningful if the entity needs to be updated in the parent.
+  [[nodiscard]] const PropertyMask &updatedProperties() const;
 
 private:
   EntityState m_state{EntityState::Default};
+  PropertyMask m_updatedProperties;
 };
 
 class EntityTransaction;
@@ -35,30 +46,59 @@ class EntityTransaction;
 class EntityStatesManager {
 public:
   friend EntityTransaction;
-  using StateHandlerMap = std::unordered_map<EntityId, EntityStateHandler>;
-
-  EntityStatesManager() = default;
-  EntityStatesManager(const EntityStatesManager &) = default;
-  EntityStatesManager(EntityStatesManager &&) = default;
-  EntityStatesManager &operator=(const EntityStatesManager &) = default;
-  // Cannot be noexcept because of std::unordered_map is not noexcept move constructible
-  EntityStatesManager &operator=(EntityStatesManager &&) = default;
+  using StateHandlerMap = std::pmr::unordered_map<EntityId, EntityStateHandler>;
+
+  EntityStatesManager();
+  EntityStatesManager(const EntityStatesManager &) = delete;
+  // The moved-from manager gets a new arena by construction and the arena of the assigned one by assignment, so it can
+  // be used further just like a moved-from std::unordered_map.
+  EntityStatesManager(EntityStatesManager &&other);
+  EntityStatesManager &operator=(const EntityStatesManager &) = delete;
+  EntityStatesManager &operator=(EntityStatesManager &&other);
   ~EntityStatesManager() = default;
 
   [[nodiscard]] const EntityStateHandler *tryGetState(const EntityId id) const;
   [[nodiscard]] const EntityStateHandler &getState(const EntityId id) const;
+  // Returns false if the entity certainly doesn't have a state, so the readers can skip the lookup of the state and the
+  // entity for most of the untouched entities. The hash has to be calculated by EntityIdFilter::hash.
+  [[nodiscard]] bool mayHaveState(const uint64_t idHash) const;
 
   // TODO(antaljanosbenjamin) Add insert/update/remove tokens to make sure only the regarding operation can be done
   [[nodiscard]] EntityTransaction startInsert(const EntityId id);
   [[nodiscard]] EntityTransaction startUpdate(const EntityId id);
   [[nodiscard]] EntityTransaction startRemove(const EntityId id);
 
-  [[nodiscard]] std::unordered_set<EntityId> createEntityIdsSet() const;
+  // Removes the ids of the entities that have a state from the set. The touched ids are maintained incrementally: the
+  // changed ids are collected by the modifications and they are merged into the touched ids only when there are many
+  // of them, so a query after a few modifications has to sort only the changed ids. It doesn't modify the manager,
+  // therefore it can be called concurrently.
+  void removeTouchedIds(EntityIdSet &ids) const;
   bool eraseStateHandler(const EntityId id);
   [[nodiscard]] const StateHandlerMap &stateHandlers() const;
 
 private:
-  StateHandlerMap m_stateHandlers;
+  // Every node of the state handlers is allocated from the pool of the arena, so they are not freed one by one when the
+  // manager is reset after a commit or rollback: the pool returns its memory to the heap in a few large chunks. The
+  // pool is not thread safe, but neither is the manager.
+  struct StateHandlerArena {
+    std::pmr::unsynchronized_pool_resource resource;
+    StateHandlerMap stateHandlers{&resource};
+  };
+
+  void addState(const EntityId id);
+  void addToFilter(const EntityId id);
+  void recordChangedId(const EntityId id);
+  // Returns the changed ids that have a state and the ones that don't have anymore.
+  [[nodiscard]] std::pair<EntityIdSet, EntityIdSet> splitChangedIds() const;
+  void mergeChangedIds();
+
+  // The map refers to the resource, so they are kept together on the heap, which makes moving the manager safe.
+  std::unique_ptr<StateHandlerArena> m_arena;
+  // Contains every entity that has a state, but the erased states are only removed from it when it is rebuilt.
+  EntityIdFilter m_filter;
+  EntityIdSet m_touchedIds;
+  // The ids whose state was added or erased since m_touchedIds was updated. An id might be here many times.
+  std::vector<EntityId> m_changedIds;
 };
 
 class EntityTransaction {
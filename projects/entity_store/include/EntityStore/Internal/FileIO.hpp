@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace EntityStore {
+
+// A file that is written sequentially. Every error is reported by std::system_error.
+class OutputFile {
+public:
+  enum class Mode {
+    Truncate,
+    Append,
+  };
+
+  OutputFile(const std::filesystem::path &path, const Mode mode);
+
+  void write(std::span<const std::byte> bytes);
+  // Flushes the buffered data and makes sure it reaches the disk (fsync), so it survives a crash of the machine too.
+  void sync();
+  void close();
+
+private:
+  struct FileCloser {
+    void operator()(std::FILE *file) const;
+  };
+
+  std::filesystem::path m_path;
+  std::unique_ptr<std::FILE, FileCloser> m_file;
+};
+
+// The whole content of a file for reading. Where it is possible the file is memory mapped, so the pages are read only
+// when they are touched and they don't have to be copied into a buffer.
+class MappedFile {
+public:
+  explicit MappedFile(const std::filesystem::path &path);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+  ~MappedFile();
+
+  [[nodiscard]] std::span<const std::byte> bytes() const;
+
+private:
+  void *m_mapping{nullptr};
+  size_t m_size{0U};
+  // Used only when memory mapping is not available.
+  std::vector<std::byte> m_buffer;
+};
+
+// Writes the file next to its final place and renames it only after it is synced, so the file is either completely
+// written or not touched at all.
+template <typename TWriteFunc>
+void writeFileAtomically(const std::filesystem::path &path, TWriteFunc &&writeFunc) {
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+  {
+    OutputFile file{temporaryPath, OutputFile::Mode::Truncate};
+    writeFunc(file);
+    file.sync();
+    file.close();
+  }
+  std::filesystem::rename(temporaryPath, path);
+}
+
+} // namespace EntityStore
@@ -1,13 +1,26 @@
 #pragma once
 
-#include <unordered_set>
+#include <optional>
+#include <span>
 
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
 #include "EntityStore/Internal/Entity.hpp"
 #include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
 #include "EntityStore/Properties.hpp"
+#include "EntityStore/QueryExecutor.hpp"
 
 namespace EntityStore {
 
+class NestedStore;
+struct FlatIdIndex;
+template <typename TIdIndex>
+class BasicRootStore;
+using RootStore = BasicRootStore<FlatIdIndex>;
+
 // TODO(antaljanosbenjamin) Add proper documentation
 class IStore { // NOLINT(cppcoreguidelines-special-member-functions)
 public:
@@ -25,11 +38,74 @@ public:
 
   virtual bool remove(const EntityId id) = 0;
 
-  [[nodiscard]] virtual std::unordered_set<EntityId> filterIds(const EntityPredicate &predicate) const = 0;
+  // The batch operations behave exactly the same as calling the single item operations one by one in the same order,
+  // but they give the chance to the stores to prepare for the whole batch (e.g. reserve memory). The properties of the
+  // mutable entities are moved into the store.
+  virtual BatchResult insertBatch(std::span<Entity> entities) = 0;
+  virtual BatchResult insertBatch(std::span<const Entity> entities) = 0;
+  virtual BatchResult updateBatch(std::span<Entity> entities) = 0;
+  virtual BatchResult updateBatch(std::span<const Entity> entities) = 0;
+  virtual BatchResult removeBatch(std::span<const EntityId> ids) = 0;
+
+  // Applies the changes of a committed child store. Throws std::logic_error if any of the changes cannot be applied.
+  virtual void applyChanges(ChangeSet &&changes) = 0;
+
+  // If the executor is not null, then the store might evaluate the predicate on multiple threads at the same time, so
+  // the predicate must be safe to be called concurrently.
+  [[nodiscard]] virtual EntityIdSet filterIds(const EntityPredicate &predicate,
+                                              const QueryExecutor *executor) const = 0;
+  // The lookup must describe the same condition as the predicate (or a less strict one), so the store can use it to
+  // find the candidates by an index. The candidates are always checked by the predicate.
+  [[nodiscard]] virtual EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                              const QueryExecutor *executor) const = 0;
+  // Returns the statistics of the index which could serve the lookup, or nullopt if there is no such index. See
+  // PropertyIndex::estimate for the meaning of maxMatchingEntities.
+  [[nodiscard]] virtual std::optional<IndexEstimate> estimate(const IndexLookup &lookup,
+                                                             const size_t maxMatchingEntities) const = 0;
+  // Folds the matching entities into a copy of the empty aggregator. The lookup is optional, it is used the same way as
+  // by filterIds. The predicate and the aggregator are called in the same pass over the entities, during which the
+  // store keeps the entities unchanged (e.g. by holding its lock), so the aggregators can use the properties safely
+  // even if the store is modified concurrently. The aggregateInlined functions use it for the stores that don't have
+  // inlined aggregate functions.
+  [[nodiscard]] virtual AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                                const AnyAggregator &emptyAggregator,
+                                                const QueryExecutor *executor) const = 0;
+
+  // Makes it possible to call the inlined filter functions of the concrete stores, see filterIdsInlined below. Returns
+  // nullptr if the store is not of the requested type.
+  [[nodiscard]] virtual const RootStore *asRootStore() const = 0;
+  [[nodiscard]] virtual const NestedStore *asNestedStore() const = 0;
+
+  virtual bool createIndex(const PropertyId propertyId, const IndexType indexType) = 0;
+  virtual bool dropIndex(const PropertyId propertyId) = 0;
 
   virtual void commit() = 0;
   virtual void rollback() = 0;
   virtual void shrink() = 0;
+  // The incremental version of shrink: moves at most the specified number of entities to fill the holes left by the
+  // removed entities, so it can be called regularly without stopping the store for long. Returns true if there are no
+  // holes left. Like shrink, it might invalidate the pointers returned by the store.
+  virtual bool compact(const size_t maxMovedEntities) = 0;
 };
 
+// The same as IStore::filterIds, but if the store supports it, then the predicate is called through its concrete type
+// instead of the virtual EntityPredicate interface, so the compiler can inline it into the scan loop. The stores that
+// don't support it are queried through the virtual interface, so the predicate must be derived from EntityPredicate.
+// Defined in InlinedFilter.hpp, because it needs the definition of every store.
+template <EntityPredicateLike TPredicate>
+[[nodiscard]] EntityIdSet filterIdsInlined(const IStore &store, const TPredicate &predicate,
+                                           const QueryExecutor *executor);
+template <EntityPredicateLike TPredicate>
+[[nodiscard]] EntityIdSet filterIdsInlined(const IStore &store, const TPredicate &predicate, const IndexLookup &lookup,
+                                           const QueryExecutor *executor);
+
+// The same as filterIdsInlined, but instead of collecting the ids of the matching entities, they are folded into a copy
+// of the empty aggregator. Also defined in InlinedFilter.hpp.
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+[[nodiscard]] TAggregator aggregateInlined(const IStore &store, const TPredicate &predicate,
+                                           const TAggregator &emptyAggregator, const QueryExecutor *executor);
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+[[nodiscard]] TAggregator aggregateInlined(const IStore &store, const TPredicate &predicate, const IndexLookup &lookup,
+                                           const TAggregator &emptyAggregator, const QueryExecutor *executor);
+
 } // namespace EntityStore
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <type_traits>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/NestedStore.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/QueryExecutor.hpp"
+
+namespace EntityStore {
+
+// There is a virtual call per store instead of one per entity, which is negligible even for deeply nested stores.
+template <EntityPredicateLike TPredicate>
+EntityIdSet filterIdsInlined(const IStore &store, const TPredicate &predicate, const QueryExecutor *executor) {
+  if (const auto *rootStore = store.asRootStore(); rootStore != nullptr) {
+    return rootStore->filterIdsInlined(predicate, executor);
+  }
+  if (const auto *nestedStore = store.asNestedStore(); nestedStore != nullptr) {
+    return nestedStore->filterIdsInlined(predicate, executor);
+  }
+  return store.filterIds(predicate, executor);
+}
+
+template <EntityPredicateLike TPredicate>
+EntityIdSet filterIdsInlined(const IStore &store, const TPredicate &predicate, const IndexLookup &lookup,
+                             const QueryExecutor *executor) {
+  if (const auto *rootStore = store.asRootStore(); rootStore != nullptr) {
+    return rootStore->filterIdsInlined(predicate, lookup, executor);
+  }
+  if (const auto *nestedStore = store.asNestedStore(); nestedStore != nullptr) {
+    return nestedStore->filterIdsInlined(predicate, lookup, executor);
+  }
+  return store.filterIds(predicate, lookup, executor);
+}
+
+// The stores without inlined aggregate functions are aggregated through IStore::aggregate, so the matching entities are
+// visited in a single pass while the store keeps them unchanged. The nested stores are not handled, because they call
+// this function for their first non-nested ancestor, so handling them would make the type of the predicate recursive.
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator aggregateNotNestedInlined(const IStore &store, const TPredicate &predicate, const IndexLookup *lookup,
+                                      const TAggregator &emptyAggregator, const QueryExecutor *executor) {
+  if (const auto *rootStore = store.asRootStore(); rootStore != nullptr) {
+    if (lookup != nullptr) {
+      return rootStore->aggregateInlined(predicate, *lookup, emptyAggregator, executor);
+    }
+    return rootStore->aggregateInlined(predicate, emptyAggregator, executor);
+  }
+  if constexpr (std::is_same_v<TAggregator, AnyAggregator>) {
+    return store.aggregate(predicate, lookup, emptyAggregator, executor);
+  } else {
+    return store.aggregate(predicate, lookup, AnyAggregator{emptyAggregator}, executor).template get<TAggregator>();
+  }
+}
+
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator aggregateInlined(const IStore &store, const TPredicate &predicate, const TAggregator &emptyAggregator,
+                             const QueryExecutor *executor) {
+  if (const auto *nestedStore = store.asNestedStore(); nestedStore != nullptr) {
+    return nestedStore->aggregateInlined(predicate, emptyAggregator, executor);
+  }
+  return aggregateNotNestedInlined(store, predicate, nullptr, emptyAggregator, executor);
+}
+
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator aggregateInlined(const IStore &store, const TPredicate &predicate, const IndexLookup &lookup,
+                             const TAggregator &emptyAggregator, const QueryExecutor *executor) {
+  if (const auto *nestedStore = store.asNestedStore(); nestedStore != nullptr) {
+    return nestedStore->aggregateInlined(predicate, lookup, emptyAggregator, executor);
+  }
+  return aggregateNotNestedInlined(store, predicate, &lookup, emptyAggregator, executor);
+}
+
+} // namespace EntityStore
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/StoreStatistics.hpp"
+
+namespace EntityStore {
+
+// The instrumentation can be compiled out by the ENTITY_STORE_INSTRUMENTATION CMake option. In that case every
+// measurement below is discarded by if constexpr, so the stores don't even check whether their instrumentation is
+// enabled.
+#ifdef ENTITY_STORE_DISABLE_INSTRUMENTATION
+inline constexpr bool kIsInstrumentationEnabled{false};
+#else
+inline constexpr bool kIsInstrumentationEnabled{true};
+#endif
+
+// Collects the statistics of the operations of a store and its child stores. The counters are relaxed atomics, because
+// the snapshots of a concurrent store and the threads of a parallel query record into the same instance. The statistics
+// are only approximately consistent with each other while the operations are running.
+class Instrumentation {
+public:
+  void recordLatency(const StoreOperation operation, const std::chrono::nanoseconds latency);
+  void recordScan(const uint64_t scannedEntities, const uint64_t matchedEntities);
+  void recordTraversedLevels(const uint64_t levels);
+  void recordCommit(const uint64_t numberOfChanges);
+
+  [[nodiscard]] StoreStatistics snapshot() const;
+  void reset();
+
+private:
+  class AtomicHistogram {
+  public:
+    void add(const uint64_t value);
+    [[nodiscard]] Log2Histogram load() const;
+    void reset();
+
+  private:
+    std::array<std::atomic<uint64_t>, Log2Histogram::kNumberOfBuckets> m_buckets{};
+    std::atomic<uint64_t> m_count{0U};
+    std::atomic<uint64_t> m_sum{0U};
+  };
+
+  std::array<AtomicHistogram, asUnderlying(StoreOperation::LAST) + 1> m_latencies{};
+  std::atomic<uint64_t> m_scannedEntities{0U};
+  std::atomic<uint64_t> m_matchedEntities{0U};
+  AtomicHistogram m_traversedLevels{};
+  AtomicHistogram m_commitSizes{};
+};
+
+class ScopedLatency {
+public:
+  ScopedLatency(Instrumentation &instrumentation, const StoreOperation operation)
+    : m_instrumentation{&instrumentation}
+    , m_operation{operation}
+    , m_start{std::chrono::steady_clock::now()} {
+  }
+
+  ScopedLatency(const ScopedLatency &) = delete;
+  ScopedLatency(ScopedLatency &&) = delete;
+  ScopedLatency &operator=(const ScopedLatency &) = delete;
+  ScopedLatency &operator=(ScopedLatency &&) = delete;
+
+  ~ScopedLatency() {
+    m_instrumentation->recordLatency(m_operation, std::chrono::steady_clock::now() - m_start);
+  }
+
+private:
+  Instrumentation *m_instrumentation;
+  StoreOperation m_operation;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Counts the entities the wrapped predicate is evaluated on and the ones that match. It is passed to the scan loops by
+// its concrete type, same as the wrapped predicate, so the wrapped call is still inlined. Only the chunks of a parallel
+// scan evaluate it on other threads, and they do it through their own ChunkPredicate (see withChunkPredicate), so the
+// direct calls are counted by plain counters, and the atomic counters are touched only once per chunk.
+template <EntityPredicateLike TPredicate>
+class CountingPredicate final : public EntityPredicate {
+public:
+  class ChunkPredicate final : public EntityPredicate {
+  public:
+    explicit ChunkPredicate(const CountingPredicate &parent)
+      : m_parent{parent} {
+    }
+
+    ChunkPredicate(const ChunkPredicate &) = delete;
+    ChunkPredicate(ChunkPredicate &&) = delete;
+    ChunkPredicate &operator=(const ChunkPredicate &) = delete;
+    ChunkPredicate &operator=(ChunkPredicate &&) = delete;
+
+    ~ChunkPredicate() override {
+      m_parent.m_chunkScannedEntities.fetch_add(m_scannedEntities, std::memory_order_relaxed);
+      m_parent.m_chunkMatchedEntities.fetch_add(m_matchedEntities, std::memory_order_relaxed);
+    }
+
+    bool operator()(const EntityId &id, const Properties &properties) const override {
+      return m_parent.evaluate(id, properties, m_scannedEntities, m_matchedEntities);
+    }
+
+  private:
+    const CountingPredicate &m_parent;
+    mutable uint64_t m_scannedEntities{0U};
+    mutable uint64_t m_matchedEntities{0U};
+  };
+
+  explicit CountingPredicate(const TPredicate &predicate)
+    : m_predicate{predicate} {
+  }
+
+  bool operator()(const EntityId &id, const Properties &properties) const override {
+    return evaluate(id, properties, m_scannedEntities, m_matchedEntities);
+  }
+
+  [[nodiscard]] ChunkPredicate chunkPredicate() const {
+    return ChunkPredicate{*this};
+  }
+
+  // Must not be called while a chunk is evaluated.
+  [[nodiscard]] uint64_t scannedEntities() const {
+    return m_scannedEntities + m_chunkScannedEntities.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t matchedEntities() const {
+    return m_matchedEntities + m_chunkMatchedEntities.load(std::memory_order_relaxed);
+  }
+
+private:
+  bool evaluate(const EntityId &id, const Properties &properties, uint64_t &scannedEntities,
+                uint64_t &matchedEntities) const {
+    const bool matches = m_predicate(id, properties);
+    ++scannedEntities;
+    matchedEntities += matches ? 1U : 0U;
+    return matches;
+  }
+
+  const TPredicate &m_predicate;
+  mutable uint64_t m_scannedEntities{0U};
+  mutable uint64_t m_matchedEntities{0U};
+  mutable std::atomic<uint64_t> m_chunkScannedEntities{0U};
+  mutable std::atomic<uint64_t> m_chunkMatchedEntities{0U};
+};
+
+// Measures the latency of the operation if the instrumentation is not null, otherwise it only calls the function.
+template <typename TFunc>
+decltype(auto) instrument(Instrumentation *instrumentation, const StoreOperation operation, TFunc &&func) {
+  if constexpr (kIsInstrumentationEnabled) {
+    if (instrumentation != nullptr) {
+      const ScopedLatency latency{*instrumentation, operation};
+      return std::forward<TFunc>(func)();
+    }
+  }
+  return std::forward<TFunc>(func)();
+}
+
+// Same as instrument, but the scan function is called with a CountingPredicate that wraps the predicate, so the scanned
+// and matched entities are recorded too. Without instrumentation the scan function gets the original predicate, so the
+// scan loops are the same as without this wrapper.
+template <EntityPredicateLike TPredicate, typename TScanFunc>
+auto instrumentScan(Instrumentation *instrumentation, const StoreOperation operation, const TPredicate &predicate,
+                    TScanFunc &&scanFunc) {
+  if constexpr (kIsInstrumentationEnabled) {
+    if (instrumentation != nullptr) {
+      const ScopedLatency latency{*instrumentation, operation};
+      const CountingPredicate<TPredicate> countingPredicate{predicate};
+      auto result = std::forward<TScanFunc>(scanFunc)(countingPredicate);
+      instrumentation->recordScan(countingPredicate.scannedEntities(), countingPredicate.matchedEntities());
+      return result;
+    }
+  }
+  return std::forward<TScanFunc>(scanFunc)(predicate);
+}
+
+} // namespace EntityStore
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Internal/WriteAheadLog.hpp"
+#include "EntityStore/Properties.hpp"
+
+namespace EntityStore {
+
+// A RootStore whose modifications are recorded into a write-ahead log, so they can be recovered after a crash by
+// replaying the log on top of the latest snapshot. Only the successful modifications are logged. The indices are not
+// persisted, so creating or dropping them is not logged either.
+class LoggingStore final : public IStore {
+public:
+  LoggingStore(RootStore &&store, std::filesystem::path snapshotPath, std::filesystem::path logPath,
+               const WriteAheadLogOptions &options, const uint64_t lastLogSequenceNumber);
+  LoggingStore(const LoggingStore &) = delete;
+  LoggingStore(LoggingStore &&) = delete;
+  LoggingStore &operator=(const LoggingStore &) = delete;
+  LoggingStore &operator=(LoggingStore &&) = delete;
+  ~LoggingStore() override = default;
+
+  // Loads the snapshot if it exists, replays the log on top of it and drops the torn record from the end of the log,
+  // so the new records can be appended safely.
+  [[nodiscard]] static std::unique_ptr<LoggingStore> open(const std::filesystem::path &snapshotPath,
+                                                          const std::filesystem::path &logPath,
+                                                          const WriteAheadLogOptions &options);
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  // The whole change set is logged as a single record.
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  // The queries don't have to be logged, so they can use the inlined filter functions of the underlying store.
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+  void syncLog();
+  // Saves a snapshot that contains every logged modification, then truncates the log. If a modification failed to be
+  // logged, then a successful checkpoint makes the store modifiable again.
+  void checkpoint();
+
+private:
+  // The record is encoded before the modification is applied, because the properties might be moved into the store.
+  // It is logged only if the modification changed something.
+  template <typename TEncodeFunc, typename TApplyFunc>
+  auto applyLogged(const LogRecordType type, TEncodeFunc &&encodeFunc, TApplyFunc &&applyFunc);
+
+  RootStore m_store;
+  std::filesystem::path m_snapshotPath;
+  WriteAheadLog m_log;
+  // Set if a modification was applied, but it couldn't be logged. The modifications are rejected until a checkpoint.
+  bool m_hasFailedLogging{false};
+};
+
+} // namespace EntityStore
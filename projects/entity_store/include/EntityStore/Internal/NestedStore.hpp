@@ -1,19 +1,35 @@
 #pragma once
 
-#include <unordered_set>
+#include <optional>
+#include <span>
+#include <vector>
 
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/Batch.hpp"
 #include "EntityStore/Internal/Entity.hpp"
 #include "EntityStore/Internal/EntityPredicate.hpp"
 #include "EntityStore/Internal/EntityStatesManager.hpp"
 #include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/Instrumentation.hpp"
 #include "EntityStore/Internal/RootStore.hpp"
 #include "EntityStore/Properties.hpp"
 #include "utils/PropagateConst.hpp"
 
 namespace EntityStore {
 
+// Defined in InlinedFilter.hpp, which depends on this file.
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator aggregateNotNestedInlined(const IStore &store, const TPredicate &predicate, const IndexLookup *lookup,
+                                      const TAggregator &emptyAggregator, const QueryExecutor *executor);
+
 // This class contains the logic that necessary to have nested stores. It knows about and uses very frequently the
 // parent store. It also maintain the state of the Entities that are inserted/modified/removed through it.
+//
+// The point reads don't go through the parent stores one by one. Every level of the chain has a filter of the touched
+// entities, so the reads check only the levels that might have touched the entity and then read the first non-nested
+// ancestor directly. Therefore reading an untouched entity costs only a few bit checks per level even in a deeply
+// nested store.
 
 class NestedStore : public IStore {
 public:
@@ -49,22 +65,127 @@ public:
 
   bool remove(const EntityId id) override;
 
-  std::unordered_set<EntityId> filterIds(const EntityPredicate &predicate) const override;
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  template <EntityPredicateLike TPredicate>
+  [[nodiscard]] EntityIdSet filterIdsInlined(const TPredicate &predicate, const QueryExecutor *executor) const {
+    return combineWithParentResult(m_ownStore.filterIdsInlined(predicate, executor),
+                                   EntityStore::filterIdsInlined(*m_parentStore, predicate, executor));
+  }
+
+  template <EntityPredicateLike TPredicate>
+  [[nodiscard]] EntityIdSet filterIdsInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                             const QueryExecutor *executor) const {
+    return combineWithParentResult(m_ownStore.filterIdsInlined(predicate, executor),
+                                   EntityStore::filterIdsInlined(*m_parentStore, predicate, lookup, executor));
+  }
+
+  // The aggregations walk the levels of the chain the same way as the point reads do: the own store of every level and
+  // the first non-nested ancestor are aggregated one by one, and the entities that are touched by a lower level are
+  // skipped, because that level contains their current version or they were removed by it. So the type of the
+  // predicate doesn't depend on the depth of the chain.
+  template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregateInlined(const TPredicate &predicate, const TAggregator &emptyAggregator,
+                                             const QueryExecutor *executor) const {
+    return aggregateLevels(predicate, nullptr, emptyAggregator, executor);
+  }
+
+  template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregateInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                             const TAggregator &emptyAggregator, const QueryExecutor *executor) const {
+    return aggregateLevels(predicate, &lookup, emptyAggregator, executor);
+  }
+
+  // The child stores don't have their own indices, because the own store of them is usually small and it is cleared
+  // after every commit and rollback. However, their queries still use the indices of their parent.
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
 
   void commit() override;
   void rollback() override;
 
   void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+  // If it is set, then the number of traversed levels of the point reads and the size of the commits are recorded. The
+  // store doesn't own the instrumentation, see Store::enableInstrumentation.
+  void setInstrumentation(Instrumentation *instrumentation);
 
 private:
   bool isRemovedByThisChild(const EntityId id) const;
+  void recordTraversedLevels(const uint64_t levels) const;
+
+  // Matches the entities that match the predicate and are not touched by any of the levels. Most of the entities are
+  // not touched, so the filters of the levels decide about them without a lookup. It is an EntityPredicate, so it can
+  // be passed to the stores that don't have inlined functions too.
+  template <EntityPredicateLike TPredicate>
+  class UntouchedPredicate final : public EntityPredicate {
+  public:
+    UntouchedPredicate(const TPredicate &predicate, std::span<const NestedStore *const> levels)
+      : m_predicate{predicate}
+      , m_levels{levels} {
+    }
+
+    bool operator()(const EntityId &id, const Properties &properties) const override {
+      const auto idHash = EntityIdFilter::hash(id);
+      for (const auto *level: m_levels) {
+        if (level->m_statesManager.mayHaveState(idHash) && level->m_statesManager.tryGetState(id) != nullptr) {
+          return false;
+        }
+      }
+      return m_predicate(id, properties);
+    }
+
+  private:
+    const TPredicate &m_predicate;
+    std::span<const NestedStore *const> m_levels;
+  };
+
+  // The lookup is used only for the first non-nested ancestor, because the own stores don't have indices.
+  template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregateLevels(const TPredicate &predicate, const IndexLookup *lookup,
+                                            const TAggregator &emptyAggregator,
+                                            const QueryExecutor *executor) const {
+    auto result = emptyAggregator;
+    std::vector<const NestedStore *> lowerLevels;
+    for (const auto *level = this; level != nullptr; level = level->m_nestedParent) {
+      result.merge(level->m_ownStore.aggregateInlined(UntouchedPredicate<TPredicate>{predicate, lowerLevels},
+                                                          emptyAggregator, executor));
+      lowerLevels.push_back(level);
+    }
+    result.merge(aggregateNotNestedInlined(*m_chainRoot, UntouchedPredicate<TPredicate>{predicate, lowerLevels},
+                                               lookup, emptyAggregator, executor));
+    return result;
+  }
+
+  [[nodiscard]] EntityIdSet combineWithParentResult(EntityIdSet &&ownResult, EntityIdSet &&parentResult) const;
 
   void doCommitChanges();
   void reset();
 
   utils::PropagateConst<IStore *> m_parentStore;
+  // The parent if it is a nested store and the first non-nested ancestor, they are used only for reading.
+  const NestedStore *m_nestedParent;
+  const IStore *m_chainRoot;
   RootStore m_ownStore;
   EntityStatesManager m_statesManager;
+  Instrumentation *m_instrumentation{nullptr};
 };
 
 } // namespace EntityStore
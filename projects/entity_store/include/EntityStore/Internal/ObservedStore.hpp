@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "EntityStore/ChangeStream.hpp"
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Properties.hpp"
+
+namespace EntityStore {
+
+// Forwards every call to the wrapped store and publishes the successful modifications to the subscriptions. The events
+// of a batch operation or of the commit of a child store (see applyChanges) are published as a single batch. The
+// masks of the events are collected before the modification, because the properties might be moved into the store.
+//
+// If the wrapped store makes its modifications visible only when they are committed (e.g. ConcurrentStore), then the
+// events are buffered until commit, and rollback drops them, so the subscribers never see rolled back modifications.
+// Otherwise the events are published right after the modifications.
+class ObservedStore final : public IStore {
+public:
+  ObservedStore(std::unique_ptr<IStore> store, const bool publishesOnCommit);
+  ObservedStore(const ObservedStore &) = delete;
+  ObservedStore(ObservedStore &&) = delete;
+  ObservedStore &operator=(const ObservedStore &) = delete;
+  ObservedStore &operator=(ObservedStore &&) = delete;
+  ~ObservedStore() override = default;
+
+  // The store keeps the subscription only until the consumer holds it.
+  [[nodiscard]] std::shared_ptr<ChangeSubscription> subscribe(const size_t capacity);
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  // The queries are not observed, so they can use the inlined filter functions of the wrapped store.
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+private:
+  template <typename TEntity, typename TApplyFunc>
+  BatchResult applyObservedBatch(const ChangeType type, std::span<TEntity> entities, TApplyFunc &&applyFunc);
+  void addEvent(const ChangeEvent &event);
+  void publishIfNotDeferred();
+  void publish(std::span<const ChangeEvent> events);
+
+  std::unique_ptr<IStore> m_store;
+  std::vector<std::shared_ptr<ChangeSubscription>> m_subscriptions;
+  bool m_publishesOnCommit;
+  // The events that are not published yet. The buffer is kept to avoid allocating it for every batch.
+  std::vector<ChangeEvent> m_events;
+};
+
+} // namespace EntityStore
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/NestedStore.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Properties.hpp"
+
+namespace EntityStore {
+
+class OptimisticTransaction;
+
+// A store that can be modified by many transactions at the same time from different threads. The transactions are
+// optimistic: they don't lock the entities they read or write, instead every commit is validated against the commits
+// that happened since the transaction started. If any of the entities that the transaction read or wrote was modified
+// by another commit, then the first committer wins and the commit of the transaction fails by
+// TransactionConflictException.
+//
+// The transactions remember the ids that were returned by their queries, but not the conditions of the queries, so
+// the entities that started to match a query because of a later commit (phantoms) are not detected as conflicts.
+class OptimisticStore final : public IStore {
+public:
+  OptimisticStore() = default;
+  OptimisticStore(const OptimisticStore &) = delete;
+  OptimisticStore(OptimisticStore &&) = delete;
+  OptimisticStore &operator=(const OptimisticStore &) = delete;
+  OptimisticStore &operator=(OptimisticStore &&) = delete;
+  ~OptimisticStore() override = default;
+
+  // Can be called from any thread. The transaction must not outlive the store.
+  [[nodiscard]] std::unique_ptr<OptimisticTransaction> beginTransaction();
+
+  // The functions of the store itself are thread safe, but the returned pointers might be invalidated by the commits
+  // of the transactions.
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  // The queries have to lock the store, so they cannot access the underlying store directly. The aggregations go
+  // through aggregate instead, which holds the lock for the whole pass.
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+  // The number of entities whose last modification is still newer than the start of a running transaction.
+  [[nodiscard]] size_t numberOfTrackedEntities() const;
+
+private:
+  friend class TransactionView;
+
+  // Must be called while the store is locked exclusively.
+  void markModified(const EntityId id);
+  template <typename TIds>
+  void markModified(const TIds &ids);
+  void forgetOldVersions();
+  [[nodiscard]] uint64_t startTransaction();
+  [[nodiscard]] uint64_t restartTransaction(const uint64_t startVersion);
+  void finishTransaction(const uint64_t startVersion);
+
+  mutable std::shared_mutex m_mutex;
+  RootStore m_store;
+  // Incremented by every modification. A transaction conflicts with the modifications that have greater version than
+  // the one it started at.
+  uint64_t m_version{0U};
+  // Only the versions that are newer than the start of the oldest running transaction are interesting, the older
+  // ones are forgotten whenever the oldest transaction finishes or restarts.
+  std::unordered_map<EntityId, uint64_t> m_entityVersions;
+  // The modifications in the order of their versions, so the old versions can be found without scanning the map.
+  std::deque<std::pair<uint64_t, EntityId>> m_modifications;
+  std::multiset<uint64_t> m_startVersions;
+};
+
+// The parent of the child store of a transaction. It records the entities that are read by the transaction and
+// validates them on commit. The read entities are copied, so the pointers returned to the transaction are not
+// invalidated by the commits of the other transactions.
+class TransactionView final : public IStore {
+public:
+  explicit TransactionView(OptimisticStore &store);
+  TransactionView(const TransactionView &) = delete;
+  TransactionView(TransactionView &&) = delete;
+  TransactionView &operator=(const TransactionView &) = delete;
+  TransactionView &operator=(TransactionView &&) = delete;
+  ~TransactionView() override;
+
+  // The write functions are not used by NestedStore, so they are not supported.
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  // Validates and applies the changes of the transaction atomically.
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+  // Forgets the read entities and starts a new transaction, e.g. after the previous one was committed.
+  void restart();
+
+private:
+  [[noreturn]] static void throwNotSupported();
+  [[nodiscard]] bool hasConflict(const ChangeSet &changes) const;
+
+  OptimisticStore &m_store;
+  uint64_t m_startVersion;
+  mutable std::unordered_map<EntityId, std::optional<Properties>> m_readEntities;
+  // The ids that were read without their properties, e.g. by contains or by queries.
+  mutable std::unordered_set<EntityId> m_readIds;
+};
+
+// A child store of an OptimisticStore. It can be used only by a single thread, but the different transactions can be
+// used from different threads at the same time. After commit or rollback (even if the commit failed), it continues as
+// a new transaction.
+class OptimisticTransaction final : public IStore {
+public:
+  explicit OptimisticTransaction(OptimisticStore &store);
+  OptimisticTransaction(const OptimisticTransaction &) = delete;
+  OptimisticTransaction(OptimisticTransaction &&) = delete;
+  OptimisticTransaction &operator=(const OptimisticTransaction &) = delete;
+  OptimisticTransaction &operator=(OptimisticTransaction &&) = delete;
+  ~OptimisticTransaction() override = default;
+
+  bool insert(const EntityId id, Properties &&properties) override;
+  bool insert(const EntityId id, const Properties &properties) override;
+
+  const Properties *update(const EntityId id, Properties &&properties) override;
+  const Properties *update(const EntityId id, const Properties &properties) override;
+
+  [[nodiscard]] bool contains(const EntityId id) const override;
+  [[nodiscard]] const Properties *tryGet(const EntityId id) const override;
+  [[nodiscard]] const Properties &get(const EntityId id) const override;
+
+  bool remove(const EntityId id) override;
+
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
+
+  // Throws TransactionConflictException if the transaction conflicts with an earlier commit. The changes of the
+  // transaction are thrown away in that case.
+  void commit() override;
+  void rollback() override;
+  void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
+
+private:
+  TransactionView m_view;
+  NestedStore m_child;
+};
+
+} // namespace EntityStore
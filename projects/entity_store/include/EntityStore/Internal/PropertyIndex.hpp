@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <iterator>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+
+namespace EntityStore {
+
+enum class IndexType {
+  // Can be used only for equality queries, but the lookup is O(1) in average.
+  Hash,
+  // Can be used for both equality and range queries with O(log n) lookup.
+  Ordered,
+};
+
+enum class SortOrder {
+  Ascending,
+  Descending,
+};
+
+// Describes a query in a way that indices can understand it: if upperBound is empty, then the value of the property
+// must be equal to lowerBound, otherwise it must be in the [lowerBound, upperBound) range. The values are always
+// stored as the type of the regarding property, so they are comparable with the indexed values.
+struct IndexLookup {
+  PropertyId propertyId;
+  Property lowerBound;
+  std::optional<Property> upperBound;
+
+  [[nodiscard]] static IndexLookup equalTo(const PropertyId propertyId, Property value);
+  [[nodiscard]] static IndexLookup inRange(const PropertyId propertyId, Property minValue, Property maxValue);
+
+  [[nodiscard]] bool isEquality() const;
+};
+
+// The statistics of an index about a lookup, so the queries can estimate how selective the lookup is before executing
+// it.
+struct IndexEstimate {
+  // The number of entities that match the lookup. It might be capped by the caller, see PropertyIndex::estimate.
+  size_t matchingEntities;
+  // The number of entities that have a value for the indexed property.
+  size_t indexedEntities;
+};
+
+// A secondary index for a single property. It stores the ids of the entities instead of their position in the store,
+// so it doesn't have to be updated when the entities are moved around (e.g. by shrinking the store).
+class PropertyIndex {
+public:
+  explicit PropertyIndex(const IndexType type);
+
+  [[nodiscard]] IndexType type() const;
+  [[nodiscard]] bool canServe(const IndexLookup &lookup) const;
+  [[nodiscard]] size_t size() const;
+
+  void insert(const Property &value, const EntityId id);
+  void remove(const Property &value, const EntityId id);
+
+  // Returns the ids of the entities whose indexed value matches the lookup. If the index cannot serve the lookup, then
+  // the result is empty, so always check canServe first.
+  [[nodiscard]] std::vector<EntityId> find(const IndexLookup &lookup) const;
+  // Counting the matching entities of a hash index is O(1), but an ordered index has to iterate over them, so the
+  // counting stops at maxMatchingEntities. Only valid if the index can serve the lookup.
+  [[nodiscard]] IndexEstimate estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const;
+
+  // Calls the function with the ids of the entities in the order of their indexed value (the entities with equal values
+  // are ordered by their id) until it returns false. If the start position is specified, then the walk starts after
+  // it. Only valid for ordered indices.
+  template <typename TFunc>
+  void forEachInOrder(const std::optional<std::pair<Property, EntityId>> &start, const SortOrder order,
+                      const TFunc &func) const {
+    const auto &index = std::get<OrderedIndex>(m_index);
+    if (order == SortOrder::Ascending) {
+      for (auto it = start.has_value() ? index.upper_bound(*start) : index.begin(); it != index.end(); ++it) {
+        if (!func(it->second)) {
+          return;
+        }
+      }
+    } else {
+      for (auto it = start.has_value() ? std::make_reverse_iterator(index.lower_bound(*start)) : index.rbegin();
+           it != index.rend(); ++it) {
+        if (!func(it->second)) {
+          return;
+        }
+      }
+    }
+  }
+
+private:
+  using HashIndex = std::unordered_map<Property, std::unordered_set<EntityId>>;
+  // Storing the id next to the value makes every element unique, so removing an id of a frequent value is still
+  // O(log n) instead of iterating over every entity with the same value.
+  using OrderedIndex = std::set<std::pair<Property, EntityId>>;
+
+  std::variant<HashIndex, OrderedIndex> m_index;
+  size_t m_size{0U};
+};
+
+// Holds the indices of a store, at most one for every property. It is responsible for keeping them up-to-date, so the
+// stores only have to notify it about the changes.
+class PropertyIndices {
+public:
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] bool hasIndex(const PropertyId propertyId) const;
+  [[nodiscard]] const PropertyIndex *tryGet(const PropertyId propertyId) const;
+
+  // Returns false if there is already an index for the property. The newly created index is empty, the caller has to
+  // fill it up with the already existing entities.
+  bool create(const PropertyId propertyId, const IndexType type);
+  bool drop(const PropertyId propertyId);
+
+  void insert(const EntityId id, const Properties &properties);
+  void insert(const PropertyId propertyId, const EntityId id, const Properties &properties);
+  void remove(const EntityId id, const Properties &properties);
+
+  // As an update only changes the properties that are contained by the update, only the values of those properties
+  // have to be removed before and inserted after the update. The update might be moved into the entity, therefore
+  // removeUpdated returns the indexed properties that are touched by the update, so insertUpdated doesn't need it.
+  PropertyMask removeUpdated(const EntityId id, const Properties &currentProperties, const Properties &update);
+  void insertUpdated(const EntityId id, const Properties &updatedProperties, const PropertyMask &updatedMask);
+
+private:
+  std::array<std::optional<PropertyIndex>, asUnderlying(PropertyId::LAST) + 1> m_indices;
+};
+
+} // namespace EntityStore
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <optional>
+
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Query.hpp"
+
+namespace EntityStore {
+
+class QueryPredicate final : public EntityPredicate {
+public:
+  explicit QueryPredicate(Query query);
+
+  bool operator()(const EntityId & /*id*/, const Properties &properties) const override;
+
+  [[nodiscard]] const Query &query() const;
+
+private:
+  Query m_query;
+};
+
+// The executable form of a Query. The operands of every AND and OR are reordered so the evaluation of an entity can be
+// finished as early as possible: for an AND the cheap conditions that are rarely true come first, while for an OR the
+// cheap conditions that are often true. If possible, one of the conditions is chosen as a lookup, so the store can use
+// an index to find the candidates instead of iterating over every entity.
+struct QueryPlan {
+  QueryPredicate predicate;
+  std::optional<IndexLookup> lookup;
+};
+
+// The selectivity of the conditions are estimated by the statistics of the indices of the store. If a condition is not
+// indexed, then a rough guess is used based on the type of the condition.
+[[nodiscard]] QueryPlan planQuery(const Query &query, const IStore &store);
+
+} // namespace EntityStore
@@ -1,36 +1,67 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <memory>
 #include <optional>
-#include <set>
+#include <span>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <robin_hood.h>
+
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/Batch.hpp"
+#include "EntityStore/Internal/EmptySlots.hpp"
 #include "EntityStore/Internal/Entity.hpp"
 #include "EntityStore/Internal/EntityPredicate.hpp"
 #include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
 #include "EntityStore/Properties.hpp"
 
 namespace EntityStore {
 
+// The id index maps the ids to the slots of the entities. The store does a lookup in it for every access by id, so its
+// performance dominates the point lookups. The flat map stores the entries inline, therefore a lookup usually touches
+// a single cache line, while the node based standard map needs at least one more indirection for every lookup.
+struct FlatIdIndex {
+  using Map = robin_hood::unordered_flat_map<EntityId, size_t>;
+};
+
+struct NodeIdIndex {
+  using Map = std::unordered_map<EntityId, size_t>;
+};
+
 // This is a basic implementation for IStore: it just implements the absolute necessary functionality to be able to
 // behave as an IStore.
 
-class RootStore : public IStore {
+template <typename TIdIndex>
+class BasicRootStore : public IStore {
 private:
   static_assert((sizeof(Entity) + sizeof(void *)) == sizeof(std::optional<Entity>),
                 "The overhead of optional is too big!");
-  using EntityVector = std::vector<std::optional<Entity>>;
 
 public:
-  using Iterator = EntityVector::iterator;
-  using ConstIterator = EntityVector::const_iterator;
+  using EntityVector = std::vector<std::optional<Entity>>;
+  using Iterator = typename EntityVector::iterator;
+  using ConstIterator = typename EntityVector::const_iterator;
+
+  BasicRootStore() = default;
+  BasicRootStore(const BasicRootStore &) = default;
+  BasicRootStore(BasicRootStore &&) = default;
+  BasicRootStore &operator=(const BasicRootStore &) = default;
+  BasicRootStore &operator=(BasicRootStore &&) = default;
+  ~BasicRootStore() override = default;
 
-  RootStore() = default;
-  RootStore(const RootStore &) = default;
-  RootStore(RootStore &&) = default;
-  RootStore &operator=(const RootStore &) = default;
-  RootStore &operator=(RootStore &&) = default;
-  ~RootStore() override = default;
+  // Takes over the entities without inserting them one by one, so their ids must be unique. The const char * properties
+  // of the entities might point into the interned strings, therefore the store keeps them alive.
+  [[nodiscard]] static BasicRootStore fromUniqueEntities(EntityVector &&entities,
+                                                         std::shared_ptr<const std::string> internedStrings);
+
+  // The const char * properties don't own the pointed strings. The stores that are loaded from persisted data have to
+  // keep alive the strings they point to.
+  void keepAlive(std::shared_ptr<const std::string> strings);
 
   bool insert(const EntityId id, Properties &&properties) override;
   bool insert(const EntityId id, const Properties &properties) override;
@@ -44,11 +75,47 @@ public:
 
   bool remove(const EntityId id) override;
 
-  std::unordered_set<EntityId> filterIds(const EntityPredicate &predicate) const override;
+  BatchResult insertBatch(std::span<Entity> entities) override;
+  BatchResult insertBatch(std::span<const Entity> entities) override;
+  BatchResult updateBatch(std::span<Entity> entities) override;
+  BatchResult updateBatch(std::span<const Entity> entities) override;
+  BatchResult removeBatch(std::span<const EntityId> ids) override;
+
+  void applyChanges(ChangeSet &&changes) override;
+
+  EntityIdSet filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const override;
+  EntityIdSet filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                        const QueryExecutor *executor) const override;
+  std::optional<IndexEstimate> estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const override;
+  AnyAggregator aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                          const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const override;
+
+  [[nodiscard]] const RootStore *asRootStore() const override;
+  [[nodiscard]] const NestedStore *asNestedStore() const override;
+
+  // The virtual filterIds functions are implemented by these with EntityPredicate as the predicate type.
+  template <EntityPredicateLike TPredicate>
+  [[nodiscard]] EntityIdSet filterIdsInlined(const TPredicate &predicate, const QueryExecutor *executor) const;
+  template <EntityPredicateLike TPredicate>
+  [[nodiscard]] EntityIdSet filterIdsInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                             const QueryExecutor *executor) const;
+
+  // Folds the matching entities into a copy of the empty aggregator. If the aggregator needs only the first entities in
+  // the order of a property and there is no lookup, then the ordered index of the property is walked if there is one.
+  template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregateInlined(const TPredicate &predicate, const TAggregator &emptyAggregator,
+                                             const QueryExecutor *executor) const;
+  template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregateInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                             const TAggregator &emptyAggregator, const QueryExecutor *executor) const;
+
+  bool createIndex(const PropertyId propertyId, const IndexType indexType) override;
+  bool dropIndex(const PropertyId propertyId) override;
 
   void commit() override;
   void rollback() override;
   void shrink() override;
+  bool compact(const size_t maxMovedEntities) override;
 
   [[nodiscard]] Iterator begin();
   [[nodiscard]] Iterator end();
@@ -56,7 +123,9 @@ public:
   [[nodiscard]] ConstIterator end() const;
 
 private:
-  using IdToIndexMap = std::unordered_map<EntityId, size_t>;
+  using IdToIndexMap = typename TIdIndex::Map;
+
+  void removeTrailingEmptySlots();
 
   // Using a map as index on top of a vector is almost forge the best of the two:
   //  * The map provides O(1) lookup time in best scenario, and O(n) in the worst. The worst means every EntityId in
@@ -66,9 +135,147 @@ private:
   EntityVector m_entities;
   IdToIndexMap m_entityIndexById;
 
-  // By keeping the empty indices sorted and using always its first element helps to concentrate the Entities closer in
-  // the memory, which might provide some performance benefits. To say more some measurement should be done.
-  std::set<size_t> m_emptyIndices;
+  // By using always the smallest empty slot helps to concentrate the Entities closer in the memory, which might provide
+  // some performance benefits. It also makes the incremental compaction simpler, see compact.
+  EmptySlots m_emptySlots;
+
+  // The indices are optional, because keeping them up-to-date makes every modification more expensive. Therefore it
+  // is the user's responsibility to decide which properties are worth to be indexed.
+  PropertyIndices m_propertyIndices;
+
+  // Only the stores loaded from persisted data own strings, see keepAlive.
+  std::vector<std::shared_ptr<const std::string>> m_ownedStrings;
 };
 
+// Every chunk of the parallel scans is evaluated by this function, so it uses the chunk predicate.
+template <EntityPredicateLike TPredicate, typename TFunc>
+void forEachMatchingEntity(const std::vector<std::optional<Entity>> &entities, const size_t begin, const size_t end,
+                           const TPredicate &predicate, TFunc &&func) {
+  withChunkPredicate(predicate, [&entities, begin, end, &func](const auto &chunkPredicate) {
+    for (auto index = begin; index < end; ++index) {
+      const auto &entityHolder = entities[index];
+      if (!entityHolder.has_value()) {
+        continue;
+      }
+      const auto &entity = *entityHolder;
+      if (chunkPredicate(entity.id(), entity.properties())) {
+        func(entity);
+      }
+    }
+  });
+}
+
+template <typename TIdIndex>
+template <EntityPredicateLike TPredicate>
+EntityIdSet BasicRootStore<TIdIndex>::filterIdsInlined(const TPredicate &predicate,
+                                                       const QueryExecutor *executor) const {
+  std::vector<EntityId> result;
+  if (executor == nullptr) {
+    forEachMatchingEntity(m_entities, 0U, m_entities.size(), predicate,
+                          [&result](const Entity &entity) { result.push_back(entity.id()); });
+    return EntityIdSet::fromUnsorted(std::move(result));
+  }
+
+  // Every chunk collects its results into its own buffer, so the threads don't have to synchronize with each other.
+  // The buffers are concatenated on the calling thread after all of the chunks are finished.
+  std::vector<std::vector<EntityId>> chunkResults(executor->numberOfChunks(m_entities.size()));
+  executor->forEachChunk(m_entities.size(), [this, &predicate, &chunkResults](const size_t chunkIndex,
+                                                                               const size_t begin, const size_t end) {
+    auto &chunkResult = chunkResults[chunkIndex];
+    forEachMatchingEntity(m_entities, begin, end, predicate,
+                          [&chunkResult](const Entity &entity) { chunkResult.push_back(entity.id()); });
+  });
+
+  size_t numberOfMatchingEntities{0U};
+  for (const auto &chunkResult: chunkResults) {
+    numberOfMatchingEntities += chunkResult.size();
+  }
+  result.reserve(numberOfMatchingEntities);
+  for (const auto &chunkResult: chunkResults) {
+    result.insert(result.end(), chunkResult.begin(), chunkResult.end());
+  }
+  return EntityIdSet::fromUnsorted(std::move(result));
+}
+
+template <typename TIdIndex>
+template <EntityPredicateLike TPredicate>
+EntityIdSet BasicRootStore<TIdIndex>::filterIdsInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                                       const QueryExecutor *executor) const {
+  const auto *propertyIndex = m_propertyIndices.tryGet(lookup.propertyId);
+  if (propertyIndex == nullptr || !propertyIndex->canServe(lookup)) {
+    return filterIdsInlined(predicate, executor);
+  }
+
+  auto candidates = propertyIndex->find(lookup);
+  const auto newEnd = std::remove_if(candidates.begin(), candidates.end(), [this, &predicate](const EntityId id) {
+    return !predicate(id, m_entities[m_entityIndexById.at(id)]->properties());
+  });
+  candidates.erase(newEnd, candidates.end());
+  return EntityIdSet::fromUnsorted(std::move(candidates));
+}
+
+template <typename TIdIndex>
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator BasicRootStore<TIdIndex>::aggregateInlined(const TPredicate &predicate, const TAggregator &emptyAggregator,
+                                                       const QueryExecutor *executor) const {
+  auto result = emptyAggregator;
+  if constexpr (IndexOrderedAggregator<TAggregator>) {
+    const auto *propertyIndex = m_propertyIndices.tryGet(result.orderPropertyId());
+    if (propertyIndex != nullptr && propertyIndex->type() == IndexType::Ordered) {
+      propertyIndex->forEachInOrder(result.indexStart(), result.order(), [this, &predicate, &result](const EntityId id) {
+        const auto &properties = m_entities[m_entityIndexById.at(id)]->properties();
+        if (predicate(id, properties)) {
+          result.add(id, properties);
+        }
+        return !result.isFull();
+      });
+      return result;
+    }
+  }
+
+  if (executor == nullptr) {
+    forEachMatchingEntity(m_entities, 0U, m_entities.size(), predicate,
+                          [&result](const Entity &entity) { result.add(entity.id(), entity.properties()); });
+    return result;
+  }
+
+  // Same as filterIdsInlined, every chunk has its own aggregator, they are merged on the calling thread.
+  std::vector<TAggregator> chunkAggregators(executor->numberOfChunks(m_entities.size()), emptyAggregator);
+  executor->forEachChunk(
+      m_entities.size(), [this, &predicate, &chunkAggregators](const size_t chunkIndex, const size_t begin,
+                                                               const size_t end) {
+        auto &chunkAggregator = chunkAggregators[chunkIndex];
+        forEachMatchingEntity(m_entities, begin, end, predicate, [&chunkAggregator](const Entity &entity) {
+          chunkAggregator.add(entity.id(), entity.properties());
+        });
+      });
+  for (const auto &chunkAggregator: chunkAggregators) {
+    result.merge(chunkAggregator);
+  }
+  return result;
+}
+
+template <typename TIdIndex>
+template <EntityPredicateLike TPredicate, EntityAggregator TAggregator>
+TAggregator BasicRootStore<TIdIndex>::aggregateInlined(const TPredicate &predicate, const IndexLookup &lookup,
+                                                       const TAggregator &emptyAggregator,
+                                                       const QueryExecutor *executor) const {
+  const auto *propertyIndex = m_propertyIndices.tryGet(lookup.propertyId);
+  if (propertyIndex == nullptr || !propertyIndex->canServe(lookup)) {
+    return aggregateInlined(predicate, emptyAggregator, executor);
+  }
+
+  auto result = emptyAggregator;
+  for (const auto id: propertyIndex->find(lookup)) {
+    const auto &properties = m_entities[m_entityIndexById.at(id)]->properties();
+    if (predicate(id, properties)) {
+      result.add(id, properties);
+    }
+  }
+  return result;
+}
+
+extern template class BasicRootStore<FlatIdIndex>;
+extern template class BasicRootStore<NodeIdIndex>;
+
 } // namespace EntityStore
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+
+namespace EntityStore {
+
+// A snapshot is a compact binary image of the entities of a store. All of the numbers are stored in little endian byte
+// order (see BinaryFormat.hpp):
+//  * header: magic bytes, format version (uint32), the sequence number of the last write-ahead log record that is
+//  included in the snapshot (uint64), number of interned strings (uint64), number of entities (uint64)
+//  * interned strings: the distinct values of the const char * properties, each as a uint32 length and the characters
+//  * entities in ascending id order: id (uint64), the mask of the present properties (uint32, the bit of the property
+//  id is set) and the values of the present properties in the order of their ids. A std::string is stored as a uint32
+//  length and the characters, a double as its 8 bytes, and a const char * as the uint32 index of the interned string.
+//
+// The snapshot is written into a temporary file first, so a crash during saving doesn't corrupt an earlier snapshot.
+void saveSnapshot(const IStore &store, const std::filesystem::path &path, const uint64_t logSequenceNumber = 0U);
+
+struct LoadedSnapshot {
+  RootStore store;
+  // The records of the write-ahead log up to this sequence number are already included in the snapshot.
+  uint64_t logSequenceNumber;
+};
+
+// The file is memory mapped and the entities are constructed directly into the storage of the RootStore, so loading
+// doesn't have to check the ids one by one as insert does. Throws InvalidPersistedDataException if the file is not a
+// valid snapshot.
+[[nodiscard]] LoadedSnapshot loadSnapshot(const std::filesystem::path &path);
+
+} // namespace EntityStore
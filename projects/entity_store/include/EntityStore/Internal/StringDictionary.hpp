@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace EntityStore {
+
+// Stores every distinct string once and identifies them by a dense 32-bit code, so a column of strings can be stored
+// as a column of codes. The equality of two encoded strings is the equality of their codes. The strings are never
+// removed from the dictionary one by one, the unused ones can be dropped by building a new dictionary.
+class StringDictionary {
+public:
+  using Code = uint32_t;
+
+  StringDictionary() = default;
+  // The map points into the strings, so it has to be rebuilt for the copy.
+  StringDictionary(const StringDictionary &other);
+  StringDictionary(StringDictionary &&) = default;
+  StringDictionary &operator=(const StringDictionary &other);
+  StringDictionary &operator=(StringDictionary &&) = default;
+  ~StringDictionary() = default;
+
+  // Returns the code of the string, and adds it to the dictionary if it is not there yet.
+  [[nodiscard]] Code encode(const std::string &value);
+  [[nodiscard]] std::optional<Code> tryFind(const std::string_view value) const;
+  [[nodiscard]] const std::string &decode(const Code code) const;
+  [[nodiscard]] size_t size() const;
+
+private:
+  // The elements of a deque are not moved when it grows, so the keys of the map can point into them.
+  std::deque<std::string> m_strings;
+  std::unordered_map<std::string_view, Code> m_codeByString;
+};
+
+} // namespace EntityStore
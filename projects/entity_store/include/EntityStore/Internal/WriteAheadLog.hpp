@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "EntityStore/Internal/BinaryFormat.hpp"
+#include "EntityStore/Internal/ChangeSet.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/FileIO.hpp"
+#include "EntityStore/Properties.hpp"
+
+namespace EntityStore {
+
+// Only the replay needs the store, so the implementation of the stores is not included by the users of the options.
+struct FlatIdIndex;
+template <typename TIdIndex>
+class BasicRootStore;
+using RootStore = BasicRootStore<FlatIdIndex>;
+
+struct WriteAheadLogOptions {
+  // The records are written and synced to the disk in groups of this many records. Syncing is by far the most expensive
+  // part of logging, so bigger groups make the modifications cheaper, but the records of the last unfinished group are
+  // lost on a crash. With the default every modification is durable when it returns.
+  size_t groupCommitSize{1U};
+};
+
+enum class LogRecordType : uint8_t {
+  Insert,
+  Update,
+  Remove,
+  // The changes of a committed child store, see ChangeSet.
+  Changes,
+};
+
+// The write-ahead log is a sequence of records, every record describes a single modification of the store. The records
+// are framed, so a record that was torn by a crash can be recognized:
+//  * header: size of the payload (uint32), checksum of the rest of the record (uint32), sequence number (uint64), type
+//  of the record (uint8)
+//  * payload: an Insert or an Update record contains the number of the entities (uint64) and the entities, a Remove
+//  record contains the number of the ids (uint64) and the ids, while a Changes record contains the removed ids, the
+//  updated entities and the inserted entities in this order, each of them prefixed with its size (uint64).
+// An entity is stored similarly to the snapshots (see Snapshot.hpp), except the const char * values are stored
+// inline: a flag (uint8) whether the pointer is null and the string if it isn't.
+//
+// The sequence numbers of the records are increasing one by one, even after the log is truncated, so the snapshots can
+// remember which records they already contain.
+class WriteAheadLog {
+public:
+  // The records are appended to the end of the file. Their numbering is continued from lastLogSequenceNumber.
+  WriteAheadLog(std::filesystem::path path, const WriteAheadLogOptions &options, const uint64_t lastLogSequenceNumber);
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog(WriteAheadLog &&) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(WriteAheadLog &&) = delete;
+  // Syncs the unfinished group. The errors are swallowed, call sync explicitly to get them reported.
+  ~WriteAheadLog();
+
+  // The payload of the record has to be written into the returned writer. It is encoded before the modification is
+  // applied, because the properties might be moved into the store, therefore the record has to be either finished or
+  // canceled depending on the result of the modification.
+  [[nodiscard]] BinaryWriter &startRecord(const LogRecordType type);
+  // Throws InvalidPersistedDataException if the started record is too big to be logged. The record stays started, so
+  // it can be canceled. It makes possible to reject a modification before it is applied.
+  void checkRecordSize() const;
+  // Throws InvalidPersistedDataException if the record is too big, in that case the record stays started. Throws
+  // std::system_error if the group of the record is full and it cannot be synced, in that case the record is already
+  // finished, but it might not be written to the file.
+  void finishRecord();
+  void cancelRecord();
+
+  // Writes and syncs the finished records of the unfinished group.
+  void sync();
+  // Drops every record, e.g. after they were saved into a snapshot. The numbering of the records is continued.
+  void truncate();
+
+  [[nodiscard]] uint64_t lastLogSequenceNumber() const;
+
+private:
+  std::filesystem::path m_path;
+  WriteAheadLogOptions m_options;
+  OutputFile m_file;
+  // The finished records of the unfinished group, followed by the started record if there is any.
+  BinaryWriter m_buffer;
+  size_t m_recordStart{0U};
+  bool m_hasStartedRecord{false};
+  size_t m_numberOfBufferedRecords{0U};
+  uint64_t m_lastLogSequenceNumber;
+};
+
+void writeLogEntity(BinaryWriter &writer, const EntityId id, const Properties &properties);
+void writeLogEntities(BinaryWriter &writer, std::span<const Entity> entities);
+void writeLogIds(BinaryWriter &writer, std::span<const EntityId> ids);
+void writeLogChanges(BinaryWriter &writer, const ChangeSet &changes);
+
+struct LogReplayResult {
+  uint64_t lastLogSequenceNumber;
+  // The size of the valid part of the log. If it is smaller than the size of the file, then the last record was torn,
+  // so the rest of the file has to be truncated before new records are appended.
+  size_t validSize;
+  size_t numberOfReplayedRecords;
+};
+
+// Applies the records after afterLogSequenceNumber to the store. The replay stops at the first torn or corrupted
+// record, because the records after it cannot be trusted. The const char * values of the records are owned by the
+// store. If the file doesn't exist, then nothing is replayed.
+[[nodiscard]] LogReplayResult replayWriteAheadLog(const std::filesystem::path &path, RootStore &store,
+                                                  const uint64_t afterLogSequenceNumber);
+
+} // namespace EntityStore
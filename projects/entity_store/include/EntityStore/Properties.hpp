@@ -1,20 +1,33 @@
 #pragma once
 
+#include <array>
+#include <bitset>
+#include <cmath>
 #include <concepts>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string_view>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
 
 #include "EntityStore/Property.hpp"
 
 namespace EntityStore {
 
+// A set of properties, the bit of a property is at the position of its id.
+using PropertyMask = std::bitset<asUnderlying(PropertyId::LAST) + 1>;
+
 class DoesNotHavePropertyException : public std::out_of_range {
 public:
   explicit DoesNotHavePropertyException(const std::string_view propertyName);
 };
 
+class InvalidPropertyValueException : public std::invalid_argument {
+public:
+  explicit InvalidPropertyValueException(const std::string_view propertyName);
+};
+
 // Represents a set of properties in a (key, value) format. It's interface is type safe in a way that a value identified
 // by a key can hold only the type that the key is associated with. The setter/getter where the property id is a
 // template parameter will cause a compile time error if one of the set/get calls don't conform the type system. On top
@@ -26,9 +39,15 @@ public:
 // If this functionality is really needed, then it can be done. The reason behind this decision is in that way it is
 // much clearer how to use this class, and its also reduces the possibility of runtime errors.
 
+// The setters throw InvalidPropertyValueException for NaN values, because NaN is not equal to itself and it is not
+// ordered, so the indices couldn't find or order the entities by it.
+
+// As the property ids are dense and known at compile time, every property has its own slot, so there is no need for
+// hashing or allocating nodes when a property is set or looked up.
+
 class Properties {
 public:
-  using PropertyMap = std::unordered_map<PropertyId, Property>;
+  using PropertySlots = std::array<std::optional<Property>, asUnderlying(PropertyId::LAST) + 1>;
 
   Properties() = default;
   Properties(const Properties &) = default;
@@ -41,17 +60,25 @@ public:
   void update(const Properties &properties);
   void update(Properties &&properties);
 
+  // Returns the ids of the properties that are set.
+  [[nodiscard]] PropertyMask mask() const;
+  // Moves the properties that are in the mask into a new Properties, e.g. to pass on only the changed properties of an
+  // entity without copying the rest of them.
+  [[nodiscard]] Properties extract(const PropertyMask &propertyIds) &&;
+
   friend bool operator==(const Properties &lhs, const Properties &rhs);
 
   template <PropertyId Id>
   Properties &set(const PropertyValueType<Id> &value) {
-    m_propertyMap.insert_or_assign(Id, value);
+    checkValue(Id, value);
+    getSlot(Id).emplace(std::in_place_type<PropertyValueType<Id>>, value);
     return *this;
   }
 
   template <PropertyId Id>
   Properties &set(PropertyValueType<Id> &&value) {
-    m_propertyMap.insert_or_assign(Id, std::move(value));
+    checkValue(Id, value);
+    getSlot(Id).emplace(std::in_place_type<PropertyValueType<Id>>, std::move(value));
     return *this;
   }
 
@@ -61,8 +88,9 @@ public:
     static_assert(isPropertyMember<TPropertyValueType>(), "the requested type cannot be contained by Property");
 
     checkPropertyType<TPropertyValueType>(propertyId);
+    checkValue(propertyId, value);
 
-    m_propertyMap.insert_or_assign(propertyId, std::forward<TProperty>(value));
+    getSlot(propertyId).emplace(std::in_place_type<TPropertyValueType>, std::forward<TProperty>(value));
     return *this;
   }
 
@@ -112,12 +140,29 @@ public:
   }
 
 private:
+  template <typename TProperty>
+  static void checkValue(const PropertyId propertyId, const TProperty &value) {
+    if constexpr (std::is_floating_point_v<TProperty>) {
+      if (std::isnan(value)) {
+        throw InvalidPropertyValueException(getPropertyName(propertyId));
+      }
+    }
+  }
+
+  [[nodiscard]] std::optional<Property> &getSlot(PropertyId propertyId) {
+    return m_propertySlots[asUnderlying(propertyId)];
+  }
+
+  [[nodiscard]] const std::optional<Property> &getSlot(PropertyId propertyId) const {
+    return m_propertySlots[asUnderlying(propertyId)];
+  }
+
   [[nodiscard]] const Property *tryGetProperty(PropertyId propertyId) const {
-    auto it = m_propertyMap.find(propertyId);
-    if (it == m_propertyMap.end()) {
+    const auto &slot = getSlot(propertyId);
+    if (!slot.has_value()) {
       return nullptr;
     }
-    return &it->second;
+    return &*slot;
   }
 
   [[nodiscard]] const Property &getProperty(PropertyId propertyId) const {
@@ -150,7 +195,7 @@ private:
     return std::get<TProperty>(getProperty(propertyId));
   }
 
-  PropertyMap m_propertyMap;
+  PropertySlots m_propertySlots;
 };
 
 template <typename T>
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/Properties.hpp"
+#include "EntityStore/Property.hpp"
+
+namespace EntityStore {
+
+// Describes a compound query: equality, range and presence conditions combined by AND, OR and NOT. It is only a
+// description, so it can be built once and evaluated against multiple stores by Store::filter. The store decides the
+// order in which the conditions are evaluated, so the order in which the query is built doesn't matter.
+//
+// Similarly to the query functions of Store, the conditions where the property id is a template parameter are checked
+// in compile time, while the ones with the "As" suffix are checked in runtime. The values are always stored as the type
+// of the property.
+class Query {
+public:
+  enum class Kind {
+    // The property has a value that is equal to the specified value.
+    Equal,
+    // The property has a value in the [minValue, maxValue) range.
+    Range,
+    // The property has a value.
+    Present,
+    And,
+    Or,
+    Not,
+  };
+
+  Query() = delete;
+  Query(const Query &) = default;
+  Query(Query &&) = default;
+  Query &operator=(const Query &) = default;
+  Query &operator=(Query &&) = default;
+  ~Query() = default;
+
+  template <PropertyId Id>
+  [[nodiscard]] static Query equal(PropertyValueType<Id> value) {
+    return Query{Kind::Equal, Id, Property{std::in_place_type<PropertyValueType<Id>>, std::move(value)}, std::nullopt};
+  }
+
+  template <typename TProperty>
+  [[nodiscard]] static Query equalAs(const PropertyId propertyId, TProperty value) {
+    static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
+
+    checkPropertyType<TProperty>(propertyId);
+
+    return Query{Kind::Equal, propertyId, Property{std::in_place_type<TProperty>, std::move(value)}, std::nullopt};
+  }
+
+  template <PropertyId Id>
+  [[nodiscard]] static Query inRange(PropertyValueType<Id> minValue, PropertyValueType<Id> maxValue) {
+    return Query{Kind::Range, Id, Property{std::in_place_type<PropertyValueType<Id>>, std::move(minValue)},
+                 Property{std::in_place_type<PropertyValueType<Id>>, std::move(maxValue)}};
+  }
+
+  template <typename TProperty>
+  [[nodiscard]] static Query inRangeAs(const PropertyId propertyId, TProperty minValue, TProperty maxValue) {
+    static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
+
+    checkPropertyType<TProperty>(propertyId);
+
+    return Query{Kind::Range, propertyId, Property{std::in_place_type<TProperty>, std::move(minValue)},
+                 Property{std::in_place_type<TProperty>, std::move(maxValue)}};
+  }
+
+  [[nodiscard]] static Query has(const PropertyId propertyId);
+
+  // An empty allOf matches every entity, while an empty anyOf matches none of them.
+  [[nodiscard]] static Query allOf(std::vector<Query> queries);
+  [[nodiscard]] static Query anyOf(std::vector<Query> queries);
+
+  // The nested ANDs and ORs are flattened, so a && b && c results in a single AND with three operands.
+  friend Query operator&&(Query lhs, Query rhs);
+  friend Query operator||(Query lhs, Query rhs);
+  friend Query operator!(Query query);
+
+  [[nodiscard]] Kind kind() const;
+  [[nodiscard]] bool isCondition() const;
+  // The property id and the values are meaningful only for the conditions (Equal, Range and Present).
+  [[nodiscard]] PropertyId propertyId() const;
+  // The value of an Equal condition or the minimum value of a Range condition.
+  [[nodiscard]] const Property &value() const;
+  [[nodiscard]] const std::optional<Property> &maxValue() const;
+  // The operands of And, Or and Not.
+  [[nodiscard]] const std::vector<Query> &operands() const;
+
+  [[nodiscard]] bool matches(const Properties &properties) const;
+
+private:
+  Query(const Kind kind, const PropertyId propertyId, Property value, std::optional<Property> maxValue);
+  Query(const Kind kind, std::vector<Query> operands);
+
+  [[nodiscard]] static Query combine(const Kind kind, Query lhs, Query rhs);
+
+  Kind m_kind;
+  PropertyId m_propertyId{};
+  Property m_value{};
+  std::optional<Property> m_maxValue{};
+  std::vector<Query> m_operands{};
+};
+
+} // namespace EntityStore
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/Entity.hpp"
+#include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/Instrumentation.hpp"
+#include "EntityStore/Internal/QueryPlan.hpp"
+#include "EntityStore/QueryExecutor.hpp"
+
+namespace EntityStore {
+
+// Scans the store for a batch of a cursor. It is defined in QueryCursor.cpp, where the scans are compiled for every
+// StoreAggregator, so this header doesn't have to include the stores.
+[[nodiscard]] StoreAggregator aggregateCursorBatch(const IStore &store, const QueryPlan &plan,
+                                                   const StoreAggregator &emptyAggregator,
+                                                   const QueryExecutor *executor, Instrumentation *instrumentation);
+
+// Returns the entities that match a query in batches, it can be created by Store::cursor and Store::orderedCursor.
+//
+// Every batch is a top-K query that starts after the last entity of the previous batch, so a batch is O(N log K) (or
+// less if an ordered index of the property can be walked from the last entity) and the cursor holds only the last key
+// it returned, no matter how many entities match the query. The price is that every batch scans the store again if no
+// ordered index can be walked.
+//
+// The cursor doesn't pin the state of the store, every batch is evaluated on the state of the store when it is
+// requested. So the removed entities are never returned, but an entity whose order changes between two batches might be
+// skipped or returned again.
+template <typename TOrderAggregator>
+class QueryCursor {
+public:
+  // The batches are recorded as queries into the instrumentation if it is not null.
+  QueryCursor(const IStore &store, QueryPlan plan, TOrderAggregator emptyAggregator, const QueryExecutor *executor,
+              Instrumentation *instrumentation = nullptr)
+    : m_store{&store}
+    , m_plan{std::move(plan)}
+    , m_nextBatch{std::move(emptyAggregator)}
+    , m_executor{executor}
+    , m_instrumentation{instrumentation} {
+  }
+
+  // Returns the ids of the next batch in order. If the batch is smaller than the batch size (e.g. empty), then there
+  // are no more matching entities, so the next calls return empty batches without querying the store.
+  [[nodiscard]] std::vector<EntityId> next() {
+    if (m_finished) {
+      return {};
+    }
+    auto batch = aggregate(m_nextBatch);
+    m_finished = !batch.isFull();
+    auto keys = std::move(batch).result();
+    if (keys.empty()) {
+      m_finished = true;
+      return {};
+    }
+    std::vector<EntityId> ids;
+    ids.reserve(keys.size());
+    for (const auto &key: keys) {
+      ids.push_back(TOrderAggregator::idOf(key));
+    }
+    m_nextBatch.startAfter(std::move(keys.back()));
+    return ids;
+  }
+
+  [[nodiscard]] bool isFinished() const {
+    return m_finished;
+  }
+
+private:
+  [[nodiscard]] TOrderAggregator aggregate(const TOrderAggregator &emptyAggregator) const {
+    return std::get<TOrderAggregator>(
+        aggregateCursorBatch(*m_store, m_plan, StoreAggregator{std::in_place_type<TOrderAggregator>, emptyAggregator},
+                             m_executor, m_instrumentation));
+  }
+
+  const IStore *m_store;
+  QueryPlan m_plan;
+  // The next batch starts from it, it remembers the last key of the previous batch.
+  TOrderAggregator m_nextBatch;
+  const QueryExecutor *m_executor;
+  Instrumentation *m_instrumentation;
+  bool m_finished{false};
+};
+
+} // namespace EntityStore
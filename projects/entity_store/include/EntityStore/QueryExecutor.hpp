@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "utils/tasks/TaskStealingTaskSystem.hpp"
+
+namespace EntityStore {
+
+// Evaluates the queries on multiple threads: the entities are split into chunks and the chunks are evaluated by the
+// workers of a thread pool. As creating threads is expensive, an executor should be created once and shared between
+// the stores and queries. It must outlive every store and query that uses it.
+class QueryExecutor {
+public:
+  static constexpr size_t kDefaultMinChunkSize{16U * 1024U};
+
+  // The chunks contain at least minChunkSize entities, so the small stores are evaluated on the calling thread, because
+  // distributing the work would take more time than the evaluation itself.
+  explicit QueryExecutor(const unsigned numberOfThreads = std::thread::hardware_concurrency(),
+                         const size_t minChunkSize = kDefaultMinChunkSize);
+
+  QueryExecutor(const QueryExecutor &) = delete;
+  QueryExecutor(QueryExecutor &&) = delete;
+  QueryExecutor &operator=(const QueryExecutor &) = delete;
+  QueryExecutor &operator=(QueryExecutor &&) = delete;
+  ~QueryExecutor() = default;
+
+  [[nodiscard]] unsigned numberOfThreads() const;
+  [[nodiscard]] size_t minChunkSize() const;
+
+  [[nodiscard]] size_t numberOfChunks(const size_t numberOfItems) const;
+
+  // Calls the function with (chunkIndex, begin, end) for every chunk of [0, numberOfItems) and waits until all of them
+  // are finished. If there is only one chunk, then the function is called on the calling thread.
+  template <typename TFunc>
+  void forEachChunk(const size_t numberOfItems, const TFunc &func) const {
+    const auto chunkCount = numberOfChunks(numberOfItems);
+    if (chunkCount <= 1U) {
+      func(size_t{0U}, size_t{0U}, numberOfItems);
+      return;
+    }
+    const auto chunkSize = (numberOfItems + chunkCount - 1U) / chunkCount;
+    m_taskSystem->runAndWait(chunkCount, [&func, chunkSize, numberOfItems](const size_t chunkIndex) {
+      const auto begin = std::min(chunkIndex * chunkSize, numberOfItems);
+      func(chunkIndex, begin, std::min(begin + chunkSize, numberOfItems));
+    });
+  }
+
+private:
+  // The chunks have roughly the same size, so there is no need for aggressive stealing.
+  using TaskSystem = utils::tasks::TaskStealingTaskSystem<2>;
+
+  // Scheduling tasks modifies the task system, but it doesn't affect the observable state of the executor, so the
+  // queries can be const. The pointer doesn't propagate constness, which is exactly what is needed here.
+  std::unique_ptr<TaskSystem> m_taskSystem;
+  size_t m_minChunkSize;
+};
+
+// Controls how a single query is evaluated. By default the query uses the executor of the store.
+struct QueryOptions {
+  // If it has a value, then it overrides the executor of the store for the query. A nullptr means sequential
+  // evaluation.
+  std::optional<const QueryExecutor *> executor{};
+
+  [[nodiscard]] static QueryOptions sequential();
+  [[nodiscard]] static QueryOptions parallel(const QueryExecutor &executor);
+};
+
+} // namespace EntityStore
@@ -1,17 +1,49 @@
 #pragma once
 
+#include <algorithm>
+#include <filesystem>
 #include <memory>
-#include <unordered_set>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include "EntityStore/ChangeStream.hpp"
+#include "EntityStore/EntityIdSet.hpp"
+#include "EntityStore/Internal/Aggregation.hpp"
+#include "EntityStore/Internal/Batch.hpp"
 #include "EntityStore/Internal/Entity.hpp"
 #include "EntityStore/Internal/EntityPredicate.hpp"
 #include "EntityStore/Internal/IStore.hpp"
+#include "EntityStore/Internal/Instrumentation.hpp"
+#include "EntityStore/Internal/PropertyIndex.hpp"
+#include "EntityStore/Internal/QueryPlan.hpp"
+#include "EntityStore/Internal/WriteAheadLog.hpp"
 #include "EntityStore/Properties.hpp"
+#include "EntityStore/Query.hpp"
+#include "EntityStore/QueryCursor.hpp"
+#include "EntityStore/QueryExecutor.hpp"
 #include "EntityStore/StoreExceptions.hpp"
+#include "EntityStore/StoreStatistics.hpp"
 
 namespace EntityStore {
 
+class ConcurrentStore;
+class LoggingStore;
+class NestedStore;
+class ObservedStore;
+class OptimisticStore;
+
+enum class StoreBackend {
+  // Stores the entities as rows, so accessing the entities is fast. Supports secondary indices.
+  RowBased,
+  // Stores every property in its own column, so the queries without indices are faster, but the whole entities are
+  // more expensive to access. Doesn't support secondary indices.
+  Columnar,
+};
+
 // This class provides checked access to the IStore interface. It translates the query calls to functor objects to
 // receive the requested id-s from the IStore.
 class Store {
@@ -36,6 +68,20 @@ public:
   ~Store() = default;
 
   [[nodiscard]] static Store create();
+  [[nodiscard]] static Store create(const StoreBackend backend);
+  // Creates a row based store that can be read by many threads while it is modified. The modifications are done through
+  // the returned store by a single thread, and they become visible to the readers on commit. The readers read through
+  // the stores that are returned by readSnapshot, which never wait for the writer. On the other hand, commit waits
+  // until the snapshots of the previously committed state are destroyed, so the snapshots should be short lived. The
+  // writer thread must destroy its own snapshots before commit, otherwise the commit throws std::logic_error instead of
+  // waiting for them forever.
+  [[nodiscard]] static Store createConcurrent();
+  // Creates a row based store whose child stores are optimistic transactions: they can be created and used from
+  // different threads at the same time (a single transaction is still used by a single thread). The transactions don't
+  // block each other, instead their commit fails by TransactionConflictException if an entity they read or wrote was
+  // modified by another commit since they started. A failed transaction is rolled back, so it can be retried from
+  // scratch.
+  [[nodiscard]] static Store createTransactional();
 
   // Getting the Entity id as const lvalue might not make sense at first glance, but:
   //  * The entity id must always have a value => get it by value or by reference
@@ -45,7 +91,8 @@ public:
   //  etc.) => const value
   template <SameAsProperties TProperties>
   bool insert(const EntityId id, TProperties &&properties) {
-    return m_store->insert(id, std::forward<TProperties>(properties));
+    return instrument(m_instrumentation.get(), StoreOperation::Insert,
+                      [&] { return m_store->insert(id, std::forward<TProperties>(properties)); });
   }
 
   // Some people might be freaked out when they see a raw pointer in modern C++. I (and Herb Sutter
@@ -55,7 +102,8 @@ public:
   // return value of update is nullptr, that means there is no element with the specified id.
   template <SameAsProperties TProperties>
   const Properties *update(const EntityId id, TProperties &&properties) {
-    return m_store->update(id, std::forward<TProperties>(properties));
+    return instrument(m_instrumentation.get(), StoreOperation::Update,
+                      [&] { return m_store->update(id, std::forward<TProperties>(properties)); });
   }
   // TODO(antaljanosbenjamin) Add functionality to delete a property
 
@@ -65,65 +113,145 @@ public:
 
   bool remove(const EntityId id);
 
-  void shrink();
+  // The batch functions are the bulk versions of insert, update and remove. They are much cheaper than calling the
+  // single item functions one by one for big batches, because the store can prepare for the whole batch at once. The
+  // bit of the result at the position of an item is set if the operation succeeded for the item, i.e. the single item
+  // version would have returned true or a non-null pointer. When the entities are passed as an rvalue vector, then
+  // their properties are moved into the store.
+  BatchResult insertBatch(std::span<const Entity> entities);
+  BatchResult insertBatch(std::vector<Entity> &&entities);
+  BatchResult updateBatch(std::span<const Entity> entities);
+  BatchResult updateBatch(std::vector<Entity> &&entities);
+  BatchResult removeBatch(std::span<const EntityId> ids);
 
+  void shrink();
+  // Moves at most the specified number of entities to fill the holes left by the removed entities. Returns true if
+  // there are no holes left, so it can be called regularly (e.g. after every commit) instead of stopping the store for
+  // a full shrink.
+  bool compact(const size_t maxMovedEntities);
+
+  // Saves the entities that are visible through this store (for a child store its uncommitted changes too) into a
+  // compact binary file. The indices and the query executor are not saved.
+  void saveSnapshot(const std::filesystem::path &path) const;
+  // Loads a snapshot into a new row based store. The const char * properties point to strings that are owned by the
+  // loaded store, so they are valid only as long as the store is alive.
+  [[nodiscard]] static Store loadSnapshot(const std::filesystem::path &path);
+
+  // Opens a durable row based store: the snapshot is loaded if it exists, then the modifications that were recorded
+  // into the write-ahead log since the snapshot are replayed on top of it. Every modification of the store (including
+  // the commits of its child stores, which are recorded as a single record) is appended to the log, so the store can be
+  // recovered after a crash. Throws std::system_error if the files cannot be accessed and
+  // InvalidPersistedDataException if they are corrupted.
+  [[nodiscard]] static Store open(const std::filesystem::path &snapshotPath, const std::filesystem::path &logPath,
+                                  const WriteAheadLogOptions &options = {});
+  // Saves the state of the store into the snapshot and truncates the write-ahead log, so the log doesn't grow without
+  // limits and the store can be opened faster. Returns false if the store wasn't opened by open.
+  bool checkpoint();
+  // Makes the modifications durable that are not synced yet because of the group commit. Returns false if the store
+  // wasn't opened by open.
+  bool syncWriteAheadLog();
+
+  // Returns a read only store that sees the last committed state of a concurrent store until it is destroyed. It can be
+  // called from any thread, even while the store is modified. The snapshot must not outlive this store. Its
+  // modifications throw std::logic_error, same as calling this function on a not concurrent store.
+  [[nodiscard]] Store readSnapshot() const;
+
+  // The child stores inherit the query executor of their parent. For a transactional store it can be called from any
+  // thread.
   [[nodiscard]] Store createChild();
 
+  // Subscribes to the modifications of the store: every successful insertion, update and removal is published as a
+  // ChangeEvent into the returned ring buffer, which can be drained by another thread. The events of a batch operation
+  // and of the commit of a child store are published at once. The store never waits for the consumer, if the buffer
+  // is full, then the events are dropped, see ChangeSubscription. The subscription ends when the returned pointer is
+  // released. The child stores that were created before the first subscription commit without publishing events.
+  // Throws std::logic_error for child stores and transactional stores.
+  [[nodiscard]] std::shared_ptr<ChangeSubscription> subscribe(const size_t capacity);
+
+  // Starts to collect statistics about the operations of the store: the latency of every operation, the number of
+  // entities the queries scanned and matched, the number of levels the reads of the child stores traversed and the
+  // size of the commits of the child stores. The child stores and snapshots that are created afterwards record into
+  // the statistics of this store, i.e. they inherit the instrumentation similarly to the query executor. Returns false
+  // if the instrumentation is already enabled (or inherited) or it is compiled out by the ENTITY_STORE_INSTRUMENTATION
+  // CMake option. The disabled instrumentation costs only a null check per operation.
+  bool enableInstrumentation();
+  // Returns nullopt if the instrumentation is not enabled.
+  [[nodiscard]] std::optional<StoreStatistics> statistics() const;
+  void resetStatistics();
+
+  // If a query executor is set, then the queries are evaluated on its threads, unless it is overridden by the options
+  // of the query. The store doesn't own the executor, so it has to outlive the store. Setting nullptr switches back to
+  // sequential queries.
+  void setQueryExecutor(const QueryExecutor *executor);
+  [[nodiscard]] const QueryExecutor *queryExecutor() const;
+
+  // Indices can speed up the queries on the indexed property significantly, but they make the modifications more
+  // expensive. A hash index can be used only by equality queries, while an ordered index can be used by both equality
+  // and range queries. The queries use the indices automatically if possible. Child stores cannot have own indices,
+  // but their queries use the indices of the root store. Returns false if the property is already indexed or the
+  // store doesn't support indices.
+  bool createIndex(const PropertyId propertyId, const IndexType indexType);
+  bool dropIndex(const PropertyId propertyId);
+
   // TODO(antaljanosbenjamin) Conceptify comparable types
+  // The query functions return the ids in an EntityIdSet, which stores them sorted, so the results of different queries
+  // can be combined cheaply by its set operators.
   // Similarly to the setter/getter of Properties class, the query functions of this class is type checked. The ones
   // which get the property id as a template argument can offer compile time type checking, while the queryAs and
   // rangeQuery functions doesn't. In return the property id can be determined in runtime for them.
+  // Every query function accepts QueryOptions to override the query executor of the store for a single query.
   template <PropertyId Id, typename TQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> query(const TQueryValue &queryValue) const {
+  [[nodiscard]] EntityIdSet query(const TQueryValue &queryValue, const QueryOptions &options = {}) const {
 
-    return queryWithoutPropertyTypeCheck<PropertyValueType<Id>, TQueryValue>(Id, queryValue);
+    return queryWithoutPropertyTypeCheck<PropertyValueType<Id>, TQueryValue>(Id, queryValue, options);
   }
 
   template <typename TProperty, typename TQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> queryAs(const PropertyId propertyId, const TQueryValue &queryValue) const {
+  [[nodiscard]] EntityIdSet queryAs(const PropertyId propertyId, const TQueryValue &queryValue,
+                                    const QueryOptions &options = {}) const {
     static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
 
     checkPropertyType<TProperty>(propertyId);
 
-    return queryWithoutPropertyTypeCheck<TProperty, TQueryValue>(propertyId, queryValue);
+    return queryWithoutPropertyTypeCheck<TProperty, TQueryValue>(propertyId, queryValue, options);
   }
 
   template <PropertyId Id, typename TMinQueryValue, typename TMaxQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> rangeQuery(const TMinQueryValue &minValue,
-                                                        const TMaxQueryValue &maxValue) const {
+  [[nodiscard]] EntityIdSet rangeQuery(const TMinQueryValue &minValue, const TMaxQueryValue &maxValue,
+                                       const QueryOptions &options = {}) const {
 
     return rangeQueryWithoutPropertyTypeCheck<PropertyValueType<Id>, TMinQueryValue, TMaxQueryValue>(Id, minValue,
-                                                                                                     maxValue);
+                                                                                                     maxValue, options);
   }
 
   // TODO(antaljanosbenjamin) Make the parameters similar to rangeQuery
   template <PropertyId Id>
-  [[nodiscard]] std::unordered_set<EntityId> checkedRangeQuery(PropertyConstRefType<Id> minValue,
-                                                               PropertyConstRefType<Id> maxValue) const {
+  [[nodiscard]] EntityIdSet checkedRangeQuery(PropertyConstRefType<Id> minValue, PropertyConstRefType<Id> maxValue,
+                                              const QueryOptions &options = {}) const {
     // TODO(antaljanosbenjamin) Make equal values valid
     if (minValue >= maxValue) {
       throw InvalidRangeException();
     }
 
     return rangeQueryWithoutPropertyTypeCheck<PropertyValueType<Id>, PropertyValueType<Id>, PropertyValueType<Id>>(
-        Id, minValue, maxValue);
+        Id, minValue, maxValue, options);
   }
 
   template <typename TProperty, typename TMinQueryValue, typename TMaxQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> rangeQueryAs(const PropertyId propertyId, const TMinQueryValue &minValue,
-                                                          const TMaxQueryValue &maxValue) const {
+  [[nodiscard]] EntityIdSet rangeQueryAs(const PropertyId propertyId, const TMinQueryValue &minValue,
+                                         const TMaxQueryValue &maxValue, const QueryOptions &options = {}) const {
     static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
 
     checkPropertyType<TProperty>(propertyId);
 
     return rangeQueryWithoutPropertyTypeCheck<TProperty, TMinQueryValue, TMaxQueryValue>(propertyId, minValue,
-                                                                                         maxValue);
+                                                                                         maxValue, options);
   }
 
   // TODO(antaljanosbenjamin) Make the parameters similar to rangeQueryAs
   template <typename TProperty>
-  [[nodiscard]] std::unordered_set<EntityId> checkedRangeQueryAs(const PropertyId propertyId, const TProperty &minValue,
-                                                                 const TProperty &maxValue) const {
+  [[nodiscard]] EntityIdSet checkedRangeQueryAs(const PropertyId propertyId, const TProperty &minValue,
+                                                const TProperty &maxValue, const QueryOptions &options = {}) const {
     static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
 
     checkPropertyType<TProperty>(propertyId);
@@ -132,32 +260,174 @@ public:
       throw InvalidRangeException();
     }
 
-    return rangeQueryAs<TProperty, TProperty, TProperty>(propertyId, minValue, maxValue);
+    return rangeQueryAs<TProperty, TProperty, TProperty>(propertyId, minValue, maxValue, options);
   }
+
+  // Evaluates a compound query in a single pass over the entities. The conditions are reordered by their estimated cost
+  // and selectivity, and the most selective indexed condition is used to find the candidates, so the order in which the
+  // query was built doesn't matter.
+  [[nodiscard]] EntityIdSet filter(const Query &query, const QueryOptions &options = {}) const;
+
+  // The aggregations fold the values of the property of the entities that match the query (by default every entity)
+  // inside the scan loops of the stores, so the ids of the matching entities are not collected. The query is planned
+  // the same way as for filter, so the indices are used to find the candidates if possible. The entities that don't
+  // have the property are skipped, e.g. count returns the number of the matching entities that have the property.
+  template <PropertyId Id>
+  [[nodiscard]] size_t count(const Query &query = Query::allOf({}), const QueryOptions &options = {}) const {
+    return aggregate<Id>(query, CountAggregator<PropertyValueType<Id>>{}, options).result();
+  }
+
+  template <PropertyId Id>
+  [[nodiscard]] std::optional<PropertyValueType<Id>> min(const Query &query = Query::allOf({}),
+                                                         const QueryOptions &options = {}) const {
+    static_assert(!std::is_pointer_v<PropertyValueType<Id>>, "The pointers cannot be compared meaningfully");
+    return aggregate<Id>(query, MinAggregator<PropertyValueType<Id>>{}, options).result();
+  }
+
+  template <PropertyId Id>
+  [[nodiscard]] std::optional<PropertyValueType<Id>> max(const Query &query = Query::allOf({}),
+                                                         const QueryOptions &options = {}) const {
+    static_assert(!std::is_pointer_v<PropertyValueType<Id>>, "The pointers cannot be compared meaningfully");
+    return aggregate<Id>(query, MaxAggregator<PropertyValueType<Id>>{}, options).result();
+  }
+
+  template <PropertyId Id>
+  [[nodiscard]] PropertyValueType<Id> sum(const Query &query = Query::allOf({}),
+                                          const QueryOptions &options = {}) const {
+    return aggregate<Id>(query, SumAggregator<PropertyValueType<Id>>{}, options).result();
+  }
+
+  // Returns the number of values in the [bounds[i], bounds[i + 1]) buckets. Throws InvalidRangeException if there are
+  // less than two bounds or they are not strictly increasing.
+  template <PropertyId Id>
+  [[nodiscard]] std::vector<size_t> histogram(std::vector<PropertyValueType<Id>> bounds,
+                                              const Query &query = Query::allOf({}),
+                                              const QueryOptions &options = {}) const {
+    static_assert(!std::is_pointer_v<PropertyValueType<Id>>, "The pointers cannot be compared meaningfully");
+    if (bounds.size() < 2U ||
+        std::adjacent_find(bounds.begin(), bounds.end(), std::greater_equal<>{}) != bounds.end()) {
+      throw InvalidRangeException();
+    }
+    return aggregate<Id>(query, HistogramAggregator<PropertyValueType<Id>>{std::move(bounds)}, options).result();
+  }
+
+  // Returns the (id, value) pairs of the property of the matching entities ordered by their id. Only the value of the
+  // property is copied out of the store instead of the whole properties of the entities, so it is much cheaper than
+  // getting the matching entities one by one. The entities that don't have the property are skipped.
+  template <PropertyId Id>
+  [[nodiscard]] std::vector<std::pair<EntityId, PropertyValueType<Id>>>
+  project(const Query &query = Query::allOf({}), const QueryOptions &options = {}) const {
+    return aggregate(query, ProjectionAggregator<Id>{}, options).result();
+  }
+
+  // Returns the ids of the first limit entities that match the query in the order of the property, the entities with
+  // equal values are ordered by their id. It keeps only limit entities while scanning the store, so it is O(N log K)
+  // instead of sorting every matching entity. If the query cannot use an index, but the property has an ordered index,
+  // then the index is walked in order and the scan stops at the limit-th match. The entities that don't have the
+  // property are skipped.
+  template <PropertyId Id>
+  [[nodiscard]] std::vector<EntityId> orderBy(const SortOrder order, const size_t limit,
+                                              const Query &query = Query::allOf({}),
+                                              const QueryOptions &options = {}) const {
+    return aggregate(query, OrderByAggregator<Id>{limit, order}, options).ids();
+  }
+
+  // The cursors return the matching entities in batches of at most batchSize entities. Every batch is evaluated as an
+  // orderBy that starts after the last entity of the previous batch, so the cursor never holds more than a batch, see
+  // QueryCursor. The cursor must not outlive the store.
+  [[nodiscard]] QueryCursor<OrderByIdAggregator> cursor(const size_t batchSize, const Query &query = Query::allOf({}),
+                                                        const QueryOptions &options = {}) const {
+    return QueryCursor<OrderByIdAggregator>{*m_store, planQuery(query, *m_store),
+                                            OrderByIdAggregator{batchSize, SortOrder::Ascending},
+                                            getExecutor(options), m_instrumentation.get()};
+  }
+
+  template <PropertyId Id>
+  [[nodiscard]] QueryCursor<OrderByAggregator<Id>> orderedCursor(const SortOrder order, const size_t batchSize,
+                                                                 const Query &query = Query::allOf({}),
+                                                                 const QueryOptions &options = {}) const {
+    return QueryCursor<OrderByAggregator<Id>>{*m_store, planQuery(query, *m_store),
+                                              OrderByAggregator<Id>{batchSize, order}, getExecutor(options),
+                                              m_instrumentation.get()};
+  }
+
   void commit();
   void rollback();
 
 private:
+  // The query values are converted to the type of the property, so the scans compare the same values as the index
+  // lookups do, and the scan loops are compiled only once for every property type. If the query value cannot be
+  // converted, then the indices cannot be used either, so the predicate is evaluated through the virtual interface.
   template <typename TProperty, typename TQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> queryWithoutPropertyTypeCheck(const PropertyId propertyId,
-                                                                           const TQueryValue &queryValue) const {
+  [[nodiscard]] EntityIdSet queryWithoutPropertyTypeCheck(const PropertyId propertyId, const TQueryValue &queryValue,
+                                                          const QueryOptions &options) const {
     static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
 
-    SimpleQueryEntityPredicate<TProperty, TQueryValue> predicate(propertyId, queryValue);
-    return m_store->filterIds(predicate);
+    if constexpr (std::is_convertible_v<const TQueryValue &, TProperty>) {
+      return queryLookup(IndexLookup::equalTo(propertyId, Property{std::in_place_type<TProperty>, queryValue}),
+                         options);
+    } else {
+      return filterWithoutIndex(SimpleQueryEntityPredicate<TProperty, TQueryValue>(propertyId, queryValue), options);
+    }
   }
 
   template <typename TProperty, typename TMinQueryValue, typename TMaxQueryValue>
-  [[nodiscard]] std::unordered_set<EntityId> rangeQueryWithoutPropertyTypeCheck(const PropertyId propertyId,
-                                                                                const TMinQueryValue &minValue,
-                                                                                const TMaxQueryValue &maxValue) const {
+  [[nodiscard]] EntityIdSet rangeQueryWithoutPropertyTypeCheck(const PropertyId propertyId,
+                                                               const TMinQueryValue &minValue,
+                                                               const TMaxQueryValue &maxValue,
+                                                               const QueryOptions &options) const {
     static_assert(isPropertyMember<TProperty>(), "the requested type cannot be contained by Property");
 
-    RangeQueryEntityPredicate<TProperty, TMinQueryValue, TMaxQueryValue> predicate(propertyId, minValue, maxValue);
-    return m_store->filterIds(predicate);
+    if constexpr (std::is_convertible_v<const TMinQueryValue &, TProperty> &&
+                  std::is_convertible_v<const TMaxQueryValue &, TProperty>) {
+      return queryLookup(IndexLookup::inRange(propertyId, Property{std::in_place_type<TProperty>, minValue},
+                                              Property{std::in_place_type<TProperty>, maxValue}),
+                         options);
+    } else {
+      return filterWithoutIndex(
+          RangeQueryEntityPredicate<TProperty, TMinQueryValue, TMaxQueryValue>(propertyId, minValue, maxValue),
+          options);
+    }
+  }
+
+  // The functions below evaluate the scans, so they depend on the implementations of the stores. They are defined in
+  // Store.cpp, where the scans are compiled for every type of the lookup values and every StoreAggregator, therefore
+  // this header doesn't have to include the stores.
+  [[nodiscard]] EntityIdSet queryLookup(const IndexLookup &lookup, const QueryOptions &options) const;
+  [[nodiscard]] EntityIdSet filterWithoutIndex(const EntityPredicate &predicate, const QueryOptions &options) const;
+  [[nodiscard]] StoreAggregator aggregate(const Query &query, const StoreAggregator &emptyAggregator,
+                                          const QueryOptions &options) const;
+
+  [[nodiscard]] const QueryExecutor *getExecutor(const QueryOptions &options) const;
+
+  template <PropertyId Id, AggregatorOf<PropertyValueType<Id>> TAggregator>
+  [[nodiscard]] TAggregator aggregate(const Query &query, TAggregator emptyAggregator,
+                                      const QueryOptions &options) const {
+    return aggregate(query, PropertyAggregator<Id, TAggregator>{std::move(emptyAggregator)}, options)
+        .valueAggregator();
+  }
+
+  template <EntityAggregator TAggregator>
+  [[nodiscard]] TAggregator aggregate(const Query &query, TAggregator emptyAggregator,
+                                      const QueryOptions &options) const {
+    return std::get<TAggregator>(
+        aggregate(query, StoreAggregator{std::in_place_type<TAggregator>, std::move(emptyAggregator)}, options));
   }
 
   std::unique_ptr<IStore> m_store;
+  const QueryExecutor *m_queryExecutor{nullptr};
+  // Points to m_store if the store was opened by open.
+  LoggingStore *m_loggingStore{nullptr};
+  // Points to m_store if the store was created by createConcurrent.
+  ConcurrentStore *m_concurrentStore{nullptr};
+  // Points to m_store if the store was created by createTransactional.
+  OptimisticStore *m_optimisticStore{nullptr};
+  // Points to m_store if the store was created by createChild of a not transactional store.
+  NestedStore *m_nestedStore{nullptr};
+  // Points to m_store after the first subscription, it wraps the store that was created by the functions above.
+  ObservedStore *m_observedStore{nullptr};
+  // Shared with the child stores and snapshots that were created after it was enabled, so they record into it.
+  std::shared_ptr<Instrumentation> m_instrumentation;
 };
 
 } // namespace EntityStore
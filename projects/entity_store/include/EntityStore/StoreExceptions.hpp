@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdexcept>
+#include <string_view>
 
 #include "EntityStore/Internal/Entity.hpp"
 
@@ -16,4 +17,18 @@ public:
   explicit InvalidRangeException();
 };
 
+// Thrown when a persisted file (e.g. a snapshot) is truncated or corrupted. The errors of the file operations are
+// reported by std::system_error.
+class InvalidPersistedDataException : public std::runtime_error {
+public:
+  explicit InvalidPersistedDataException(const std::string_view reason);
+};
+
+// Thrown when the commit of a transaction fails, because another transaction committed a conflicting change since it
+// started.
+class TransactionConflictException : public std::runtime_error {
+public:
+  explicit TransactionConflictException();
+};
+
 } // namespace EntityStore
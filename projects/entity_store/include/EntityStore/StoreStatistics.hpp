@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "EntityStore/Property.hpp"
+
+namespace EntityStore {
+
+// The batch functions are recorded as the operation of their single item version, e.g. insertBatch as Insert.
+enum class StoreOperation : size_t {
+  Insert = 0,
+  Update,
+  // contains, tryGet and get
+  Read,
+  Remove,
+  // Every query function, including filter and the batches of the cursors
+  Query,
+  // The aggregations, projections and orderBy
+  Aggregate,
+  Commit,
+  Rollback,
+  // shrink and compact
+  Shrink,
+  LAST = Shrink
+};
+
+// Counts the values in power of two buckets: the bucket 0 counts the zeros, while the bucket i counts the values in
+// [2^(i-1), 2^i). It is precise enough to see the order of magnitude of the values (and their outliers), while it is a
+// fixed size array, so it can be updated without allocations.
+struct Log2Histogram {
+  static constexpr size_t kNumberOfBuckets{65U};
+
+  [[nodiscard]] static size_t bucketOf(const uint64_t value);
+
+  // Returns the exclusive upper bound of the bucket that contains the given percentile (between 0 and 1) of the values,
+  // e.g. percentileUpperBound(0.99) is an upper estimation of the p99 latency. Returns 0 if the histogram is empty.
+  [[nodiscard]] uint64_t percentileUpperBound(const double percentile) const;
+  [[nodiscard]] double mean() const;
+
+  std::array<uint64_t, kNumberOfBuckets> buckets{};
+  uint64_t count{0U};
+  uint64_t sum{0U};
+};
+
+// A copy of the statistics that were collected by an instrumented store, see Store::enableInstrumentation.
+struct StoreStatistics {
+  [[nodiscard]] const Log2Histogram &latency(const StoreOperation operation) const;
+
+  // The latencies of the operations in nanoseconds.
+  std::array<Log2Histogram, asUnderlying(StoreOperation::LAST) + 1> latencies{};
+  // The number of entities the queries and aggregations evaluated their predicate on, and the number of them that
+  // matched. Their ratio shows how well the indices narrow down the candidates.
+  uint64_t scannedEntities{0U};
+  uint64_t matchedEntities{0U};
+  // The number of stores a read of a child store visited until it found the entity (or the lack of it), including the
+  // first ancestor that is not a child store if it was reached.
+  Log2Histogram traversedLevels{};
+  // The number of changes (removals, updates and insertions) a commit of a child store applied to its parent.
+  Log2Histogram commitSizes{};
+};
+
+} // namespace EntityStore
@@ -0,0 +1,49 @@
+#include "EntityStore/ChangeStream.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace EntityStore {
+
+ChangeSubscription::ChangeSubscription(const size_t capacity)
+  : m_events(std::bit_ceil(std::max(capacity, size_t{1U})))
+  , m_positionMask{m_events.size() - 1U} {
+}
+
+size_t ChangeSubscription::capacity() const {
+  return m_events.size();
+}
+
+// The positions are never wrapped, only the indices into the buffer, so the number of published but not drained events
+// is always the difference of the positions.
+bool ChangeSubscription::publish(std::span<const ChangeEvent> events) {
+  const auto writePosition = m_writePosition.load(std::memory_order_relaxed);
+  const auto readPosition = m_readPosition.load(std::memory_order_acquire);
+  if (events.size() > capacity() - (writePosition - readPosition)) {
+    m_isOverflown.store(true, std::memory_order_release);
+    return false;
+  }
+  for (size_t index{0U}; index < events.size(); ++index) {
+    m_events[(writePosition + index) & m_positionMask] = events[index];
+  }
+  m_writePosition.store(writePosition + events.size(), std::memory_order_release);
+  return true;
+}
+
+size_t ChangeSubscription::drain(std::vector<ChangeEvent> &events, const size_t maxEvents) {
+  const auto readPosition = m_readPosition.load(std::memory_order_relaxed);
+  const auto writePosition = m_writePosition.load(std::memory_order_acquire);
+  const auto numberOfEvents = std::min(writePosition - readPosition, maxEvents);
+  events.reserve(events.size() + numberOfEvents);
+  for (size_t index{0U}; index < numberOfEvents; ++index) {
+    events.push_back(m_events[(readPosition + index) & m_positionMask]);
+  }
+  m_readPosition.store(readPosition + numberOfEvents, std::memory_order_release);
+  return numberOfEvents;
+}
+
+bool ChangeSubscription::checkAndClearOverflow() {
+  return m_isOverflown.exchange(false, std::memory_order_acq_rel);
+}
+
+} // namespace EntityStore
@@ -0,0 +1,129 @@
+#include "EntityStore/EntityIdSet.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+#include "utils/Assert.hpp"
+
+namespace EntityStore {
+
+template <typename TSetOperation>
+std::vector<EntityId> combine(const std::vector<EntityId> &lhs, const std::vector<EntityId> &rhs,
+                              const size_t expectedSize, TSetOperation &&setOperation) {
+  std::vector<EntityId> result;
+  result.reserve(expectedSize);
+  setOperation(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+  return result;
+}
+
+EntityIdSet::EntityIdSet(std::initializer_list<EntityId> ids)
+  : EntityIdSet(fromUnsorted(std::vector<EntityId>(ids))) {
+}
+
+EntityIdSet::EntityIdSet(std::vector<EntityId> &&sortedIds)
+  : m_ids{std::move(sortedIds)} {
+}
+
+EntityIdSet EntityIdSet::fromUnsorted(std::vector<EntityId> ids) {
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return EntityIdSet(std::move(ids));
+}
+
+EntityIdSet EntityIdSet::fromSorted(std::vector<EntityId> ids) {
+  MY_ASSERT(std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<>{}) == ids.end(),
+            "The ids must be sorted and unique");
+  return EntityIdSet(std::move(ids));
+}
+
+size_t EntityIdSet::size() const {
+  return m_ids.size();
+}
+
+bool EntityIdSet::empty() const {
+  return m_ids.empty();
+}
+
+EntityIdSet::ConstIterator EntityIdSet::begin() const {
+  return m_ids.begin();
+}
+
+EntityIdSet::ConstIterator EntityIdSet::end() const {
+  return m_ids.end();
+}
+
+size_t EntityIdSet::count(const EntityId id) const {
+  return contains(id) ? 1U : 0U;
+}
+
+bool EntityIdSet::contains(const EntityId id) const {
+  return std::binary_search(m_ids.begin(), m_ids.end(), id);
+}
+
+const std::vector<EntityId> &EntityIdSet::ids() const & {
+  return m_ids;
+}
+
+std::vector<EntityId> &&EntityIdSet::ids() && {
+  return std::move(m_ids);
+}
+
+EntityIdSet &EntityIdSet::operator&=(const EntityIdSet &other) {
+  *this = *this & other;
+  return *this;
+}
+
+EntityIdSet &EntityIdSet::operator|=(const EntityIdSet &other) {
+  if (other.empty()) {
+    return *this;
+  }
+  if (empty()) {
+    *this = other;
+    return *this;
+  }
+  // Only the missing ids are collected, then they are merged from the back into the extended vector, so the existing
+  // ids are moved at most once and the capacity of the vector is reused.
+  const auto missingIds = other - *this;
+  auto lhsIndex = m_ids.size();
+  auto rhsIndex = missingIds.size();
+  m_ids.resize(lhsIndex + rhsIndex);
+  auto resultIndex = m_ids.size();
+  while (rhsIndex > 0U) {
+    if (lhsIndex > 0U && m_ids[lhsIndex - 1U] > missingIds.m_ids[rhsIndex - 1U]) {
+      m_ids[--resultIndex] = m_ids[--lhsIndex];
+    } else {
+      m_ids[--resultIndex] = missingIds.m_ids[--rhsIndex];
+    }
+  }
+  return *this;
+}
+
+EntityIdSet &EntityIdSet::operator-=(const EntityIdSet &other) {
+  // As the result is a subset of this set, it can be done in place without allocating new memory.
+  auto otherIt = other.m_ids.begin();
+  const auto newEnd = std::remove_if(m_ids.begin(), m_ids.end(), [&otherIt, &other](const EntityId id) {
+    otherIt = std::lower_bound(otherIt, other.m_ids.end(), id);
+    return otherIt != other.m_ids.end() && *otherIt == id;
+  });
+  m_ids.erase(newEnd, m_ids.end());
+  return *this;
+}
+
+EntityIdSet operator&(const EntityIdSet &lhs, const EntityIdSet &rhs) {
+  return EntityIdSet(combine(lhs.m_ids, rhs.m_ids, std::min(lhs.size(), rhs.size()),
+                             [](auto... args) { return std::set_intersection(args...); }));
+}
+
+EntityIdSet operator|(const EntityIdSet &lhs, const EntityIdSet &rhs) {
+  return EntityIdSet(combine(lhs.m_ids, rhs.m_ids, lhs.size() + rhs.size(),
+                             [](auto... args) { return std::set_union(args...); }));
+}
+
+EntityIdSet operator-(const EntityIdSet &lhs, const EntityIdSet &rhs) {
+  return EntityIdSet(combine(lhs.m_ids, rhs.m_ids, lhs.size(),
+                             [](auto... args) { return std::set_difference(args...); }));
+}
+
+} // namespace EntityStore
@@ -0,0 +1,86 @@
+#include "EntityStore/Internal/BinaryFormat.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace EntityStore {
+
+void BinaryWriter::writeString(const std::string_view value) {
+  if (value.size() > std::numeric_limits<uint32_t>::max()) {
+    throw InvalidPersistedDataException("string is too long to be persisted");
+  }
+  write(static_cast<uint32_t>(value.size()));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  const auto *bytes = reinterpret_cast<const std::byte *>(value.data());
+  m_buffer.insert(m_buffer.end(), bytes, bytes + value.size());
+}
+
+std::span<const std::byte> BinaryWriter::bytes() const {
+  return m_buffer;
+}
+
+size_t BinaryWriter::size() const {
+  return m_buffer.size();
+}
+
+void BinaryWriter::clear() {
+  m_buffer.clear();
+}
+
+void BinaryWriter::truncate(const size_t size) {
+  MY_ASSERT(size <= m_buffer.size(), "Only written bytes can be dropped");
+  m_buffer.resize(size);
+}
+
+BinaryReader::BinaryReader(std::span<const std::byte> bytes)
+  : m_bytes{bytes} {
+}
+
+std::string_view BinaryReader::readString() {
+  const auto size = read<uint32_t>();
+  const auto bytes = take(size);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return std::string_view{reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+double BinaryReader::readDoubleProperty() {
+  const auto value = read<double>();
+  if (std::isnan(value)) {
+    throw InvalidPersistedDataException("NaN property value in the persisted data");
+  }
+  return value;
+}
+
+bool BinaryReader::atEnd() const {
+  return m_position == m_bytes.size();
+}
+
+size_t BinaryReader::position() const {
+  return m_position;
+}
+
+size_t BinaryReader::remainingSize() const {
+  return m_bytes.size() - m_position;
+}
+
+std::span<const std::byte> BinaryReader::take(const size_t size) {
+  if (size > m_bytes.size() - m_position) {
+    throw InvalidPersistedDataException("unexpected end of data");
+  }
+  const auto result = m_bytes.subspan(m_position, size);
+  m_position += size;
+  return result;
+}
+
+SerializedPropertyMask serializePropertyMask(const PropertyMask &mask) {
+  return static_cast<SerializedPropertyMask>(mask.to_ulong());
+}
+
+PropertyMask deserializePropertyMask(const SerializedPropertyMask mask) {
+  if ((mask >> (asUnderlying(PropertyId::LAST) + 1U)) != 0U) {
+    throw InvalidPersistedDataException("unknown property in the persisted data");
+  }
+  return PropertyMask{mask};
+}
+
+} // namespace EntityStore
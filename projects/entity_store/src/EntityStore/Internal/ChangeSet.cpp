@@ -0,0 +1,28 @@
+#include "EntityStore/Internal/ChangeSet.hpp"
+
+#include <span>
+#include <stdexcept>
+
+#include "EntityStore/Internal/IStore.hpp"
+
+namespace EntityStore {
+
+bool ChangeSet::empty() const {
+  return removed.empty() && updated.empty() && inserted.empty();
+}
+
+void applyChangesByBatches(IStore &store, ChangeSet &&changes) {
+  const auto isEverySucceeded = [](const BatchResult &result) { return result.count() == result.size(); };
+
+  if (!isEverySucceeded(store.removeBatch(changes.removed))) {
+    throw std::logic_error("Cannot remove Entity while committing changes to parent!");
+  }
+  if (!isEverySucceeded(store.updateBatch(std::span<Entity>{changes.updated}))) {
+    throw std::logic_error("Cannot update Entity while committing changes to parent!");
+  }
+  if (!isEverySucceeded(store.insertBatch(std::span<Entity>{changes.inserted}))) {
+    throw std::logic_error("Cannot insert Entity while committing changes to parent!");
+  }
+}
+
+} // namespace EntityStore
@@ -0,0 +1,475 @@
+#include "EntityStore/Internal/ColumnarStore.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+
+#include "EntityStore/StoreExceptions.hpp"
+
+namespace EntityStore {
+
+template <typename TColumns, typename TFunc>
+void forEachColumn(TColumns &columns, TFunc &&func) {
+  std::apply([&func](auto &...column) { (func(column), ...); }, columns);
+}
+
+template <typename TColumn>
+const typename TColumn::ValueType &getValue(const TColumn &column, const size_t slot) {
+  if constexpr (TColumn::kIsDictionaryEncoded) {
+    return column.dictionary.decode(column.values[slot]);
+  } else {
+    return column.values[slot];
+  }
+}
+
+template <typename TColumn>
+void setValue(TColumn &column, const size_t slot, const typename TColumn::ValueType &value) {
+  if constexpr (TColumn::kIsDictionaryEncoded) {
+    const auto code = column.dictionary.encode(value);
+    if (column.hasValue.test(slot) && column.values[slot] != code) {
+      column.mightHaveUnusedStrings = true;
+    }
+    column.values[slot] = code;
+  } else {
+    column.values[slot] = value;
+  }
+  column.hasValue.set(slot);
+}
+
+// The encoded values are compared only by their codes. As the range lookups have to compare the strings themselves,
+// every distinct string is compared only once, and the scan checks the codes against the result of the comparisons.
+template <typename TColumn, typename TFunc>
+void forEachEqualValue(const TColumn &column, const typename TColumn::ValueType &value, TFunc &&func) {
+  const auto &values = column.values;
+  if constexpr (TColumn::kIsDictionaryEncoded) {
+    const auto code = column.dictionary.tryFind(value);
+    if (!code.has_value()) {
+      return;
+    }
+    column.hasValue.forEachSetBit([&values, &code, &func](const size_t slot) {
+      if (values[slot] == *code) {
+        func(slot);
+      }
+    });
+  } else {
+    column.hasValue.forEachSetBit([&values, &value, &func](const size_t slot) {
+      if (values[slot] == value) {
+        func(slot);
+      }
+    });
+  }
+}
+
+template <typename TColumn, typename TFunc>
+void forEachValueInRange(const TColumn &column, const typename TColumn::ValueType &lowerBound,
+                         const typename TColumn::ValueType &upperBound, TFunc &&func) {
+  const auto isInRange = [&lowerBound, &upperBound](const auto &value) {
+    return value >= lowerBound && value < upperBound;
+  };
+  const auto &values = column.values;
+  if constexpr (TColumn::kIsDictionaryEncoded) {
+    utils::containers::DynamicBitset matchingCodes(column.dictionary.size());
+    for (StringDictionary::Code code{0U}; code < column.dictionary.size(); ++code) {
+      if (isInRange(column.dictionary.decode(code))) {
+        matchingCodes.set(code);
+      }
+    }
+    column.hasValue.forEachSetBit([&values, &matchingCodes, &func](const size_t slot) {
+      if (matchingCodes.test(values[slot])) {
+        func(slot);
+      }
+    });
+  } else {
+    column.hasValue.forEachSetBit([&values, &isInRange, &func](const size_t slot) {
+      if (isInRange(values[slot])) {
+        func(slot);
+      }
+    });
+  }
+}
+
+bool ColumnarStore::insert(const EntityId id, Properties &&properties) {
+  return insert(id, static_cast<const Properties &>(properties));
+}
+
+bool ColumnarStore::insert(const EntityId id, const Properties &properties) {
+  if (m_slotById.find(id) != m_slotById.end()) {
+    return false;
+  }
+  const auto slot = allocateSlot(id);
+  writeProperties(slot, properties);
+  return true;
+}
+
+const Properties *ColumnarStore::update(const EntityId id, Properties &&properties) {
+  return update(id, static_cast<const Properties &>(properties));
+}
+
+const Properties *ColumnarStore::update(const EntityId id, const Properties &properties) {
+  const auto slot = tryGetSlot(id);
+  if (!slot.has_value()) {
+    return nullptr;
+  }
+  writeProperties(*slot, properties);
+  return &getCachedProperties(*slot);
+}
+
+bool ColumnarStore::contains(const EntityId id) const {
+  return m_slotById.find(id) != m_slotById.end();
+}
+
+const Properties *ColumnarStore::tryGet(const EntityId id) const {
+  const auto slot = tryGetSlot(id);
+  if (!slot.has_value()) {
+    return nullptr;
+  }
+  return &getCachedProperties(*slot);
+}
+
+const Properties &ColumnarStore::get(const EntityId id) const {
+  const auto *propertiesPtr = tryGet(id);
+  if (propertiesPtr == nullptr) {
+    throw DoesNotHaveEntityException(id);
+  }
+  return *propertiesPtr;
+}
+
+bool ColumnarStore::remove(const EntityId id) {
+  auto it = m_slotById.find(id);
+  if (it == m_slotById.end()) {
+    return false;
+  }
+  const auto slot = it->second;
+  m_slotById.erase(it);
+
+  forEachColumn(m_columns, [slot](auto &column) {
+    using StoredType = typename std::decay_t<decltype(column)>::StoredType;
+    if constexpr (std::decay_t<decltype(column)>::kIsDictionaryEncoded) {
+      column.mightHaveUnusedStrings = column.mightHaveUnusedStrings || column.hasValue.test(slot);
+    }
+    // Assigning an empty value frees the memory that might be held by the value (e.g. long strings)
+    column.values[slot] = StoredType{};
+    column.hasValue.reset(slot);
+  });
+  m_usedSlots.reset(slot);
+  m_cachedProperties[slot].reset();
+  m_emptySlots.push_back(slot);
+  return true;
+}
+
+BatchResult ColumnarStore::insertBatch(std::span<Entity> entities) {
+  return insertBatch(std::span<const Entity>{entities});
+}
+
+BatchResult ColumnarStore::insertBatch(std::span<const Entity> entities) {
+  if (entities.size() > m_emptySlots.size()) {
+    reserve(m_ids.size() + entities.size() - m_emptySlots.size());
+  }
+  reserveMapGeometrically(m_slotById, m_slotById.size() + entities.size());
+  return processBatch(
+      entities, [this](const Entity &entity) { return ColumnarStore::insert(entity.id(), entity.properties()); });
+}
+
+BatchResult ColumnarStore::updateBatch(std::span<Entity> entities) {
+  return updateBatch(std::span<const Entity>{entities});
+}
+
+BatchResult ColumnarStore::updateBatch(std::span<const Entity> entities) {
+  return processBatch(entities, [this](const Entity &entity) {
+    return ColumnarStore::update(entity.id(), entity.properties()) != nullptr;
+  });
+}
+
+BatchResult ColumnarStore::removeBatch(std::span<const EntityId> ids) {
+  return processBatch(ids, [this](const EntityId id) { return ColumnarStore::remove(id); });
+}
+
+void ColumnarStore::applyChanges(ChangeSet &&changes) {
+  applyChangesByBatches(*this, std::move(changes));
+}
+
+EntityIdSet ColumnarStore::filterIds(const EntityPredicate &predicate, const QueryExecutor * /*executor*/) const {
+  std::vector<EntityId> result;
+  m_usedSlots.forEachSetBit([this, &predicate, &result](const size_t slot) {
+    const auto id = m_ids[slot];
+    if (predicate(id, assembleProperties(slot))) {
+      result.push_back(id);
+    }
+  });
+  return EntityIdSet::fromUnsorted(std::move(result));
+}
+
+EntityIdSet ColumnarStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                     const QueryExecutor *executor) const {
+  std::vector<EntityId> result;
+  const auto checkCandidate = [this, &predicate, &result](const size_t slot) {
+    // The predicate might contain more conditions than the lookup, so the candidates have to be checked. As the lookup
+    // is usually selective, only a small portion of the entities have to be assembled.
+    const auto id = m_ids[slot];
+    if (predicate(id, assembleProperties(slot))) {
+      result.push_back(id);
+    }
+  };
+
+  if (!forEachCandidateSlot(lookup, checkCandidate)) {
+    return filterIds(predicate, executor);
+  }
+  return EntityIdSet::fromUnsorted(std::move(result));
+}
+
+// The properties are assembled only once for the predicate and the aggregator, and they are not cached, so the
+// aggregations don't fill the cache of the point reads.
+AnyAggregator ColumnarStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                       const AnyAggregator &emptyAggregator,
+                                       const QueryExecutor * /*executor*/) const {
+  auto result = emptyAggregator;
+  const auto addIfMatches = [this, &predicate, &result](const size_t slot) {
+    const auto id = m_ids[slot];
+    const auto properties = assembleProperties(slot);
+    if (predicate(id, properties)) {
+      result.add(id, properties);
+    }
+  };
+
+  if (lookup == nullptr || !forEachCandidateSlot(*lookup, addIfMatches)) {
+    m_usedSlots.forEachSetBit(addIfMatches);
+  }
+  return result;
+}
+
+std::optional<IndexEstimate> ColumnarStore::estimate(const IndexLookup & /*lookup*/,
+                                                    const size_t /*maxMatchingEntities*/) const {
+  return std::nullopt;
+}
+
+// The columnar store has to assemble the properties for the predicate, which is much more expensive than the virtual
+// call, so it doesn't support the inlined filter functions.
+const RootStore *ColumnarStore::asRootStore() const {
+  return nullptr;
+}
+
+const NestedStore *ColumnarStore::asNestedStore() const {
+  return nullptr;
+}
+
+bool ColumnarStore::createIndex(const PropertyId /*propertyId*/, const IndexType /*indexType*/) {
+  return false;
+}
+
+bool ColumnarStore::dropIndex(const PropertyId /*propertyId*/) {
+  return false;
+}
+
+void ColumnarStore::commit() {
+}
+
+void ColumnarStore::rollback() {
+}
+
+void ColumnarStore::shrink() {
+  // The updated and removed entities might leave unused strings in the dictionaries, they are dropped by recoding the
+  // columns with new dictionaries. Recoding is as expensive as a full scan of the column, so the columns whose strings
+  // were never overwritten or removed are skipped.
+  forEachColumn(m_columns, [](auto &column) {
+    if constexpr (std::decay_t<decltype(column)>::kIsDictionaryEncoded) {
+      if (!column.mightHaveUnusedStrings) {
+        return;
+      }
+      StringDictionary dictionary;
+      column.hasValue.forEachSetBit([&column, &dictionary](const size_t slot) {
+        column.values[slot] = dictionary.encode(column.dictionary.decode(column.values[slot]));
+      });
+      column.dictionary = std::move(dictionary);
+      column.mightHaveUnusedStrings = false;
+    }
+  });
+
+  if (m_emptySlots.empty()) {
+    return;
+  }
+
+  const auto numberOfEntities = m_slotById.size();
+
+  // The relative order of the entities is kept, so the scans will visit the entities in the same order as before.
+  size_t newSlot{0U};
+  m_usedSlots.forEachSetBit([this, &newSlot](const size_t oldSlot) {
+    if (oldSlot != newSlot) {
+      moveSlot(oldSlot, newSlot);
+    }
+    ++newSlot;
+  });
+
+  m_ids.resize(numberOfEntities);
+  m_ids.shrink_to_fit();
+  m_usedSlots = utils::containers::DynamicBitset(numberOfEntities, true);
+  m_emptySlots.clear();
+  m_emptySlots.shrink_to_fit();
+  m_cachedProperties.resize(numberOfEntities);
+  m_cachedProperties.shrink_to_fit();
+  forEachColumn(m_columns, [numberOfEntities](auto &column) {
+    column.values.resize(numberOfEntities);
+    column.values.shrink_to_fit();
+    column.hasValue.resize(numberOfEntities);
+    column.hasValue.shrinkToFit();
+  });
+}
+
+// Same as the RootStore, the smallest holes are filled by the last entities, so every moved entity shortens the
+// columns. Unlike shrink, it doesn't keep the relative order of the entities and doesn't recode the dictionaries.
+bool ColumnarStore::compact(const size_t maxMovedEntities) {
+  std::sort(m_emptySlots.begin(), m_emptySlots.end());
+  // The filled holes are erased from the front of the empty slots only at the end, so the erasure is done only once.
+  size_t numberOfFilledSlots{0U};
+  const auto removeTrailingEmptySlots = [this, &numberOfFilledSlots]() {
+    while (m_emptySlots.size() > numberOfFilledSlots && m_emptySlots.back() == m_ids.size() - 1U) {
+      m_emptySlots.pop_back();
+      removeLastSlot();
+    }
+  };
+
+  removeTrailingEmptySlots();
+  for (size_t numberOfMovedEntities{0U};
+       numberOfMovedEntities < maxMovedEntities && numberOfFilledSlots < m_emptySlots.size(); ++numberOfMovedEntities) {
+    moveSlot(m_ids.size() - 1U, m_emptySlots[numberOfFilledSlots]);
+    ++numberOfFilledSlots;
+    removeLastSlot();
+    removeTrailingEmptySlots();
+  }
+  m_emptySlots.erase(m_emptySlots.begin(), m_emptySlots.begin() + static_cast<std::ptrdiff_t>(numberOfFilledSlots));
+  return m_emptySlots.empty();
+}
+
+template <typename TFunc>
+bool ColumnarStore::forEachCandidateSlot(const IndexLookup &lookup, TFunc &&func) const {
+  bool isLookupUsable{true};
+  forEachColumn(m_columns, [&lookup, &isLookupUsable, &func](const auto &column) {
+    using ValueType = typename std::decay_t<decltype(column)>::ValueType;
+    if (column.propertyId != lookup.propertyId) {
+      return;
+    }
+    const auto *lowerBoundPtr = std::get_if<ValueType>(&lookup.lowerBound);
+    const auto *upperBoundPtr = lookup.upperBound.has_value() ? std::get_if<ValueType>(&*lookup.upperBound) : nullptr;
+    if (lowerBoundPtr == nullptr || (lookup.upperBound.has_value() && upperBoundPtr == nullptr)) {
+      isLookupUsable = false;
+      return;
+    }
+
+    if (upperBoundPtr == nullptr) {
+      forEachEqualValue(column, *lowerBoundPtr, func);
+    } else {
+      forEachValueInRange(column, *lowerBoundPtr, *upperBoundPtr, func);
+    }
+  });
+  return isLookupUsable;
+}
+
+std::optional<size_t> ColumnarStore::tryGetSlot(const EntityId id) const {
+  auto it = m_slotById.find(id);
+  if (it == m_slotById.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+// Every column has the same number of slots, so the growth of the ids decides the capacity of all of them.
+void ColumnarStore::reserve(const size_t numberOfSlots) {
+  if (numberOfSlots <= m_ids.capacity()) {
+    return;
+  }
+  const auto capacity = std::max(numberOfSlots, 2U * m_ids.capacity());
+  m_ids.reserve(capacity);
+  m_cachedProperties.reserve(capacity);
+  forEachColumn(m_columns, [capacity](auto &column) { column.values.reserve(capacity); });
+}
+
+size_t ColumnarStore::allocateSlot(const EntityId id) {
+  size_t slot{0U};
+  if (m_emptySlots.empty()) {
+    slot = m_ids.size();
+    m_ids.push_back(id);
+    m_usedSlots.pushBack(true);
+    m_cachedProperties.emplace_back();
+    forEachColumn(m_columns, [](auto &column) {
+      column.values.emplace_back();
+      column.hasValue.pushBack(false);
+    });
+  } else {
+    slot = m_emptySlots.back();
+    m_emptySlots.pop_back();
+    m_ids[slot] = id;
+    m_usedSlots.set(slot);
+  }
+  m_slotById.emplace(id, slot);
+  return slot;
+}
+
+// The old slot is left in an unspecified state, it has to be either removed or reused.
+void ColumnarStore::moveSlot(const size_t oldSlot, const size_t newSlot) {
+  m_ids[newSlot] = m_ids[oldSlot];
+  m_slotById[m_ids[newSlot]] = newSlot;
+  m_usedSlots.set(newSlot);
+  m_cachedProperties[newSlot] = std::move(m_cachedProperties[oldSlot]);
+  forEachColumn(m_columns, [oldSlot, newSlot](auto &column) {
+    column.values[newSlot] = std::move(column.values[oldSlot]);
+    column.hasValue.set(newSlot, column.hasValue.test(oldSlot));
+  });
+}
+
+void ColumnarStore::removeLastSlot() {
+  const auto newSize = m_ids.size() - 1U;
+  m_ids.pop_back();
+  m_usedSlots.resize(newSize);
+  m_cachedProperties.pop_back();
+  forEachColumn(m_columns, [newSize](auto &column) {
+    column.values.pop_back();
+    column.hasValue.resize(newSize);
+  });
+}
+
+void ColumnarStore::writeProperties(const size_t slot, const Properties &properties) {
+  forEachColumn(m_columns, [slot, &properties](auto &column) {
+    const auto *valuePtr = properties.template tryGet<std::decay_t<decltype(column)>::propertyId>();
+    if (valuePtr != nullptr) {
+      setValue(column, slot, *valuePtr);
+    }
+  });
+  // The cached properties are refreshed in place, so the pointers returned before the update remain valid.
+  auto &cachedProperties = m_cachedProperties[slot];
+  if (cachedProperties.has_value()) {
+    *cachedProperties = assembleProperties(slot);
+  }
+}
+
+Properties ColumnarStore::assembleProperties(const size_t slot) const {
+  Properties properties;
+  forEachColumn(m_columns, [slot, &properties](const auto &column) {
+    if (column.hasValue.test(slot)) {
+      properties.template set<std::decay_t<decltype(column)>::propertyId>(getValue(column, slot));
+    }
+  });
+  return properties;
+}
+
+// The const functions might be called from many threads at the same time (e.g. by the readers of a concurrent store),
+// so the cache is only filled under the exclusive lock. A filled entry is changed only by the modifications, which
+// cannot run in parallel with the reads, therefore the returned reference can be used without the lock.
+const Properties &ColumnarStore::getCachedProperties(const size_t slot) const {
+  {
+    const std::shared_lock lock{m_cacheMutex};
+    const auto &cachedProperties = m_cachedProperties[slot];
+    if (cachedProperties.has_value()) {
+      return *cachedProperties;
+    }
+  }
+  auto properties = assembleProperties(slot);
+  const std::unique_lock lock{m_cacheMutex};
+  auto &cachedProperties = m_cachedProperties[slot];
+  if (!cachedProperties.has_value()) {
+    cachedProperties.emplace(std::move(properties));
+  }
+  return *cachedProperties;
+}
+
+} // namespace EntityStore
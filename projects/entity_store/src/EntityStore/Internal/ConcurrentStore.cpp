@@ -0,0 +1,388 @@
+#include "EntityStore/Internal/ConcurrentStore.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "utils/Assert.hpp"
+
+namespace EntityStore {
+
+std::unique_ptr<ConcurrentStoreSnapshot> ConcurrentStore::createSnapshot() const {
+  return std::make_unique<ConcurrentStoreSnapshot>(*this, pinVisibleInstance());
+}
+
+bool ConcurrentStore::insert(const EntityId id, Properties &&properties) {
+  // The properties are moved into the writable instance, so they have to be copied for the other one first.
+  Operation operation{Operation::Kind::Insert, id, properties};
+  if (!writableInstance().insert(id, std::move(properties))) {
+    return false;
+  }
+  m_uncommittedOperations.push_back(std::move(operation));
+  return true;
+}
+
+bool ConcurrentStore::insert(const EntityId id, const Properties &properties) {
+  if (!writableInstance().insert(id, properties)) {
+    return false;
+  }
+  m_uncommittedOperations.push_back(Operation{Operation::Kind::Insert, id, properties});
+  return true;
+}
+
+const Properties *ConcurrentStore::update(const EntityId id, Properties &&properties) {
+  Operation operation{Operation::Kind::Update, id, properties};
+  const auto *result = writableInstance().update(id, std::move(properties));
+  if (result != nullptr) {
+    m_uncommittedOperations.push_back(std::move(operation));
+  }
+  return result;
+}
+
+const Properties *ConcurrentStore::update(const EntityId id, const Properties &properties) {
+  const auto *result = writableInstance().update(id, properties);
+  if (result != nullptr) {
+    m_uncommittedOperations.push_back(Operation{Operation::Kind::Update, id, properties});
+  }
+  return result;
+}
+
+bool ConcurrentStore::contains(const EntityId id) const {
+  return writableInstance().contains(id);
+}
+
+const Properties *ConcurrentStore::tryGet(const EntityId id) const {
+  return writableInstance().tryGet(id);
+}
+
+const Properties &ConcurrentStore::get(const EntityId id) const {
+  return writableInstance().get(id);
+}
+
+bool ConcurrentStore::remove(const EntityId id) {
+  if (!writableInstance().remove(id)) {
+    return false;
+  }
+  m_uncommittedOperations.push_back(Operation{Operation::Kind::Remove, id});
+  return true;
+}
+
+// Every entity has to be copied anyway, so the batches are processed entity by entity.
+BatchResult ConcurrentStore::insertBatch(std::span<Entity> entities) {
+  return processBatch(entities, [this](Entity &entity) { return insert(entity.id(), std::move(entity).properties()); });
+}
+
+BatchResult ConcurrentStore::insertBatch(std::span<const Entity> entities) {
+  return processBatch(entities, [this](const Entity &entity) { return insert(entity.id(), entity.properties()); });
+}
+
+BatchResult ConcurrentStore::updateBatch(std::span<Entity> entities) {
+  return processBatch(entities, [this](Entity &entity) {
+    return update(entity.id(), std::move(entity).properties()) != nullptr;
+  });
+}
+
+BatchResult ConcurrentStore::updateBatch(std::span<const Entity> entities) {
+  return processBatch(entities,
+                      [this](const Entity &entity) { return update(entity.id(), entity.properties()) != nullptr; });
+}
+
+BatchResult ConcurrentStore::removeBatch(std::span<const EntityId> ids) {
+  return processBatch(ids, [this](const EntityId id) { return remove(id); });
+}
+
+void ConcurrentStore::applyChanges(ChangeSet &&changes) {
+  applyChangesByBatches(*this, std::move(changes));
+}
+
+EntityIdSet ConcurrentStore::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return writableInstance().filterIds(predicate, executor);
+}
+
+EntityIdSet ConcurrentStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                       const QueryExecutor *executor) const {
+  return writableInstance().filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> ConcurrentStore::estimate(const IndexLookup &lookup,
+                                                       const size_t maxMatchingEntities) const {
+  return writableInstance().estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator ConcurrentStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                         const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  return writableInstance().aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *ConcurrentStore::asRootStore() const {
+  return &writableInstance();
+}
+
+const NestedStore *ConcurrentStore::asNestedStore() const {
+  return nullptr;
+}
+
+bool ConcurrentStore::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  if (!writableInstance().createIndex(propertyId, indexType)) {
+    return false;
+  }
+  m_uncommittedOperations.push_back(Operation{Operation::Kind::CreateIndex, 0, {}, propertyId, indexType});
+  return true;
+}
+
+bool ConcurrentStore::dropIndex(const PropertyId propertyId) {
+  if (!writableInstance().dropIndex(propertyId)) {
+    return false;
+  }
+  m_uncommittedOperations.push_back(Operation{Operation::Kind::DropIndex, 0, {}, propertyId});
+  return true;
+}
+
+// The readers that started to read the previously visible instance before the swap can still read it, so the
+// operations can be applied to it only after they are finished. The readers that start after the swap always read the
+// new instance, so the writer has to wait only for a limited time.
+void ConcurrentStore::commit() {
+  if (m_uncommittedOperations.empty()) {
+    return;
+  }
+  const auto previousInstanceIndex = m_visibleInstanceIndex.load();
+  if (isPinnedByThisThread(previousInstanceIndex)) {
+    throw std::logic_error("The snapshots of the committing thread must be destroyed before commit!");
+  }
+  m_visibleInstanceIndex.store(1U - previousInstanceIndex);
+  while (m_numberOfReaders[previousInstanceIndex].load() != 0U) {
+    std::this_thread::yield();
+  }
+
+  auto &previousInstance = m_instances[previousInstanceIndex];
+  for (auto &operation: m_uncommittedOperations) {
+    applyOperation(previousInstance, std::move(operation));
+  }
+  m_uncommittedOperations.clear();
+}
+
+void ConcurrentStore::rollback() {
+  if (m_uncommittedOperations.empty()) {
+    return;
+  }
+  // The visible instance is only read by the readers, so it can be copied without waiting for them.
+  writableInstance() = m_instances[m_visibleInstanceIndex.load()];
+  m_uncommittedOperations.clear();
+}
+
+void ConcurrentStore::shrink() {
+  writableInstance().shrink();
+  m_uncommittedOperations.push_back(Operation{Operation::Kind::Shrink});
+}
+
+// The two instances contain the same entities in the same slots, so the compaction moves the same entities in both.
+bool ConcurrentStore::compact(const size_t maxMovedEntities) {
+  const auto isCompacted = writableInstance().compact(maxMovedEntities);
+  Operation operation{Operation::Kind::Compact};
+  operation.maxMovedEntities = maxMovedEntities;
+  operation.isCompacted = isCompacted;
+  m_uncommittedOperations.push_back(std::move(operation));
+  return isCompacted;
+}
+
+RootStore &ConcurrentStore::writableInstance() {
+  return m_instances[1U - m_visibleInstanceIndex.load(std::memory_order_relaxed)];
+}
+
+const RootStore &ConcurrentStore::writableInstance() const {
+  return m_instances[1U - m_visibleInstanceIndex.load(std::memory_order_relaxed)];
+}
+
+// The reader announces itself before it checks whether the instance is still visible, while the writer swaps the
+// instances before it checks the readers of the previous instance. Both of them use sequentially consistent operations,
+// so either the reader sees the swap and retries or the writer sees the reader and waits for it.
+size_t ConcurrentStore::pinVisibleInstance() const {
+  while (true) {
+    const auto instanceIndex = m_visibleInstanceIndex.load();
+    m_numberOfReaders[instanceIndex].fetch_add(1U);
+    if (m_visibleInstanceIndex.load() == instanceIndex) {
+      return instanceIndex;
+    }
+    unpinInstance(instanceIndex);
+  }
+}
+
+void ConcurrentStore::unpinInstance(const size_t instanceIndex) const {
+  m_numberOfReaders[instanceIndex].fetch_sub(1U, std::memory_order_release);
+}
+
+const std::shared_ptr<ConcurrentStore::ThreadPins> &ConcurrentStore::pinsOfThisThread() {
+  thread_local const auto pins = std::make_shared<ThreadPins>();
+  return pins;
+}
+
+bool ConcurrentStore::isPinnedByThisThread(const size_t instanceIndex) const {
+  auto &pins = *pinsOfThisThread();
+  const std::lock_guard lock{pins.mutex};
+  return std::find(pins.pinnedInstances.begin(), pins.pinnedInstances.end(), std::pair{this, instanceIndex}) !=
+         pins.pinnedInstances.end();
+}
+
+// Only the successful operations are recorded and the two instances contain the same entities in the same slots, so
+// the replayed operations must have the same result. Otherwise the instances diverged.
+void ConcurrentStore::applyOperation(RootStore &store, Operation &&operation) {
+  bool hasSameResult{true};
+  switch (operation.kind) {
+  case Operation::Kind::Insert:
+    hasSameResult = store.insert(operation.id, std::move(operation.properties));
+    break;
+  case Operation::Kind::Update:
+    hasSameResult = store.update(operation.id, std::move(operation.properties)) != nullptr;
+    break;
+  case Operation::Kind::Remove:
+    hasSameResult = store.remove(operation.id);
+    break;
+  case Operation::Kind::CreateIndex:
+    hasSameResult = store.createIndex(operation.propertyId, operation.indexType);
+    break;
+  case Operation::Kind::DropIndex:
+    hasSameResult = store.dropIndex(operation.propertyId);
+    break;
+  case Operation::Kind::Shrink:
+    store.shrink();
+    break;
+  case Operation::Kind::Compact:
+    hasSameResult = store.compact(operation.maxMovedEntities) == operation.isCompacted;
+    break;
+  }
+  MY_ASSERT(hasSameResult, "The replayed operation must have the same result as the original one");
+}
+
+ConcurrentStoreSnapshot::ConcurrentStoreSnapshot(const ConcurrentStore &store, const size_t instanceIndex)
+  : m_store{store}
+  , m_instanceIndex{instanceIndex}
+  , m_threadPins{ConcurrentStore::pinsOfThisThread()} {
+  const std::lock_guard lock{m_threadPins->mutex};
+  m_threadPins->pinnedInstances.emplace_back(&m_store, m_instanceIndex);
+}
+
+ConcurrentStoreSnapshot::~ConcurrentStoreSnapshot() {
+  {
+    const std::lock_guard lock{m_threadPins->mutex};
+    auto &pinnedInstances = m_threadPins->pinnedInstances;
+    pinnedInstances.erase(
+        std::find(pinnedInstances.begin(), pinnedInstances.end(), std::pair{&m_store, m_instanceIndex}));
+  }
+  m_store.unpinInstance(m_instanceIndex);
+}
+
+bool ConcurrentStoreSnapshot::insert(const EntityId /*id*/, Properties && /*properties*/) {
+  throwReadOnly();
+}
+
+bool ConcurrentStoreSnapshot::insert(const EntityId /*id*/, const Properties & /*properties*/) {
+  throwReadOnly();
+}
+
+const Properties *ConcurrentStoreSnapshot::update(const EntityId /*id*/, Properties && /*properties*/) {
+  throwReadOnly();
+}
+
+const Properties *ConcurrentStoreSnapshot::update(const EntityId /*id*/, const Properties & /*properties*/) {
+  throwReadOnly();
+}
+
+bool ConcurrentStoreSnapshot::contains(const EntityId id) const {
+  return m_store.m_instances[m_instanceIndex].contains(id);
+}
+
+const Properties *ConcurrentStoreSnapshot::tryGet(const EntityId id) const {
+  return m_store.m_instances[m_instanceIndex].tryGet(id);
+}
+
+const Properties &ConcurrentStoreSnapshot::get(const EntityId id) const {
+  return m_store.m_instances[m_instanceIndex].get(id);
+}
+
+bool ConcurrentStoreSnapshot::remove(const EntityId /*id*/) {
+  throwReadOnly();
+}
+
+BatchResult ConcurrentStoreSnapshot::insertBatch(std::span<Entity> /*entities*/) {
+  throwReadOnly();
+}
+
+BatchResult ConcurrentStoreSnapshot::insertBatch(std::span<const Entity> /*entities*/) {
+  throwReadOnly();
+}
+
+BatchResult ConcurrentStoreSnapshot::updateBatch(std::span<Entity> /*entities*/) {
+  throwReadOnly();
+}
+
+BatchResult ConcurrentStoreSnapshot::updateBatch(std::span<const Entity> /*entities*/) {
+  throwReadOnly();
+}
+
+BatchResult ConcurrentStoreSnapshot::removeBatch(std::span<const EntityId> /*ids*/) {
+  throwReadOnly();
+}
+
+void ConcurrentStoreSnapshot::applyChanges(ChangeSet && /*changes*/) {
+  throwReadOnly();
+}
+
+EntityIdSet ConcurrentStoreSnapshot::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return m_store.m_instances[m_instanceIndex].filterIds(predicate, executor);
+}
+
+EntityIdSet ConcurrentStoreSnapshot::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                               const QueryExecutor *executor) const {
+  return m_store.m_instances[m_instanceIndex].filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> ConcurrentStoreSnapshot::estimate(const IndexLookup &lookup,
+                                                               const size_t maxMatchingEntities) const {
+  return m_store.m_instances[m_instanceIndex].estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator ConcurrentStoreSnapshot::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                                 const AnyAggregator &emptyAggregator,
+                                                 const QueryExecutor *executor) const {
+  return m_store.m_instances[m_instanceIndex].aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *ConcurrentStoreSnapshot::asRootStore() const {
+  return &m_store.m_instances[m_instanceIndex];
+}
+
+const NestedStore *ConcurrentStoreSnapshot::asNestedStore() const {
+  return nullptr;
+}
+
+bool ConcurrentStoreSnapshot::createIndex(const PropertyId /*propertyId*/, const IndexType /*indexType*/) {
+  throwReadOnly();
+}
+
+bool ConcurrentStoreSnapshot::dropIndex(const PropertyId /*propertyId*/) {
+  throwReadOnly();
+}
+
+void ConcurrentStoreSnapshot::commit() {
+  throwReadOnly();
+}
+
+void ConcurrentStoreSnapshot::rollback() {
+  throwReadOnly();
+}
+
+// Shrinking doesn't change the content of the store, but it modifies the instance, so it cannot be done by a reader.
+void ConcurrentStoreSnapshot::shrink() {
+  throwReadOnly();
+}
+
+bool ConcurrentStoreSnapshot::compact(const size_t /*maxMovedEntities*/) {
+  throwReadOnly();
+}
+
+void ConcurrentStoreSnapshot::throwReadOnly() {
+  throw std::logic_error("The snapshot of a concurrent store is read only!");
+}
+
+} // namespace EntityStore
@@ -0,0 +1,59 @@
+#include "EntityStore/Internal/EmptySlots.hpp"
+
+#include <algorithm>
+
+#include "utils/Assert.hpp"
+
+namespace EntityStore {
+
+using utils::containers::DynamicBitset;
+
+bool EmptySlots::empty() const {
+  return m_size == 0U;
+}
+
+size_t EmptySlots::size() const {
+  return m_size;
+}
+
+void EmptySlots::insert(const size_t slot) {
+  if (slot >= m_slots.size()) {
+    m_slots.resize(slot + 1U);
+    m_nonEmptyWords.resize(m_slots.words().size());
+  }
+  MY_ASSERT(!m_slots.test(slot), "The slot is already empty");
+  const auto wordIndex = slot / DynamicBitset::kBitsPerWord;
+  m_slots.set(slot);
+  m_nonEmptyWords.set(wordIndex);
+  m_firstCandidateWord = std::min(m_firstCandidateWord, wordIndex);
+  ++m_size;
+}
+
+void EmptySlots::erase(const size_t slot) {
+  MY_ASSERT(slot < m_slots.size() && m_slots.test(slot), "The slot is not empty");
+  const auto wordIndex = slot / DynamicBitset::kBitsPerWord;
+  m_slots.reset(slot);
+  if (m_slots.words()[wordIndex] == 0U) {
+    m_nonEmptyWords.reset(wordIndex);
+  }
+  --m_size;
+}
+
+size_t EmptySlots::extractFirst() {
+  MY_ASSERT(!empty(), "There is no empty slot");
+  m_firstCandidateWord = m_nonEmptyWords.findNext(m_firstCandidateWord);
+  const auto slot = m_slots.findNext(m_firstCandidateWord * DynamicBitset::kBitsPerWord);
+  erase(slot);
+  return slot;
+}
+
+void EmptySlots::clear() {
+  m_slots.clear();
+  m_slots.shrinkToFit();
+  m_nonEmptyWords.clear();
+  m_nonEmptyWords.shrinkToFit();
+  m_firstCandidateWord = 0U;
+  m_size = 0U;
+}
+
+} // namespace EntityStore
@@ -0,0 +1,55 @@
+#include "EntityStore/Internal/EntityIdFilter.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace EntityStore {
+
+// With 16 bits per id and 2 bits set by every id the false positive rate is around 2%.
+constexpr size_t kBitsPerId{16U};
+constexpr size_t kBitsPerWord{64U};
+constexpr uint64_t kBitIndexMask{kBitsPerWord - 1U};
+
+uint64_t getBits(const uint64_t idHash) {
+  constexpr auto kFirstBitShift{32U};
+  constexpr auto kSecondBitShift{38U};
+  return (uint64_t{1U} << ((idHash >> kFirstBitShift) & kBitIndexMask)) |
+         (uint64_t{1U} << ((idHash >> kSecondBitShift) & kBitIndexMask));
+}
+
+// The finalizer of SplitMix64, the ids are usually sequential, so they have to be mixed well.
+uint64_t EntityIdFilter::hash(const EntityId id) {
+  constexpr uint64_t kFirstMultiplier{0xbf58476d1ce4e5b9U};
+  constexpr uint64_t kSecondMultiplier{0x94d049bb133111ebU};
+  auto result = id;
+  result = (result ^ (result >> 30U)) * kFirstMultiplier;
+  result = (result ^ (result >> 27U)) * kSecondMultiplier;
+  return result ^ (result >> 31U);
+}
+
+void EntityIdFilter::insert(const EntityId id) {
+  const auto idHash = hash(id);
+  m_words[idHash & (m_words.size() - 1U)] |= getBits(idHash);
+  ++m_numberOfIds;
+}
+
+bool EntityIdFilter::mayContain(const uint64_t idHash) const {
+  if (m_words.empty()) {
+    return false;
+  }
+  const auto bits = getBits(idHash);
+  return (m_words[idHash & (m_words.size() - 1U)] & bits) == bits;
+}
+
+bool EntityIdFilter::isFull() const {
+  return m_numberOfIds * kBitsPerId >= m_words.size() * kBitsPerWord;
+}
+
+// The number of words is a power of two, so the word of an id can be selected by masking.
+void EntityIdFilter::reset(const size_t capacity) {
+  const auto numberOfWords = std::bit_ceil(std::max<size_t>(1U, capacity * kBitsPerId / kBitsPerWord));
+  m_words.assign(numberOfWords, 0U);
+  m_numberOfIds = 0U;
+}
+
+} // namespace EntityStore
@@ -1,5 +1,7 @@
 #include "EntityStore/Internal/EntityStatesManager.hpp"
 
+#include <utility>
+
 namespace EntityStore {
 
 void EntityStateHandler::insert() {
@@ -37,6 +39,7 @@ void EntityStateHandler::remove() {
   case EntityState::Default:
   case EntityState::OnlyUpdated:
     m_state = EntityState::RemovedByThis;
+    m_updatedProperties.reset();
     return;
   case EntityState::InsertedByThis:
     m_state = EntityState::Default;
@@ -49,6 +52,10 @@ void EntityStateHandler::remove() {
   }
 }
 
+void EntityStateHandler::addUpdatedProperties(const PropertyMask &propertyIds) {
+  m_updatedProperties |= propertyIds;
+}
+
 bool EntityStateHandler::needsToInsertToParent() const {
   // If it is reinserted, then the new entity might not contain some of the original properties, therefore the previous
   // properties have to be removed.
@@ -67,16 +74,49 @@ const EntityState &EntityStateHandler::state() const {
   return m_state;
 }
 
+const PropertyMask &EntityStateHandler::updatedProperties() const {
+  return m_updatedProperties;
+}
+
+EntityStatesManager::EntityStatesManager()
+  : m_arena{std::make_unique<StateHandlerArena>()} {
+}
+
+// NOLINTNEXTLINE(performance-noexcept-move-constructor)
+EntityStatesManager::EntityStatesManager(EntityStatesManager &&other)
+  : m_arena{std::exchange(other.m_arena, std::make_unique<StateHandlerArena>())}
+  , m_filter{std::move(other.m_filter)}
+  , m_touchedIds{std::move(other.m_touchedIds)}
+  , m_changedIds{std::move(other.m_changedIds)} {
+}
+
+// The arenas are swapped, so the old handlers are destroyed together with the moved-from manager. When a child store is
+// reset, it means a single release of the pool instead of freeing every handler one by one.
+// NOLINTNEXTLINE(performance-noexcept-move-constructor)
+EntityStatesManager &EntityStatesManager::operator=(EntityStatesManager &&other) {
+  if (&other != this) {
+    std::swap(m_arena, other.m_arena);
+    m_filter = std::move(other.m_filter);
+    m_touchedIds = std::move(other.m_touchedIds);
+    m_changedIds = std::move(other.m_changedIds);
+  }
+  return *this;
+}
+
 const EntityStateHandler *EntityStatesManager::tryGetState(const EntityId id) const {
-  auto it = m_stateHandlers.find(id);
-  if (it == m_stateHandlers.end()) {
+  auto it = m_arena->stateHandlers.find(id);
+  if (it == m_arena->stateHandlers.end()) {
     return nullptr;
   }
   return &it->second;
 }
 
 const EntityStateHandler &EntityStatesManager::getState(const EntityId id) const {
-  return m_stateHandlers.at(id);
+  return m_arena->stateHandlers.at(id);
+}
+
+bool EntityStatesManager::mayHaveState(const uint64_t idHash) const {
+  return m_filter.mayContain(idHash);
 }
 
 EntityTransaction EntityStatesManager::startInsert(const EntityId id) {
@@ -91,21 +131,79 @@ EntityTransaction EntityStatesManager::startRemove(const EntityId id) {
   return EntityTransaction(*this, id, EntityTransaction::Type::Remove);
 }
 
-std::unordered_set<EntityId> EntityStatesManager::createEntityIdsSet() const {
-  std::unordered_set<EntityId> entityIds;
-  entityIds.reserve(m_stateHandlers.size());
-  for (const auto &p: m_stateHandlers) {
-    entityIds.insert(p.first);
+void EntityStatesManager::removeTouchedIds(EntityIdSet &ids) const {
+  if (m_changedIds.empty()) {
+    ids -= m_touchedIds;
+    return;
   }
-  return entityIds;
+  const auto [addedIds, erasedIds] = splitChangedIds();
+  // The erased ids might still be in the touched ids, but they are not touched anymore, so they have to be kept.
+  const auto untouchedIds = ids & erasedIds;
+  ids -= m_touchedIds;
+  ids -= addedIds;
+  ids |= untouchedIds;
 }
 
 bool EntityStatesManager::eraseStateHandler(const EntityId id) {
-  return m_stateHandlers.erase(id) > 0;
+  if (m_arena->stateHandlers.erase(id) == 0) {
+    return false;
+  }
+  recordChangedId(id);
+  return true;
 }
 
 const EntityStatesManager::StateHandlerMap &EntityStatesManager::stateHandlers() const {
-  return m_stateHandlers;
+  return m_arena->stateHandlers;
+}
+
+void EntityStatesManager::addState(const EntityId id) {
+  addToFilter(id);
+  recordChangedId(id);
+}
+
+void EntityStatesManager::addToFilter(const EntityId id) {
+  if (!m_filter.isFull()) {
+    m_filter.insert(id);
+    return;
+  }
+  // The handler of the id is already in the map, so it is added by the rebuild. The capacity is doubled to make the
+  // rebuilds amortized constant time.
+  m_filter.reset(2U * m_arena->stateHandlers.size());
+  for (const auto &p: m_arena->stateHandlers) {
+    m_filter.insert(p.first);
+  }
+}
+
+// If there are no queries, then the changed ids would pile up, so they are merged when there are more of them than
+// touched ids. It keeps the memory usage proportional to the number of touched ids and the merges amortized cheap.
+void EntityStatesManager::recordChangedId(const EntityId id) {
+  constexpr size_t kMinNumberOfChangedIdsToMerge{1024U};
+  m_changedIds.push_back(id);
+  if (m_changedIds.size() >= kMinNumberOfChangedIdsToMerge && m_changedIds.size() > m_arena->stateHandlers.size()) {
+    mergeChangedIds();
+  }
+}
+
+// The state of an id might have been added and erased many times since the last merge, so the map decides whether it
+// is still touched or not.
+std::pair<EntityIdSet, EntityIdSet> EntityStatesManager::splitChangedIds() const {
+  std::vector<EntityId> addedIds;
+  std::vector<EntityId> erasedIds;
+  for (const auto id: EntityIdSet::fromUnsorted(m_changedIds)) {
+    if (m_arena->stateHandlers.contains(id)) {
+      addedIds.push_back(id);
+    } else {
+      erasedIds.push_back(id);
+    }
+  }
+  return {EntityIdSet::fromSorted(std::move(addedIds)), EntityIdSet::fromSorted(std::move(erasedIds))};
+}
+
+void EntityStatesManager::mergeChangedIds() {
+  const auto [addedIds, erasedIds] = splitChangedIds();
+  m_touchedIds -= erasedIds;
+  m_touchedIds |= addedIds;
+  m_changedIds.clear();
 }
 
 void EntityTransaction::abort() {
@@ -131,8 +229,13 @@ const EntityStateHandler *EntityTransaction::operator->() const {
 EntityTransaction::EntityTransaction(EntityStatesManager &manager, const EntityId id, Type type)
   : m_manager{manager}
   , m_type{type}
-  , m_handlerIt{m_manager.m_stateHandlers.try_emplace(id, EntityStateHandler()).first}
+  , m_handlerIt{}
   , m_aborted{false} {
+  const auto [handlerIt, isInserted] = m_manager.m_arena->stateHandlers.try_emplace(id, EntityStateHandler());
+  m_handlerIt = handlerIt;
+  if (isInserted) {
+    m_manager.addState(id);
+  }
 }
 
 EntityTransaction::~EntityTransaction() {
@@ -151,7 +254,9 @@ EntityTransaction::~EntityTransaction() {
       }
     }
     if (m_handlerIt->second.state() == EntityState::Default) {
-      m_handlerIt = m_manager.m_stateHandlers.erase(m_handlerIt);
+      const auto id = m_handlerIt->first;
+      m_handlerIt = m_manager.m_arena->stateHandlers.erase(m_handlerIt);
+      m_manager.recordChangedId(id);
     }
   } catch (...) {
     // logging something is a better idea then doing nothing
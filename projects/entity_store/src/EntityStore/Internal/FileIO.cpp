@@ -0,0 +1,114 @@
+#include "EntityStore/Internal/FileIO.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ENTITY_STORE_HAS_POSIX_FILES
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace EntityStore {
+
+[[noreturn]] void throwLastError(const std::filesystem::path &path) {
+  throw std::system_error(errno, std::generic_category(), path.string());
+}
+
+void OutputFile::FileCloser::operator()(std::FILE *file) const {
+  static_cast<void>(std::fclose(file));
+}
+
+OutputFile::OutputFile(const std::filesystem::path &path, const Mode mode)
+  : m_path{path}
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  , m_file{std::fopen(path.string().c_str(), mode == Mode::Append ? "ab" : "wb")} {
+  if (m_file == nullptr) {
+    throwLastError(m_path);
+  }
+}
+
+void OutputFile::write(std::span<const std::byte> bytes) {
+  if (bytes.empty()) {
+    return;
+  }
+  if (std::fwrite(bytes.data(), 1U, bytes.size(), m_file.get()) != bytes.size()) {
+    throwLastError(m_path);
+  }
+}
+
+void OutputFile::sync() {
+  if (std::fflush(m_file.get()) != 0) {
+    throwLastError(m_path);
+  }
+#ifdef ENTITY_STORE_HAS_POSIX_FILES
+  if (::fsync(::fileno(m_file.get())) != 0) {
+    throwLastError(m_path);
+  }
+#endif
+}
+
+void OutputFile::close() {
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  if (std::fclose(m_file.release()) != 0) {
+    throwLastError(m_path);
+  }
+}
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef ENTITY_STORE_HAS_POSIX_FILES
+  const auto fileDescriptor = ::open(path.string().c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (fileDescriptor < 0) {
+    throwLastError(path);
+  }
+  struct stat fileStatus {};
+  if (::fstat(fileDescriptor, &fileStatus) != 0) {
+    ::close(fileDescriptor);
+    throwLastError(path);
+  }
+  m_size = static_cast<size_t>(fileStatus.st_size);
+  // Mapping an empty file is an error, but there is nothing to map anyway.
+  if (m_size != 0U) {
+    m_mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (m_mapping == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+      m_mapping = nullptr;
+      ::close(fileDescriptor);
+      throwLastError(path);
+    }
+    // The files are read from the beginning to the end, so the kernel can read ahead aggressively.
+    ::madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+  }
+  ::close(fileDescriptor);
+#else
+  std::ifstream file{path, std::ios::binary | std::ios::ate};
+  if (!file) {
+    throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path.string());
+  }
+  m_buffer.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  file.read(reinterpret_cast<char *>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+  m_size = m_buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef ENTITY_STORE_HAS_POSIX_FILES
+  if (m_mapping != nullptr) {
+    ::munmap(m_mapping, m_size);
+  }
+#endif
+}
+
+std::span<const std::byte> MappedFile::bytes() const {
+  if (m_mapping != nullptr) {
+    return {static_cast<const std::byte *>(m_mapping), m_size};
+  }
+  return m_buffer;
+}
+
+} // namespace EntityStore
@@ -0,0 +1,68 @@
+#include "EntityStore/Internal/Instrumentation.hpp"
+
+namespace EntityStore {
+
+void Instrumentation::recordLatency(const StoreOperation operation, const std::chrono::nanoseconds latency) {
+  m_latencies[asUnderlying(operation)].add(static_cast<uint64_t>(latency.count()));
+}
+
+void Instrumentation::recordScan(const uint64_t scannedEntities, const uint64_t matchedEntities) {
+  m_scannedEntities.fetch_add(scannedEntities, std::memory_order_relaxed);
+  m_matchedEntities.fetch_add(matchedEntities, std::memory_order_relaxed);
+}
+
+void Instrumentation::recordTraversedLevels(const uint64_t levels) {
+  m_traversedLevels.add(levels);
+}
+
+void Instrumentation::recordCommit(const uint64_t numberOfChanges) {
+  m_commitSizes.add(numberOfChanges);
+}
+
+StoreStatistics Instrumentation::snapshot() const {
+  StoreStatistics statistics;
+  for (size_t operation{0U}; operation < m_latencies.size(); ++operation) {
+    statistics.latencies[operation] = m_latencies[operation].load();
+  }
+  statistics.scannedEntities = m_scannedEntities.load(std::memory_order_relaxed);
+  statistics.matchedEntities = m_matchedEntities.load(std::memory_order_relaxed);
+  statistics.traversedLevels = m_traversedLevels.load();
+  statistics.commitSizes = m_commitSizes.load();
+  return statistics;
+}
+
+void Instrumentation::reset() {
+  for (auto &latency: m_latencies) {
+    latency.reset();
+  }
+  m_scannedEntities.store(0U, std::memory_order_relaxed);
+  m_matchedEntities.store(0U, std::memory_order_relaxed);
+  m_traversedLevels.reset();
+  m_commitSizes.reset();
+}
+
+void Instrumentation::AtomicHistogram::add(const uint64_t value) {
+  m_buckets[Log2Histogram::bucketOf(value)].fetch_add(1U, std::memory_order_relaxed);
+  m_count.fetch_add(1U, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Log2Histogram Instrumentation::AtomicHistogram::load() const {
+  Log2Histogram histogram;
+  for (size_t bucket{0U}; bucket < m_buckets.size(); ++bucket) {
+    histogram.buckets[bucket] = m_buckets[bucket].load(std::memory_order_relaxed);
+  }
+  histogram.count = m_count.load(std::memory_order_relaxed);
+  histogram.sum = m_sum.load(std::memory_order_relaxed);
+  return histogram;
+}
+
+void Instrumentation::AtomicHistogram::reset() {
+  for (auto &bucket: m_buckets) {
+    bucket.store(0U, std::memory_order_relaxed);
+  }
+  m_count.store(0U, std::memory_order_relaxed);
+  m_sum.store(0U, std::memory_order_relaxed);
+}
+
+} // namespace EntityStore
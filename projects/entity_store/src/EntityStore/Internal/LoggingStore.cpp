@@ -0,0 +1,246 @@
+#include "EntityStore/Internal/LoggingStore.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include "EntityStore/Internal/Snapshot.hpp"
+
+namespace EntityStore {
+
+bool hasChanged(const bool result) {
+  return result;
+}
+
+bool hasChanged(const Properties *result) {
+  return result != nullptr;
+}
+
+bool hasChanged(const BatchResult &result) {
+  return result.any();
+}
+
+LoggingStore::LoggingStore(RootStore &&store, std::filesystem::path snapshotPath, std::filesystem::path logPath,
+                           const WriteAheadLogOptions &options, const uint64_t lastLogSequenceNumber)
+  : m_store{std::move(store)}
+  , m_snapshotPath{std::move(snapshotPath)}
+  , m_log{std::move(logPath), options, lastLogSequenceNumber} {
+}
+
+std::unique_ptr<LoggingStore> LoggingStore::open(const std::filesystem::path &snapshotPath,
+                                                 const std::filesystem::path &logPath,
+                                                 const WriteAheadLogOptions &options) {
+  auto snapshot =
+      std::filesystem::exists(snapshotPath) ? loadSnapshot(snapshotPath) : LoadedSnapshot{RootStore{}, 0U};
+  const auto replayResult = replayWriteAheadLog(logPath, snapshot.store, snapshot.logSequenceNumber);
+  if (std::filesystem::exists(logPath) && std::filesystem::file_size(logPath) != replayResult.validSize) {
+    std::filesystem::resize_file(logPath, replayResult.validSize);
+  }
+  return std::make_unique<LoggingStore>(std::move(snapshot.store), snapshotPath, logPath, options,
+                                        replayResult.lastLogSequenceNumber);
+}
+
+template <typename TEncodeFunc, typename TApplyFunc>
+auto LoggingStore::applyLogged(const LogRecordType type, TEncodeFunc &&encodeFunc, TApplyFunc &&applyFunc) {
+  if (m_hasFailedLogging) {
+    throw std::logic_error("The store cannot be modified after a modification failed to be logged!");
+  }
+  encodeFunc(m_log.startRecord(type));
+  bool isApplied{false};
+  try {
+    // The size of the record is checked before the modification is applied, so a too big modification is rejected
+    // without modifying the store.
+    m_log.checkRecordSize();
+    auto result = applyFunc();
+    isApplied = true;
+    if (hasChanged(result)) {
+      m_log.finishRecord();
+    } else {
+      m_log.cancelRecord();
+    }
+    return result;
+  } catch (...) {
+    if (isApplied) {
+      // The record is finished, but it might not have reached the file, so the store might contain a modification
+      // that cannot be recovered from the log. The following modifications would be lost after a crash too, so they
+      // are rejected until a checkpoint persists the whole store.
+      m_hasFailedLogging = true;
+    } else {
+      m_log.cancelRecord();
+    }
+    throw;
+  }
+}
+
+// A single modification is logged as a batch of one item, so the log doesn't need separate record types for them.
+bool LoggingStore::insert(const EntityId id, Properties &&properties) {
+  return applyLogged(
+      LogRecordType::Insert,
+      [id, &properties](BinaryWriter &writer) {
+        writer.write(uint64_t{1U});
+        writeLogEntity(writer, id, properties);
+      },
+      [this, id, &properties]() { return m_store.insert(id, std::move(properties)); });
+}
+
+bool LoggingStore::insert(const EntityId id, const Properties &properties) {
+  return applyLogged(
+      LogRecordType::Insert,
+      [id, &properties](BinaryWriter &writer) {
+        writer.write(uint64_t{1U});
+        writeLogEntity(writer, id, properties);
+      },
+      [this, id, &properties]() { return m_store.insert(id, properties); });
+}
+
+const Properties *LoggingStore::update(const EntityId id, Properties &&properties) {
+  return applyLogged(
+      LogRecordType::Update,
+      [id, &properties](BinaryWriter &writer) {
+        writer.write(uint64_t{1U});
+        writeLogEntity(writer, id, properties);
+      },
+      [this, id, &properties]() { return m_store.update(id, std::move(properties)); });
+}
+
+const Properties *LoggingStore::update(const EntityId id, const Properties &properties) {
+  return applyLogged(
+      LogRecordType::Update,
+      [id, &properties](BinaryWriter &writer) {
+        writer.write(uint64_t{1U});
+        writeLogEntity(writer, id, properties);
+      },
+      [this, id, &properties]() { return m_store.update(id, properties); });
+}
+
+bool LoggingStore::contains(const EntityId id) const {
+  return m_store.contains(id);
+}
+
+const Properties *LoggingStore::tryGet(const EntityId id) const {
+  return m_store.tryGet(id);
+}
+
+const Properties &LoggingStore::get(const EntityId id) const {
+  return m_store.get(id);
+}
+
+bool LoggingStore::remove(const EntityId id) {
+  return applyLogged(
+      LogRecordType::Remove, [id](BinaryWriter &writer) { writeLogIds(writer, std::span<const EntityId>{&id, 1U}); },
+      [this, id]() { return m_store.remove(id); });
+}
+
+// The batches are logged as a whole even if some of their items failed. They fail the same way during the replay, so
+// it is cheaper than filtering out the failed items.
+BatchResult LoggingStore::insertBatch(std::span<Entity> entities) {
+  return applyLogged(
+      LogRecordType::Insert, [entities](BinaryWriter &writer) { writeLogEntities(writer, entities); },
+      [this, entities]() { return m_store.insertBatch(entities); });
+}
+
+BatchResult LoggingStore::insertBatch(std::span<const Entity> entities) {
+  return applyLogged(
+      LogRecordType::Insert, [entities](BinaryWriter &writer) { writeLogEntities(writer, entities); },
+      [this, entities]() { return m_store.insertBatch(entities); });
+}
+
+BatchResult LoggingStore::updateBatch(std::span<Entity> entities) {
+  return applyLogged(
+      LogRecordType::Update, [entities](BinaryWriter &writer) { writeLogEntities(writer, entities); },
+      [this, entities]() { return m_store.updateBatch(entities); });
+}
+
+BatchResult LoggingStore::updateBatch(std::span<const Entity> entities) {
+  return applyLogged(
+      LogRecordType::Update, [entities](BinaryWriter &writer) { writeLogEntities(writer, entities); },
+      [this, entities]() { return m_store.updateBatch(entities); });
+}
+
+BatchResult LoggingStore::removeBatch(std::span<const EntityId> ids) {
+  return applyLogged(
+      LogRecordType::Remove, [ids](BinaryWriter &writer) { writeLogIds(writer, ids); },
+      [this, ids]() { return m_store.removeBatch(ids); });
+}
+
+void LoggingStore::applyChanges(ChangeSet &&changes) {
+  if (changes.empty()) {
+    return;
+  }
+  applyLogged(
+      LogRecordType::Changes, [&changes](BinaryWriter &writer) { writeLogChanges(writer, changes); },
+      [this, &changes]() {
+        m_store.applyChanges(std::move(changes));
+        return true;
+      });
+}
+
+EntityIdSet LoggingStore::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return m_store.filterIds(predicate, executor);
+}
+
+EntityIdSet LoggingStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                    const QueryExecutor *executor) const {
+  return m_store.filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> LoggingStore::estimate(const IndexLookup &lookup,
+                                                    const size_t maxMatchingEntities) const {
+  return m_store.estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator LoggingStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                      const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  return m_store.aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *LoggingStore::asRootStore() const {
+  return &m_store;
+}
+
+const NestedStore *LoggingStore::asNestedStore() const {
+  return nullptr;
+}
+
+bool LoggingStore::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  return m_store.createIndex(propertyId, indexType);
+}
+
+bool LoggingStore::dropIndex(const PropertyId propertyId) {
+  return m_store.dropIndex(propertyId);
+}
+
+void LoggingStore::commit() {
+  m_store.commit();
+}
+
+void LoggingStore::rollback() {
+  m_store.rollback();
+}
+
+void LoggingStore::shrink() {
+  m_store.shrink();
+}
+
+bool LoggingStore::compact(const size_t maxMovedEntities) {
+  return m_store.compact(maxMovedEntities);
+}
+
+void LoggingStore::syncLog() {
+  m_log.sync();
+}
+
+// If the process crashes after the snapshot is saved, but before the log is truncated, then the records are skipped
+// during the replay by their sequence numbers.
+//
+// After a failed logging the unwritten records are not synced again, because the snapshot contains their modifications
+// anyway, and the truncation drops them together with the records that might have been written partially.
+void LoggingStore::checkpoint() {
+  if (!m_hasFailedLogging) {
+    m_log.sync();
+  }
+  saveSnapshot(m_store, m_snapshotPath, m_log.lastLogSequenceNumber());
+  m_log.truncate();
+  m_hasFailedLogging = false;
+}
+
+} // namespace EntityStore
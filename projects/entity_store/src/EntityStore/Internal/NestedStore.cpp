@@ -2,6 +2,7 @@
 
 #include <utility>
 
+#include "EntityStore/Internal/InlinedFilter.hpp"
 #include "EntityStore/StoreExceptions.hpp"
 
 namespace EntityStore {
@@ -35,8 +36,10 @@ const Properties *doUpdate(const IStore &parentStore, RootStore &ownStore, Entit
     return nullptr;
   }
 
+  const auto updatedProperties = properties.mask();
   const auto *updatedPropertiesPtr = ownStore.update(id, std::forward<TProperties>(properties));
   if (updatedPropertiesPtr != nullptr) {
+    transaction->addUpdatedProperties(updatedProperties);
     return updatedPropertiesPtr;
   }
 
@@ -46,12 +49,35 @@ const Properties *doUpdate(const IStore &parentStore, RootStore &ownStore, Entit
     return nullptr;
   }
 
-  ownStore.insert(id, *parentPropertiesPtr);
-  return ownStore.update(id, std::forward<TProperties>(properties));
+  // The reads of the child return the whole properties, so the own store needs the merged version of them. It is built
+  // before inserting it, so the own store doesn't have to insert the properties of the parent and then update them.
+  Properties mergedProperties{*parentPropertiesPtr};
+  mergedProperties.update(std::forward<TProperties>(properties));
+  ownStore.insert(id, std::move(mergedProperties));
+  transaction->addUpdatedProperties(updatedProperties);
+  return ownStore.tryGet(id);
+}
+
+template <typename TEntity>
+BatchResult doInsertBatch(const IStore &parentStore, RootStore &ownStore, EntityStatesManager &statesManager,
+                          std::span<TEntity> entities) {
+  return processBatch(entities, [&](TEntity &entity) {
+    return doInsert(parentStore, ownStore, statesManager, entity.id(), forwardProperties(entity));
+  });
+}
+
+template <typename TEntity>
+BatchResult doUpdateBatch(const IStore &parentStore, RootStore &ownStore, EntityStatesManager &statesManager,
+                          std::span<TEntity> entities) {
+  return processBatch(entities, [&](TEntity &entity) {
+    return doUpdate(parentStore, ownStore, statesManager, entity.id(), forwardProperties(entity)) != nullptr;
+  });
 }
 
 NestedStore::NestedStore(IStore &parentStore)
   : m_parentStore{&parentStore}
+  , m_nestedParent{parentStore.asNestedStore()}
+  , m_chainRoot{m_nestedParent == nullptr ? &parentStore : m_nestedParent->m_chainRoot}
   , m_ownStore{}
   , m_statesManager{} {
 }
@@ -59,8 +85,11 @@ NestedStore::NestedStore(IStore &parentStore)
 // NOLINTNEXTLINE(performance-noexcept-move-constructor)
 NestedStore::NestedStore(NestedStore &&other)
   : m_parentStore{other.m_parentStore.get()}
+  , m_nestedParent{std::exchange(other.m_nestedParent, nullptr)}
+  , m_chainRoot{std::exchange(other.m_chainRoot, nullptr)}
   , m_ownStore{std::move(other.m_ownStore)}
-  , m_statesManager{std::move(other.m_statesManager)} {
+  , m_statesManager{std::move(other.m_statesManager)}
+  , m_instrumentation{std::exchange(other.m_instrumentation, nullptr)} {
   other.m_parentStore = nullptr;
 }
 
@@ -68,8 +97,11 @@ NestedStore::NestedStore(NestedStore &&other)
 NestedStore &NestedStore::operator=(NestedStore &&other) {
   if (&other != this) {
     m_parentStore = std::exchange(other.m_parentStore, nullptr);
+    m_nestedParent = std::exchange(other.m_nestedParent, nullptr);
+    m_chainRoot = std::exchange(other.m_chainRoot, nullptr);
     m_ownStore = std::move(other.m_ownStore);
     m_statesManager = std::move(other.m_statesManager);
+    m_instrumentation = std::exchange(other.m_instrumentation, nullptr);
   }
   return *this;
 }
@@ -91,20 +123,50 @@ const Properties *NestedStore::update(const EntityId id, const Properties &prope
   return doUpdate(*m_parentStore, m_ownStore, m_statesManager, id, properties);
 }
 
+// The levels are walked from this store towards the root, and a level can answer the read only if it touched the
+// entity: it either has the entity in its own store or it removed it. The number of visited levels is counted only for
+// the instrumentation, without it the counter is optimized out.
 bool NestedStore::contains(const EntityId id) const {
-  return m_ownStore.contains(id) || (!isRemovedByThisChild(id) && m_parentStore->contains(id));
+  const auto idHash = EntityIdFilter::hash(id);
+  uint64_t traversedLevels{0U};
+  for (const auto *level = this; level != nullptr; level = level->m_nestedParent) {
+    ++traversedLevels;
+    if (!level->m_statesManager.mayHaveState(idHash)) {
+      continue;
+    }
+    if (level->m_ownStore.contains(id)) {
+      recordTraversedLevels(traversedLevels);
+      return true;
+    }
+    if (level->isRemovedByThisChild(id)) {
+      recordTraversedLevels(traversedLevels);
+      return false;
+    }
+  }
+  recordTraversedLevels(traversedLevels + 1U);
+  return m_chainRoot->contains(id);
 }
 
 const Properties *NestedStore::tryGet(const EntityId id) const {
-  const auto *propertiesPtr = m_ownStore.tryGet(id);
-  if (propertiesPtr != nullptr) {
-    return propertiesPtr;
-  }
-
-  if (isRemovedByThisChild(id)) {
-    return nullptr;
+  const auto idHash = EntityIdFilter::hash(id);
+  uint64_t traversedLevels{0U};
+  for (const auto *level = this; level != nullptr; level = level->m_nestedParent) {
+    ++traversedLevels;
+    if (!level->m_statesManager.mayHaveState(idHash)) {
+      continue;
+    }
+    const auto *propertiesPtr = level->m_ownStore.tryGet(id);
+    if (propertiesPtr != nullptr) {
+      recordTraversedLevels(traversedLevels);
+      return propertiesPtr;
+    }
+    if (level->isRemovedByThisChild(id)) {
+      recordTraversedLevels(traversedLevels);
+      return nullptr;
+    }
   }
-  return m_parentStore->tryGet(id);
+  recordTraversedLevels(traversedLevels + 1U);
+  return m_chainRoot->tryGet(id);
 }
 
 const Properties &NestedStore::get(const EntityId id) const {
@@ -134,15 +196,83 @@ bool NestedStore::remove(const EntityId id) {
   return isRemoveSuccessfull;
 }
 
-std::unordered_set<EntityId> NestedStore::filterIds(const EntityPredicate &predicate) const {
-  std::unordered_set<EntityId> result;
-  result = m_ownStore.filterIds(predicate);
-  result.merge(m_parentStore->filterIds(IgnoreIds{m_statesManager.createEntityIdsSet()} | predicate));
-  return result;
+BatchResult NestedStore::insertBatch(std::span<Entity> entities) {
+  return doInsertBatch(*m_parentStore, m_ownStore, m_statesManager, entities);
+}
+
+BatchResult NestedStore::insertBatch(std::span<const Entity> entities) {
+  return doInsertBatch(*m_parentStore, m_ownStore, m_statesManager, entities);
+}
+
+BatchResult NestedStore::updateBatch(std::span<Entity> entities) {
+  return doUpdateBatch(*m_parentStore, m_ownStore, m_statesManager, entities);
+}
+
+BatchResult NestedStore::updateBatch(std::span<const Entity> entities) {
+  return doUpdateBatch(*m_parentStore, m_ownStore, m_statesManager, entities);
+}
+
+BatchResult NestedStore::removeBatch(std::span<const EntityId> ids) {
+  return processBatch(ids, [this](const EntityId id) { return NestedStore::remove(id); });
+}
+
+void NestedStore::applyChanges(ChangeSet &&changes) {
+  applyChangesByBatches(*this, std::move(changes));
+}
+
+// The entities that are touched by this store are either in the own store (inserted or updated) or removed by this
+// store, so the result of the parent is only valid for the untouched entities. Instead of filtering them out one by one
+// during the scan of the parent, they are subtracted from the result of the parent by a linear merge. The touched ids
+// are maintained by the states manager, so they are not collected and sorted again for every query.
+EntityIdSet NestedStore::combineWithParentResult(EntityIdSet &&ownResult, EntityIdSet &&parentResult) const {
+  m_statesManager.removeTouchedIds(parentResult);
+  parentResult |= ownResult;
+  return std::move(parentResult);
+}
+
+EntityIdSet NestedStore::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return filterIdsInlined(predicate, executor);
+}
+
+EntityIdSet NestedStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                   const QueryExecutor *executor) const {
+  return filterIdsInlined(predicate, lookup, executor);
 }
 
+// The changes of the child store are not indexed, but they are usually negligible compared to the parent store.
+std::optional<IndexEstimate> NestedStore::estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const {
+  return m_parentStore->estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator NestedStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                     const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  return aggregateLevels(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *NestedStore::asRootStore() const {
+  return nullptr;
+}
+
+const NestedStore *NestedStore::asNestedStore() const {
+  return this;
+}
+
+bool NestedStore::createIndex(const PropertyId /*propertyId*/, const IndexType /*indexType*/) {
+  return false;
+}
+
+bool NestedStore::dropIndex(const PropertyId /*propertyId*/) {
+  return false;
+}
+
+// The own store is moved into the change set, so the changes are thrown away even if the parent cannot apply them.
 void NestedStore::commit() {
-  doCommitChanges();
+  try {
+    doCommitChanges();
+  } catch (...) {
+    reset();
+    throw;
+  }
   reset();
 }
 
@@ -154,53 +284,73 @@ void NestedStore::shrink() {
   m_ownStore.shrink();
 }
 
+bool NestedStore::compact(const size_t maxMovedEntities) {
+  return m_ownStore.compact(maxMovedEntities);
+}
+
+void NestedStore::setInstrumentation(Instrumentation *instrumentation) {
+  m_instrumentation = instrumentation;
+}
+
 bool NestedStore::isRemovedByThisChild(const EntityId id) const {
   const auto *stateHandlerPtr = m_statesManager.tryGetState(id);
   return (stateHandlerPtr != nullptr && stateHandlerPtr->state() == EntityState::RemovedByThis);
 }
 
-void NestedStore::doCommitChanges() {
-  const auto removeWithCheck = [this](const EntityId id) {
-    if (!m_parentStore->remove(id)) {
-      throw std::logic_error("Cannot remove Entity while committing changes to parent!");
+void NestedStore::recordTraversedLevels(const uint64_t levels) const {
+  if constexpr (kIsInstrumentationEnabled) {
+    if (m_instrumentation != nullptr) {
+      m_instrumentation->recordTraversedLevels(levels);
     }
-  };
-
-  const auto handleEntity = [this, &removeWithCheck](Entity &&entity) {
-    const auto &stateHandler = m_statesManager.getState(entity.id());
+  }
+}
 
+// The changes are collected into a single change set, so the parent can apply them as a batch (e.g. a logged store can
+// write them as a single record). The entities are moved out of the own store, so the commit doesn't copy any
+// properties. The updated entities pass on only the properties that were set by the updates of this store, so the
+// parent (and its indices, write-ahead log and subscribers) doesn't process the unchanged properties again.
+void NestedStore::doCommitChanges() {
+  ChangeSet changes;
+  size_t numberOfOwnEntities{0U};
+  for (auto &&entityHolder: std::move(m_ownStore)) {
+    if (!entityHolder.has_value()) {
+      continue;
+    }
+    const auto entityId = entityHolder->id();
+    const auto &stateHandler = m_statesManager.getState(entityId);
     if (stateHandler.needsToUpdateInParent()) {
-      const auto entityId = entity.id();
-      if (m_parentStore->update(entityId, std::move(entity).properties()) == nullptr) {
-        throw std::logic_error("Cannot update Entity while committing changes to parent!");
-      }
+      changes.updated.emplace_back(entityId,
+                                   std::move(*entityHolder).properties().extract(stateHandler.updatedProperties()));
     } else {
       if (stateHandler.needsToRemoveFromParent()) {
-        removeWithCheck(entity.id());
+        changes.removed.push_back(entityId);
       }
       if (stateHandler.needsToInsertToParent()) {
-        const auto entityId = entity.id();
-        if (!m_parentStore->insert(entityId, std::move(entity).properties())) {
-          throw std::logic_error("Cannot insert Entity while committing changes to parent!");
-        }
+        changes.inserted.push_back(std::move(*entityHolder));
       }
     }
-  };
+    ++numberOfOwnEntities;
+  }
 
-  for (auto &&entityHolder: std::move(m_ownStore)) {
-    if (entityHolder.has_value()) {
-      auto entityId = entityHolder->id();
-      handleEntity(std::move(*entityHolder));
-      m_statesManager.eraseStateHandler(entityId);
+  // Every touched entity that is not in the own store must be removed by this store. The states are not erased one by
+  // one, because the whole states manager is reset after the commit anyway.
+  size_t numberOfRemovedEntities{0U};
+  for (auto const &[entityId, stateHandler]: m_statesManager.stateHandlers()) {
+    if (stateHandler.state() == EntityState::RemovedByThis) {
+      changes.removed.push_back(entityId);
+      ++numberOfRemovedEntities;
     }
   }
+  if (numberOfOwnEntities + numberOfRemovedEntities != m_statesManager.stateHandlers().size()) {
+    throw std::logic_error("Entity is expected to be in RemovedByThis state, but it isn't!");
+  }
 
-  for (auto const &[entityId, stateHandler]: m_statesManager.stateHandlers()) {
-    if (stateHandler.state() != EntityState::RemovedByThis) {
-      throw std::logic_error("Entity is expected to be in RemovedByThis state, but it isn't!");
+  if constexpr (kIsInstrumentationEnabled) {
+    if (m_instrumentation != nullptr) {
+      m_instrumentation->recordCommit(changes.removed.size() + changes.updated.size() + changes.inserted.size());
     }
-    removeWithCheck(entityId);
   }
+  m_parentStore->applyChanges(std::move(changes));
 }
 
 void NestedStore::reset() {
@@ -0,0 +1,240 @@
+#include "EntityStore/Internal/ObservedStore.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace EntityStore {
+
+ObservedStore::ObservedStore(std::unique_ptr<IStore> store, const bool publishesOnCommit)
+  : m_store{std::move(store)}
+  , m_publishesOnCommit{publishesOnCommit} {
+}
+
+std::shared_ptr<ChangeSubscription> ObservedStore::subscribe(const size_t capacity) {
+  return m_subscriptions.emplace_back(std::make_shared<ChangeSubscription>(capacity));
+}
+
+bool ObservedStore::insert(const EntityId id, Properties &&properties) {
+  const ChangeEvent event{ChangeType::Inserted, id, properties.mask()};
+  if (!m_store->insert(id, std::move(properties))) {
+    return false;
+  }
+  addEvent(event);
+  return true;
+}
+
+bool ObservedStore::insert(const EntityId id, const Properties &properties) {
+  if (!m_store->insert(id, properties)) {
+    return false;
+  }
+  addEvent(ChangeEvent{ChangeType::Inserted, id, properties.mask()});
+  return true;
+}
+
+const Properties *ObservedStore::update(const EntityId id, Properties &&properties) {
+  const ChangeEvent event{ChangeType::Updated, id, properties.mask()};
+  const auto *updatedProperties = m_store->update(id, std::move(properties));
+  if (updatedProperties != nullptr) {
+    addEvent(event);
+  }
+  return updatedProperties;
+}
+
+const Properties *ObservedStore::update(const EntityId id, const Properties &properties) {
+  const auto *updatedProperties = m_store->update(id, properties);
+  if (updatedProperties != nullptr) {
+    addEvent(ChangeEvent{ChangeType::Updated, id, properties.mask()});
+  }
+  return updatedProperties;
+}
+
+bool ObservedStore::contains(const EntityId id) const {
+  return m_store->contains(id);
+}
+
+const Properties *ObservedStore::tryGet(const EntityId id) const {
+  return m_store->tryGet(id);
+}
+
+const Properties &ObservedStore::get(const EntityId id) const {
+  return m_store->get(id);
+}
+
+bool ObservedStore::remove(const EntityId id) {
+  if (!m_store->remove(id)) {
+    return false;
+  }
+  addEvent(ChangeEvent{ChangeType::Removed, id, PropertyMask{}});
+  return true;
+}
+
+// The events are collected for every entity before the batch is applied, and the ones of the failed items are dropped
+// afterwards, or all of them if the batch throws. Without subscriptions the batch is simply forwarded.
+template <typename TEntity, typename TApplyFunc>
+BatchResult ObservedStore::applyObservedBatch(const ChangeType type, std::span<TEntity> entities,
+                                              TApplyFunc &&applyFunc) {
+  if (m_subscriptions.empty()) {
+    return applyFunc();
+  }
+  const auto firstEvent = m_events.size();
+  for (const auto &entity: entities) {
+    m_events.push_back(ChangeEvent{type, entity.id(), entity.properties().mask()});
+  }
+  BatchResult result;
+  try {
+    result = applyFunc();
+  } catch (...) {
+    m_events.resize(firstEvent);
+    throw;
+  }
+  size_t numberOfEvents{firstEvent};
+  for (size_t index{0U}; index < entities.size(); ++index) {
+    if (result.test(index)) {
+      m_events[numberOfEvents++] = m_events[firstEvent + index];
+    }
+  }
+  m_events.resize(numberOfEvents);
+  publishIfNotDeferred();
+  return result;
+}
+
+BatchResult ObservedStore::insertBatch(std::span<Entity> entities) {
+  return applyObservedBatch(ChangeType::Inserted, entities,
+                            [this, entities]() { return m_store->insertBatch(entities); });
+}
+
+BatchResult ObservedStore::insertBatch(std::span<const Entity> entities) {
+  return applyObservedBatch(ChangeType::Inserted, entities,
+                            [this, entities]() { return m_store->insertBatch(entities); });
+}
+
+BatchResult ObservedStore::updateBatch(std::span<Entity> entities) {
+  return applyObservedBatch(ChangeType::Updated, entities,
+                            [this, entities]() { return m_store->updateBatch(entities); });
+}
+
+BatchResult ObservedStore::updateBatch(std::span<const Entity> entities) {
+  return applyObservedBatch(ChangeType::Updated, entities,
+                            [this, entities]() { return m_store->updateBatch(entities); });
+}
+
+BatchResult ObservedStore::removeBatch(std::span<const EntityId> ids) {
+  auto result = m_store->removeBatch(ids);
+  if (!m_subscriptions.empty()) {
+    result.forEachSetBit([this, ids](const size_t index) {
+      m_events.push_back(ChangeEvent{ChangeType::Removed, ids[index], PropertyMask{}});
+    });
+    publishIfNotDeferred();
+  }
+  return result;
+}
+
+// The changes are published in the order they are applied, so an entity that was removed and inserted again by the
+// child store has a removed and an inserted event.
+void ObservedStore::applyChanges(ChangeSet &&changes) {
+  if (m_subscriptions.empty()) {
+    m_store->applyChanges(std::move(changes));
+    return;
+  }
+  const auto firstEvent = m_events.size();
+  m_events.reserve(firstEvent + changes.removed.size() + changes.updated.size() + changes.inserted.size());
+  for (const auto id: changes.removed) {
+    m_events.push_back(ChangeEvent{ChangeType::Removed, id, PropertyMask{}});
+  }
+  for (const auto &entity: changes.updated) {
+    m_events.push_back(ChangeEvent{ChangeType::Updated, entity.id(), entity.properties().mask()});
+  }
+  for (const auto &entity: changes.inserted) {
+    m_events.push_back(ChangeEvent{ChangeType::Inserted, entity.id(), entity.properties().mask()});
+  }
+  try {
+    m_store->applyChanges(std::move(changes));
+  } catch (...) {
+    m_events.resize(firstEvent);
+    throw;
+  }
+  publishIfNotDeferred();
+}
+
+EntityIdSet ObservedStore::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return m_store->filterIds(predicate, executor);
+}
+
+EntityIdSet ObservedStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                     const QueryExecutor *executor) const {
+  return m_store->filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> ObservedStore::estimate(const IndexLookup &lookup,
+                                                     const size_t maxMatchingEntities) const {
+  return m_store->estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator ObservedStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                       const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  return m_store->aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *ObservedStore::asRootStore() const {
+  return m_store->asRootStore();
+}
+
+const NestedStore *ObservedStore::asNestedStore() const {
+  return m_store->asNestedStore();
+}
+
+bool ObservedStore::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  return m_store->createIndex(propertyId, indexType);
+}
+
+bool ObservedStore::dropIndex(const PropertyId propertyId) {
+  return m_store->dropIndex(propertyId);
+}
+
+void ObservedStore::commit() {
+  m_store->commit();
+  publish(m_events);
+  m_events.clear();
+}
+
+// The rolled back modifications never became visible, so their events are dropped.
+void ObservedStore::rollback() {
+  m_store->rollback();
+  m_events.clear();
+}
+
+void ObservedStore::shrink() {
+  m_store->shrink();
+}
+
+bool ObservedStore::compact(const size_t maxMovedEntities) {
+  return m_store->compact(maxMovedEntities);
+}
+
+void ObservedStore::addEvent(const ChangeEvent &event) {
+  if (m_subscriptions.empty()) {
+    return;
+  }
+  m_events.push_back(event);
+  publishIfNotDeferred();
+}
+
+void ObservedStore::publishIfNotDeferred() {
+  if (!m_publishesOnCommit) {
+    publish(m_events);
+    m_events.clear();
+  }
+}
+
+// The subscriptions that are not held by any consumer are dropped, as nobody could drain them anymore.
+void ObservedStore::publish(std::span<const ChangeEvent> events) {
+  if (events.empty()) {
+    return;
+  }
+  std::erase_if(m_subscriptions, [](const auto &subscription) { return subscription.use_count() == 1; });
+  for (const auto &subscription: m_subscriptions) {
+    subscription->publish(events);
+  }
+}
+
+} // namespace EntityStore
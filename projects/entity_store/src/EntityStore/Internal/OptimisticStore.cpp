@@ -0,0 +1,603 @@
+#include "EntityStore/Internal/OptimisticStore.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/StoreExceptions.hpp"
+
+namespace EntityStore {
+
+std::vector<EntityId> getSucceededIds(std::span<const Entity> entities, const BatchResult &result) {
+  std::vector<EntityId> ids;
+  for (size_t index{0U}; index < entities.size(); ++index) {
+    if (result.test(index)) {
+      ids.push_back(entities[index].id());
+    }
+  }
+  return ids;
+}
+
+std::vector<EntityId> getSucceededIds(std::span<const EntityId> ids, const BatchResult &result) {
+  std::vector<EntityId> succeededIds;
+  for (size_t index{0U}; index < ids.size(); ++index) {
+    if (result.test(index)) {
+      succeededIds.push_back(ids[index]);
+    }
+  }
+  return succeededIds;
+}
+
+// Collects the ids of the aggregated entities, so they can be recorded as read after the aggregation. The parallel
+// scans fill a separate instance on each thread, so the ids are not inserted into the shared set concurrently.
+struct ReadRecordingAggregator {
+  void add(const EntityId id, const Properties &properties) {
+    aggregator.add(id, properties);
+    readIds.push_back(id);
+  }
+
+  void merge(const ReadRecordingAggregator &other) {
+    aggregator.merge(other.aggregator);
+    readIds.insert(readIds.end(), other.readIds.begin(), other.readIds.end());
+  }
+
+  AnyAggregator aggregator;
+  std::vector<EntityId> readIds;
+};
+
+std::vector<EntityId> getChangedIds(const ChangeSet &changes) {
+  std::vector<EntityId> ids{changes.removed};
+  ids.reserve(changes.removed.size() + changes.updated.size() + changes.inserted.size());
+  for (const auto &entity: changes.updated) {
+    ids.push_back(entity.id());
+  }
+  for (const auto &entity: changes.inserted) {
+    ids.push_back(entity.id());
+  }
+  return ids;
+}
+
+std::unique_ptr<OptimisticTransaction> OptimisticStore::beginTransaction() {
+  return std::make_unique<OptimisticTransaction>(*this);
+}
+
+bool OptimisticStore::insert(const EntityId id, Properties &&properties) {
+  std::unique_lock lock{m_mutex};
+  if (!m_store.insert(id, std::move(properties))) {
+    return false;
+  }
+  markModified(id);
+  return true;
+}
+
+bool OptimisticStore::insert(const EntityId id, const Properties &properties) {
+  std::unique_lock lock{m_mutex};
+  if (!m_store.insert(id, properties)) {
+    return false;
+  }
+  markModified(id);
+  return true;
+}
+
+const Properties *OptimisticStore::update(const EntityId id, Properties &&properties) {
+  std::unique_lock lock{m_mutex};
+  const auto *result = m_store.update(id, std::move(properties));
+  if (result != nullptr) {
+    markModified(id);
+  }
+  return result;
+}
+
+const Properties *OptimisticStore::update(const EntityId id, const Properties &properties) {
+  std::unique_lock lock{m_mutex};
+  const auto *result = m_store.update(id, properties);
+  if (result != nullptr) {
+    markModified(id);
+  }
+  return result;
+}
+
+bool OptimisticStore::contains(const EntityId id) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.contains(id);
+}
+
+const Properties *OptimisticStore::tryGet(const EntityId id) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.tryGet(id);
+}
+
+const Properties &OptimisticStore::get(const EntityId id) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.get(id);
+}
+
+bool OptimisticStore::remove(const EntityId id) {
+  std::unique_lock lock{m_mutex};
+  if (!m_store.remove(id)) {
+    return false;
+  }
+  markModified(id);
+  return true;
+}
+
+// The ids of the entities have to be collected before the batch is processed, because the entities might be moved.
+BatchResult OptimisticStore::insertBatch(std::span<Entity> entities) {
+  std::unique_lock lock{m_mutex};
+  std::vector<EntityId> ids;
+  ids.reserve(entities.size());
+  for (const auto &entity: entities) {
+    ids.push_back(entity.id());
+  }
+  auto result = m_store.insertBatch(entities);
+  markModified(getSucceededIds(ids, result));
+  return result;
+}
+
+BatchResult OptimisticStore::insertBatch(std::span<const Entity> entities) {
+  std::unique_lock lock{m_mutex};
+  auto result = m_store.insertBatch(entities);
+  markModified(getSucceededIds(entities, result));
+  return result;
+}
+
+BatchResult OptimisticStore::updateBatch(std::span<Entity> entities) {
+  std::unique_lock lock{m_mutex};
+  std::vector<EntityId> ids;
+  ids.reserve(entities.size());
+  for (const auto &entity: entities) {
+    ids.push_back(entity.id());
+  }
+  auto result = m_store.updateBatch(entities);
+  markModified(getSucceededIds(ids, result));
+  return result;
+}
+
+BatchResult OptimisticStore::updateBatch(std::span<const Entity> entities) {
+  std::unique_lock lock{m_mutex};
+  auto result = m_store.updateBatch(entities);
+  markModified(getSucceededIds(entities, result));
+  return result;
+}
+
+BatchResult OptimisticStore::removeBatch(std::span<const EntityId> ids) {
+  std::unique_lock lock{m_mutex};
+  auto result = m_store.removeBatch(ids);
+  markModified(getSucceededIds(ids, result));
+  return result;
+}
+
+void OptimisticStore::applyChanges(ChangeSet &&changes) {
+  std::unique_lock lock{m_mutex};
+  markModified(getChangedIds(changes));
+  m_store.applyChanges(std::move(changes));
+}
+
+EntityIdSet OptimisticStore::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.filterIds(predicate, executor);
+}
+
+EntityIdSet OptimisticStore::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                       const QueryExecutor *executor) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> OptimisticStore::estimate(const IndexLookup &lookup,
+                                                       const size_t maxMatchingEntities) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.estimate(lookup, maxMatchingEntities);
+}
+
+// The lock is held for the whole pass, so the concurrent commits cannot modify or remove the aggregated entities.
+AnyAggregator OptimisticStore::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                         const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  std::shared_lock lock{m_mutex};
+  return m_store.aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *OptimisticStore::asRootStore() const {
+  return nullptr;
+}
+
+const NestedStore *OptimisticStore::asNestedStore() const {
+  return nullptr;
+}
+
+bool OptimisticStore::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  std::unique_lock lock{m_mutex};
+  return m_store.createIndex(propertyId, indexType);
+}
+
+bool OptimisticStore::dropIndex(const PropertyId propertyId) {
+  std::unique_lock lock{m_mutex};
+  return m_store.dropIndex(propertyId);
+}
+
+void OptimisticStore::commit() {
+}
+
+void OptimisticStore::rollback() {
+}
+
+void OptimisticStore::shrink() {
+  std::unique_lock lock{m_mutex};
+  m_store.shrink();
+}
+
+bool OptimisticStore::compact(const size_t maxMovedEntities) {
+  std::unique_lock lock{m_mutex};
+  return m_store.compact(maxMovedEntities);
+}
+
+size_t OptimisticStore::numberOfTrackedEntities() const {
+  std::shared_lock lock{m_mutex};
+  return m_entityVersions.size();
+}
+
+void OptimisticStore::markModified(const EntityId id) {
+  ++m_version;
+  if (!m_startVersions.empty()) {
+    m_entityVersions[id] = m_version;
+    m_modifications.emplace_back(m_version, id);
+  }
+}
+
+template <typename TIds>
+void OptimisticStore::markModified(const TIds &ids) {
+  ++m_version;
+  if (m_startVersions.empty()) {
+    return;
+  }
+  for (const auto id: ids) {
+    m_entityVersions[id] = m_version;
+    m_modifications.emplace_back(m_version, id);
+  }
+}
+
+// A modification that is not newer than the start of the oldest running transaction cannot conflict with any of the
+// transactions. The entity might have been modified again since then, in which case its newer version is kept.
+void OptimisticStore::forgetOldVersions() {
+  if (m_startVersions.empty()) {
+    m_entityVersions.clear();
+    m_modifications.clear();
+    return;
+  }
+  const auto oldestStartVersion = *m_startVersions.begin();
+  while (!m_modifications.empty() && m_modifications.front().first <= oldestStartVersion) {
+    const auto [version, id] = m_modifications.front();
+    if (const auto it = m_entityVersions.find(id); it != m_entityVersions.end() && it->second == version) {
+      m_entityVersions.erase(it);
+    }
+    m_modifications.pop_front();
+  }
+}
+
+uint64_t OptimisticStore::startTransaction() {
+  std::unique_lock lock{m_mutex};
+  m_startVersions.insert(m_version);
+  return m_version;
+}
+
+uint64_t OptimisticStore::restartTransaction(const uint64_t startVersion) {
+  std::unique_lock lock{m_mutex};
+  m_startVersions.erase(m_startVersions.find(startVersion));
+  m_startVersions.insert(m_version);
+  forgetOldVersions();
+  return m_version;
+}
+
+void OptimisticStore::finishTransaction(const uint64_t startVersion) {
+  std::unique_lock lock{m_mutex};
+  m_startVersions.erase(m_startVersions.find(startVersion));
+  forgetOldVersions();
+}
+
+TransactionView::TransactionView(OptimisticStore &store)
+  : m_store{store}
+  , m_startVersion{store.startTransaction()} {
+}
+
+TransactionView::~TransactionView() {
+  m_store.finishTransaction(m_startVersion);
+}
+
+bool TransactionView::insert(const EntityId /*id*/, Properties && /*properties*/) {
+  throwNotSupported();
+}
+
+bool TransactionView::insert(const EntityId /*id*/, const Properties & /*properties*/) {
+  throwNotSupported();
+}
+
+const Properties *TransactionView::update(const EntityId /*id*/, Properties && /*properties*/) {
+  throwNotSupported();
+}
+
+const Properties *TransactionView::update(const EntityId /*id*/, const Properties & /*properties*/) {
+  throwNotSupported();
+}
+
+bool TransactionView::contains(const EntityId id) const {
+  if (const auto it = m_readEntities.find(id); it != m_readEntities.end()) {
+    return it->second.has_value();
+  }
+  std::shared_lock lock{m_store.m_mutex};
+  m_readIds.insert(id);
+  return m_store.m_store.contains(id);
+}
+
+const Properties *TransactionView::tryGet(const EntityId id) const {
+  auto it = m_readEntities.find(id);
+  if (it == m_readEntities.end()) {
+    std::shared_lock lock{m_store.m_mutex};
+    const auto *properties = m_store.m_store.tryGet(id);
+    auto copiedProperties = properties == nullptr ? std::nullopt : std::optional<Properties>{*properties};
+    it = m_readEntities.emplace(id, std::move(copiedProperties)).first;
+  }
+  return it->second.has_value() ? &*it->second : nullptr;
+}
+
+const Properties &TransactionView::get(const EntityId id) const {
+  const auto *properties = tryGet(id);
+  if (properties == nullptr) {
+    throw DoesNotHaveEntityException(id);
+  }
+  return *properties;
+}
+
+bool TransactionView::remove(const EntityId /*id*/) {
+  throwNotSupported();
+}
+
+BatchResult TransactionView::insertBatch(std::span<Entity> /*entities*/) {
+  throwNotSupported();
+}
+
+BatchResult TransactionView::insertBatch(std::span<const Entity> /*entities*/) {
+  throwNotSupported();
+}
+
+BatchResult TransactionView::updateBatch(std::span<Entity> /*entities*/) {
+  throwNotSupported();
+}
+
+BatchResult TransactionView::updateBatch(std::span<const Entity> /*entities*/) {
+  throwNotSupported();
+}
+
+BatchResult TransactionView::removeBatch(std::span<const EntityId> /*ids*/) {
+  throwNotSupported();
+}
+
+// The validation and the application of the changes happen under the same exclusive lock, so no other commit can
+// sneak in between them. Therefore the first of the conflicting transactions that commits wins.
+void TransactionView::applyChanges(ChangeSet &&changes) {
+  if (changes.empty()) {
+    return;
+  }
+  std::unique_lock lock{m_store.m_mutex};
+  if (hasConflict(changes)) {
+    throw TransactionConflictException();
+  }
+  m_store.markModified(getChangedIds(changes));
+  m_store.m_store.applyChanges(std::move(changes));
+}
+
+EntityIdSet TransactionView::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  std::shared_lock lock{m_store.m_mutex};
+  auto result = m_store.m_store.filterIds(predicate, executor);
+  m_readIds.insert(result.begin(), result.end());
+  return result;
+}
+
+EntityIdSet TransactionView::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                       const QueryExecutor *executor) const {
+  std::shared_lock lock{m_store.m_mutex};
+  auto result = m_store.m_store.filterIds(predicate, lookup, executor);
+  m_readIds.insert(result.begin(), result.end());
+  return result;
+}
+
+std::optional<IndexEstimate> TransactionView::estimate(const IndexLookup &lookup,
+                                                       const size_t maxMatchingEntities) const {
+  std::shared_lock lock{m_store.m_mutex};
+  return m_store.m_store.estimate(lookup, maxMatchingEntities);
+}
+
+// Same as filterIds, the matching entities are recorded as read, so the transaction conflicts with the commits that
+// modify any of them.
+AnyAggregator TransactionView::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                         const AnyAggregator &emptyAggregator, const QueryExecutor *executor) const {
+  const ReadRecordingAggregator emptyRecordingAggregator{emptyAggregator, {}};
+  std::shared_lock lock{m_store.m_mutex};
+  auto result = lookup != nullptr
+                    ? m_store.m_store.aggregateInlined(predicate, *lookup, emptyRecordingAggregator, executor)
+                    : m_store.m_store.aggregateInlined(predicate, emptyRecordingAggregator, executor);
+  m_readIds.insert(result.readIds.begin(), result.readIds.end());
+  return std::move(result.aggregator);
+}
+
+// The queries have to be recorded, so they cannot access the underlying store directly.
+const RootStore *TransactionView::asRootStore() const {
+  return nullptr;
+}
+
+const NestedStore *TransactionView::asNestedStore() const {
+  return nullptr;
+}
+
+bool TransactionView::createIndex(const PropertyId /*propertyId*/, const IndexType /*indexType*/) {
+  return false;
+}
+
+bool TransactionView::dropIndex(const PropertyId /*propertyId*/) {
+  return false;
+}
+
+void TransactionView::commit() {
+  throwNotSupported();
+}
+
+void TransactionView::rollback() {
+  throwNotSupported();
+}
+
+void TransactionView::shrink() {
+}
+
+bool TransactionView::compact(const size_t /*maxMovedEntities*/) {
+  return true;
+}
+
+void TransactionView::restart() {
+  m_startVersion = m_store.restartTransaction(m_startVersion);
+  m_readEntities.clear();
+  m_readIds.clear();
+}
+
+void TransactionView::throwNotSupported() {
+  throw std::logic_error("The parent of a transaction cannot be modified directly!");
+}
+
+bool TransactionView::hasConflict(const ChangeSet &changes) const {
+  const auto isModifiedSinceStart = [this](const EntityId id) {
+    const auto it = m_store.m_entityVersions.find(id);
+    return it != m_store.m_entityVersions.end() && it->second > m_startVersion;
+  };
+
+  if (std::any_of(m_readEntities.begin(), m_readEntities.end(),
+                  [&isModifiedSinceStart](const auto &readEntity) { return isModifiedSinceStart(readEntity.first); })) {
+    return true;
+  }
+  if (std::any_of(m_readIds.begin(), m_readIds.end(), isModifiedSinceStart)) {
+    return true;
+  }
+  const auto changedIds = getChangedIds(changes);
+  return std::any_of(changedIds.begin(), changedIds.end(), isModifiedSinceStart);
+}
+
+OptimisticTransaction::OptimisticTransaction(OptimisticStore &store)
+  : m_view{store}
+  , m_child{m_view} {
+}
+
+bool OptimisticTransaction::insert(const EntityId id, Properties &&properties) {
+  return m_child.insert(id, std::move(properties));
+}
+
+bool OptimisticTransaction::insert(const EntityId id, const Properties &properties) {
+  return m_child.insert(id, properties);
+}
+
+const Properties *OptimisticTransaction::update(const EntityId id, Properties &&properties) {
+  return m_child.update(id, std::move(properties));
+}
+
+const Properties *OptimisticTransaction::update(const EntityId id, const Properties &properties) {
+  return m_child.update(id, properties);
+}
+
+bool OptimisticTransaction::contains(const EntityId id) const {
+  return m_child.contains(id);
+}
+
+const Properties *OptimisticTransaction::tryGet(const EntityId id) const {
+  return m_child.tryGet(id);
+}
+
+const Properties &OptimisticTransaction::get(const EntityId id) const {
+  return m_child.get(id);
+}
+
+bool OptimisticTransaction::remove(const EntityId id) {
+  return m_child.remove(id);
+}
+
+BatchResult OptimisticTransaction::insertBatch(std::span<Entity> entities) {
+  return m_child.insertBatch(entities);
+}
+
+BatchResult OptimisticTransaction::insertBatch(std::span<const Entity> entities) {
+  return m_child.insertBatch(entities);
+}
+
+BatchResult OptimisticTransaction::updateBatch(std::span<Entity> entities) {
+  return m_child.updateBatch(entities);
+}
+
+BatchResult OptimisticTransaction::updateBatch(std::span<const Entity> entities) {
+  return m_child.updateBatch(entities);
+}
+
+BatchResult OptimisticTransaction::removeBatch(std::span<const EntityId> ids) {
+  return m_child.removeBatch(ids);
+}
+
+void OptimisticTransaction::applyChanges(ChangeSet &&changes) {
+  m_child.applyChanges(std::move(changes));
+}
+
+EntityIdSet OptimisticTransaction::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return m_child.filterIds(predicate, executor);
+}
+
+EntityIdSet OptimisticTransaction::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                             const QueryExecutor *executor) const {
+  return m_child.filterIds(predicate, lookup, executor);
+}
+
+std::optional<IndexEstimate> OptimisticTransaction::estimate(const IndexLookup &lookup,
+                                                             const size_t maxMatchingEntities) const {
+  return m_child.estimate(lookup, maxMatchingEntities);
+}
+
+AnyAggregator OptimisticTransaction::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                               const AnyAggregator &emptyAggregator,
+                                               const QueryExecutor *executor) const {
+  return m_child.aggregate(predicate, lookup, emptyAggregator, executor);
+}
+
+const RootStore *OptimisticTransaction::asRootStore() const {
+  return nullptr;
+}
+
+const NestedStore *OptimisticTransaction::asNestedStore() const {
+  return &m_child;
+}
+
+bool OptimisticTransaction::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  return m_child.createIndex(propertyId, indexType);
+}
+
+bool OptimisticTransaction::dropIndex(const PropertyId propertyId) {
+  return m_child.dropIndex(propertyId);
+}
+
+void OptimisticTransaction::commit() {
+  try {
+    m_child.commit();
+  } catch (...) {
+    m_view.restart();
+    throw;
+  }
+  m_view.restart();
+}
+
+void OptimisticTransaction::rollback() {
+  m_child.rollback();
+  m_view.restart();
+}
+
+void OptimisticTransaction::shrink() {
+  m_child.shrink();
+}
+
+bool OptimisticTransaction::compact(const size_t maxMovedEntities) {
+  return m_child.compact(maxMovedEntities);
+}
+
+} // namespace EntityStore
@@ -0,0 +1,222 @@
+#include "EntityStore/Internal/PropertyIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace EntityStore {
+
+// Calls the function with the matching ids until it returns false.
+template <typename TOrderedIndex, typename TFunc>
+void forEachMatchingId(const TOrderedIndex &orderedIndex, const IndexLookup &lookup, TFunc &&func) {
+  auto it = orderedIndex.lower_bound(std::make_pair(lookup.lowerBound, std::numeric_limits<EntityId>::min()));
+  if (lookup.isEquality()) {
+    for (; it != orderedIndex.end() && it->first == lookup.lowerBound; ++it) {
+      if (!func(it->second)) {
+        return;
+      }
+    }
+    return;
+  }
+
+  // The range is semi-open and the query functions doesn't check its validity, so an empty or inverted range must be
+  // handled here to not iterate "backwards".
+  if (!(lookup.lowerBound < *lookup.upperBound)) {
+    return;
+  }
+  const auto end = orderedIndex.lower_bound(std::make_pair(*lookup.upperBound, std::numeric_limits<EntityId>::min()));
+  for (; it != end; ++it) {
+    if (!func(it->second)) {
+      return;
+    }
+  }
+}
+
+template <typename TFunc>
+void forEachIndexedProperty(const PropertyId propertyId, const Properties &properties, TFunc &&func) {
+  if (properties.hasProperty(propertyId)) {
+    properties.visit(propertyId, [&func](const auto &value) {
+      func(Property{std::in_place_type<std::decay_t<decltype(value)>>, value});
+    });
+  }
+}
+
+IndexLookup IndexLookup::equalTo(const PropertyId propertyId, Property value) {
+  return IndexLookup{propertyId, std::move(value), std::nullopt};
+}
+
+IndexLookup IndexLookup::inRange(const PropertyId propertyId, Property minValue, Property maxValue) {
+  return IndexLookup{propertyId, std::move(minValue), std::move(maxValue)};
+}
+
+bool IndexLookup::isEquality() const {
+  return !upperBound.has_value();
+}
+
+PropertyIndex::PropertyIndex(const IndexType type)
+  : m_index{} {
+  if (type == IndexType::Ordered) {
+    m_index.emplace<OrderedIndex>();
+  }
+}
+
+IndexType PropertyIndex::type() const {
+  return std::holds_alternative<HashIndex>(m_index) ? IndexType::Hash : IndexType::Ordered;
+}
+
+bool PropertyIndex::canServe(const IndexLookup &lookup) const {
+  return lookup.isEquality() || type() == IndexType::Ordered;
+}
+
+size_t PropertyIndex::size() const {
+  return m_size;
+}
+
+void PropertyIndex::insert(const Property &value, const EntityId id) {
+  bool inserted{false};
+  if (auto *hashIndex = std::get_if<HashIndex>(&m_index); hashIndex != nullptr) {
+    inserted = (*hashIndex)[value].insert(id).second;
+  } else {
+    inserted = std::get<OrderedIndex>(m_index).emplace(value, id).second;
+  }
+  if (inserted) {
+    ++m_size;
+  }
+}
+
+void PropertyIndex::remove(const Property &value, const EntityId id) {
+  if (auto *hashIndex = std::get_if<HashIndex>(&m_index); hashIndex != nullptr) {
+    auto it = hashIndex->find(value);
+    if (it == hashIndex->end()) {
+      return;
+    }
+    m_size -= it->second.erase(id);
+    if (it->second.empty()) {
+      hashIndex->erase(it);
+    }
+  } else {
+    m_size -= std::get<OrderedIndex>(m_index).erase(std::make_pair(value, id));
+  }
+}
+
+std::vector<EntityId> PropertyIndex::find(const IndexLookup &lookup) const {
+  std::vector<EntityId> result;
+  if (const auto *hashIndex = std::get_if<HashIndex>(&m_index); hashIndex != nullptr) {
+    if (!lookup.isEquality()) {
+      return result;
+    }
+    auto it = hashIndex->find(lookup.lowerBound);
+    if (it != hashIndex->end()) {
+      result.assign(it->second.begin(), it->second.end());
+    }
+    return result;
+  }
+
+  forEachMatchingId(std::get<OrderedIndex>(m_index), lookup, [&result](const EntityId id) {
+    result.push_back(id);
+    return true;
+  });
+  return result;
+}
+
+IndexEstimate PropertyIndex::estimate(const IndexLookup &lookup, const size_t maxMatchingEntities) const {
+  IndexEstimate result{0U, m_size};
+  if (const auto *hashIndex = std::get_if<HashIndex>(&m_index); hashIndex != nullptr) {
+    auto it = hashIndex->find(lookup.lowerBound);
+    if (it != hashIndex->end()) {
+      result.matchingEntities = it->second.size();
+    }
+    return result;
+  }
+
+  if (maxMatchingEntities == 0U) {
+    return result;
+  }
+  forEachMatchingId(std::get<OrderedIndex>(m_index), lookup, [&result, maxMatchingEntities](const EntityId /*id*/) {
+    return ++result.matchingEntities < maxMatchingEntities;
+  });
+  return result;
+}
+
+bool PropertyIndices::empty() const {
+  return std::none_of(m_indices.begin(), m_indices.end(), [](const auto &index) { return index.has_value(); });
+}
+
+bool PropertyIndices::hasIndex(const PropertyId propertyId) const {
+  return m_indices[asUnderlying(propertyId)].has_value();
+}
+
+const PropertyIndex *PropertyIndices::tryGet(const PropertyId propertyId) const {
+  const auto &index = m_indices[asUnderlying(propertyId)];
+  return index.has_value() ? &*index : nullptr;
+}
+
+bool PropertyIndices::create(const PropertyId propertyId, const IndexType type) {
+  auto &index = m_indices[asUnderlying(propertyId)];
+  if (index.has_value()) {
+    return false;
+  }
+  index.emplace(type);
+  return true;
+}
+
+bool PropertyIndices::drop(const PropertyId propertyId) {
+  auto &index = m_indices[asUnderlying(propertyId)];
+  if (!index.has_value()) {
+    return false;
+  }
+  index.reset();
+  return true;
+}
+
+void PropertyIndices::insert(const EntityId id, const Properties &properties) {
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    insert(static_cast<PropertyId>(propertyIndex), id, properties);
+  }
+}
+
+void PropertyIndices::insert(const PropertyId propertyId, const EntityId id, const Properties &properties) {
+  auto &index = m_indices[asUnderlying(propertyId)];
+  if (index.has_value()) {
+    forEachIndexedProperty(propertyId, properties, [&index, id](const Property &value) { index->insert(value, id); });
+  }
+}
+
+void PropertyIndices::remove(const EntityId id, const Properties &properties) {
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    auto &index = m_indices[propertyIndex];
+    if (index.has_value()) {
+      forEachIndexedProperty(static_cast<PropertyId>(propertyIndex), properties,
+                             [&index, id](const Property &value) { index->remove(value, id); });
+    }
+  }
+}
+
+PropertyMask PropertyIndices::removeUpdated(const EntityId id, const Properties &currentProperties,
+                                                            const Properties &update) {
+  PropertyMask updatedMask;
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    auto &index = m_indices[propertyIndex];
+    const auto propertyId = static_cast<PropertyId>(propertyIndex);
+    if (index.has_value() && update.hasProperty(propertyId)) {
+      updatedMask.set(propertyIndex);
+      forEachIndexedProperty(propertyId, currentProperties,
+                             [&index, id](const Property &value) { index->remove(value, id); });
+    }
+  }
+  return updatedMask;
+}
+
+void PropertyIndices::insertUpdated(const EntityId id, const Properties &updatedProperties,
+                                    const PropertyMask &updatedMask) {
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    if (updatedMask.test(propertyIndex)) {
+      insert(static_cast<PropertyId>(propertyIndex), id, updatedProperties);
+    }
+  }
+}
+
+} // namespace EntityStore
@@ -0,0 +1,180 @@
+#include "EntityStore/Internal/QueryPlan.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace EntityStore {
+
+QueryPredicate::QueryPredicate(Query query)
+  : m_query{std::move(query)} {
+}
+
+bool QueryPredicate::operator()(const EntityId & /*id*/, const Properties &properties) const {
+  return m_query.matches(properties);
+}
+
+const Query &QueryPredicate::query() const {
+  return m_query;
+}
+
+// The selectivity is the estimated ratio of the entities that match the query, while the cost is the estimated relative
+// cost of evaluating the query for a single entity.
+struct QueryEstimate {
+  double selectivity;
+  double cost;
+};
+
+// Without index statistics these rough guesses are used. They are far from accurate, but they are good enough to
+// prefer an equality check over a range check and a range check over checking the presence of a property.
+constexpr QueryEstimate kEqualEstimate{0.1, 2.0};
+constexpr QueryEstimate kRangeEstimate{0.3, 3.0};
+constexpr QueryEstimate kPresentEstimate{0.5, 1.0};
+// Avoids division by zero when the operands are ranked.
+constexpr double kMinRankDivisor{1e-9};
+
+std::optional<IndexLookup> toIndexLookup(const Query &query) {
+  switch (query.kind()) {
+  case Query::Kind::Equal:
+    return IndexLookup::equalTo(query.propertyId(), query.value());
+  case Query::Kind::Range:
+    return IndexLookup::inRange(query.propertyId(), query.value(), *query.maxValue());
+  case Query::Kind::Present:
+  case Query::Kind::And:
+  case Query::Kind::Or:
+  case Query::Kind::Not:
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+class QueryPlanner {
+public:
+  explicit QueryPlanner(const IStore &store)
+    : m_store{store} {
+  }
+
+  QueryPlan plan(const Query &query) {
+    auto plannedQuery = planQuery(query, true).first;
+    auto lookup = chooseLookup(plannedQuery);
+    return QueryPlan{QueryPredicate{std::move(plannedQuery)}, std::move(lookup)};
+  }
+
+private:
+  struct PlannedOperand {
+    Query query;
+    QueryEstimate estimate;
+    double rank;
+  };
+
+  // The candidate lookups are the conditions that chooseLookup can choose from, see there.
+  std::pair<Query, QueryEstimate> planQuery(const Query &query, const bool isCandidateLookup) {
+    switch (query.kind()) {
+    case Query::Kind::Equal:
+    case Query::Kind::Range:
+    case Query::Kind::Present:
+      return {query, estimateCondition(query, isCandidateLookup)};
+    case Query::Kind::Not: {
+      auto [operand, estimate] = planQuery(query.operands().front(), false);
+      return {!std::move(operand), QueryEstimate{1.0 - estimate.selectivity, estimate.cost}};
+    }
+    case Query::Kind::And:
+    case Query::Kind::Or:
+      return planOperands(query, isCandidateLookup);
+    }
+    return {query, kPresentEstimate};
+  }
+
+  std::pair<Query, QueryEstimate> planOperands(const Query &query, const bool isCandidateLookup) {
+    const auto isAnd = query.kind() == Query::Kind::And;
+    std::vector<PlannedOperand> plannedOperands;
+    plannedOperands.reserve(query.operands().size());
+    for (const auto &operand: query.operands()) {
+      auto [plannedQuery, estimate] = planQuery(operand, isAnd && isCandidateLookup);
+      // The evaluation of an AND stops at the first false operand, so the operands with the smallest cost per chance of
+      // being false should be evaluated first. The same goes for an OR with the chance of being true.
+      const auto chanceOfStopping = isAnd ? 1.0 - estimate.selectivity : estimate.selectivity;
+      const auto rank = estimate.cost / std::max(chanceOfStopping, kMinRankDivisor);
+      plannedOperands.push_back(PlannedOperand{std::move(plannedQuery), estimate, rank});
+    }
+    std::stable_sort(plannedOperands.begin(), plannedOperands.end(),
+                     [](const PlannedOperand &lhs, const PlannedOperand &rhs) { return lhs.rank < rhs.rank; });
+
+    // An operand is evaluated only if the previous ones didn't stop the evaluation.
+    QueryEstimate estimate{1.0, 0.0};
+    double chanceOfEvaluation{1.0};
+    std::vector<Query> operands;
+    operands.reserve(plannedOperands.size());
+    for (auto &plannedOperand: plannedOperands) {
+      const auto selectivity = plannedOperand.estimate.selectivity;
+      estimate.cost += chanceOfEvaluation * plannedOperand.estimate.cost;
+      chanceOfEvaluation *= isAnd ? selectivity : 1.0 - selectivity;
+      estimate.selectivity *= isAnd ? selectivity : 1.0 - selectivity;
+      operands.push_back(std::move(plannedOperand.query));
+    }
+    if (!isAnd) {
+      estimate.selectivity = 1.0 - estimate.selectivity;
+    }
+    return {isAnd ? Query::allOf(std::move(operands)) : Query::anyOf(std::move(operands)), estimate};
+  }
+
+  // Counting the matches of an ordered index is linear, but only the most selective indexed condition can be used as
+  // a lookup, so there is no point to count more matches of a candidate than the ones of the best lookup so far. A
+  // capped count is not less than the best one, so it never wins against the lookup it was capped by. The conditions
+  // that cannot be used as a lookup (e.g. the operands of an OR) are counted without the cap, otherwise their
+  // selectivity would be underestimated.
+  QueryEstimate estimateCondition(const Query &query, const bool isCandidateLookup) {
+    auto lookup = toIndexLookup(query);
+    if (!lookup.has_value()) {
+      return kPresentEstimate;
+    }
+    const auto defaultEstimate = query.kind() == Query::Kind::Equal ? kEqualEstimate : kRangeEstimate;
+    const auto maxMatchingEntities =
+        isCandidateLookup ? m_fewestIndexedMatches : std::numeric_limits<size_t>::max();
+    const auto indexEstimate = m_store.estimate(*lookup, maxMatchingEntities);
+    if (!indexEstimate.has_value()) {
+      return defaultEstimate;
+    }
+    if (isCandidateLookup && indexEstimate->matchingEntities < m_fewestIndexedMatches) {
+      m_fewestIndexedMatches = indexEstimate->matchingEntities;
+      m_bestIndexedLookup = std::move(lookup);
+    }
+    if (indexEstimate->indexedEntities == 0U) {
+      return QueryEstimate{0.0, defaultEstimate.cost};
+    }
+    return QueryEstimate{static_cast<double>(indexEstimate->matchingEntities) /
+                             static_cast<double>(indexEstimate->indexedEntities),
+                         defaultEstimate.cost};
+  }
+
+  // Only the query itself or the operands of a top level AND can be used as a lookup, because only they have to be
+  // true for every matching entity. The indexed candidate with the fewest matches is already found by
+  // estimateCondition, so the indices are not asked again. Without an indexed candidate the first condition of the
+  // planned query is chosen, because some stores can make use of a lookup without an index too.
+  std::optional<IndexLookup> chooseLookup(const Query &plannedQuery) {
+    if (m_bestIndexedLookup.has_value()) {
+      return std::move(m_bestIndexedLookup);
+    }
+    if (plannedQuery.kind() != Query::Kind::And) {
+      return toIndexLookup(plannedQuery);
+    }
+    for (const auto &operand: plannedQuery.operands()) {
+      if (auto lookup = toIndexLookup(operand); lookup.has_value()) {
+        return lookup;
+      }
+    }
+    return std::nullopt;
+  }
+
+  const IStore &m_store;
+  size_t m_fewestIndexedMatches{std::numeric_limits<size_t>::max()};
+  std::optional<IndexLookup> m_bestIndexedLookup;
+};
+
+QueryPlan planQuery(const Query &query, const IStore &store) {
+  return QueryPlanner{store}.plan(query);
+}
+
+} // namespace EntityStore
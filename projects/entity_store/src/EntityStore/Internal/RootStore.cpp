@@ -1,80 +1,135 @@
 ﻿#include "EntityStore/Internal/RootStore.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
 
 #include "EntityStore/StoreExceptions.hpp"
+#include "utils/Assert.hpp"
 
 namespace EntityStore {
 
-template <SameAsProperties TProperties>
-const Properties *doUpdate(std::vector<std::optional<Entity>> &entities,
-                           std::unordered_map<EntityId, size_t> &entityIndexById, const EntityId id,
-                           TProperties &&properties) {
+template <typename TIdToIndexMap, SameAsProperties TProperties>
+const Properties *doUpdate(std::vector<std::optional<Entity>> &entities, TIdToIndexMap &entityIndexById,
+                           PropertyIndices &propertyIndices, const EntityId id, TProperties &&properties) {
   auto it = entityIndexById.find(id);
   if (it == entityIndexById.end()) {
     return nullptr;
   }
   auto &entityHolder = entities[it->second];
+  const auto updatedMask = propertyIndices.removeUpdated(id, entityHolder->properties(), properties);
   entityHolder->update(std::forward<TProperties>(properties));
+  propertyIndices.insertUpdated(id, entityHolder->properties(), updatedMask);
   return &entityHolder->properties();
 }
 
-void doInsert(std::vector<std::optional<Entity>> &entities, std::unordered_map<EntityId, size_t> &entityIndexById,
-              std::set<size_t> &emptyIndices, Entity &&entity) {
-  auto insertEntity = [&](Entity &&entity) {
-    size_t usedIndex = entities.size();
-    entityIndexById.emplace(entity.id(), usedIndex);
+// Returns the index of the slot the entity is stored in.
+size_t storeEntity(std::vector<std::optional<Entity>> &entities, EmptySlots &emptySlots, Entity &&entity) {
+  if (emptySlots.empty()) {
     entities.push_back(std::move(entity));
-  };
+    return entities.size() - 1U;
+  }
+  const auto usedIndex = emptySlots.extractFirst();
+  entities[usedIndex] = std::move(entity);
+  return usedIndex;
+}
 
-  auto assignEntityToEmptyIndex = [&](Entity &&entity) {
-    auto firstEmptyIndex = emptyIndices.begin();
-    size_t usedIndex = *firstEmptyIndex;
-    emptyIndices.erase(firstEmptyIndex);
-    entityIndexById.emplace(entity.id(), usedIndex);
+// The id is emplaced into the map before the entity is stored, so inserting an entity costs a single lookup in the map.
+template <typename TIdToIndexMap, SameAsProperties TProperties>
+bool doInsert(std::vector<std::optional<Entity>> &entities, TIdToIndexMap &entityIndexById, EmptySlots &emptySlots,
+              PropertyIndices &propertyIndices, const EntityId id, TProperties &&properties) {
+  const auto [it, isInserted] = entityIndexById.try_emplace(id, 0U);
+  if (!isInserted) {
+    return false;
+  }
+  try {
+    it->second = storeEntity(entities, emptySlots, Entity{id, std::forward<TProperties>(properties)});
+  } catch (...) {
+    entityIndexById.erase(it);
+    throw;
+  }
+  propertyIndices.insert(id, entities[it->second]->properties());
+  return true;
+}
 
-    entities[usedIndex] = std::move(entity);
-  };
+// Reserving the memory for the whole batch makes sure there is at most one reallocation of the vector and no rehashing
+// of the map, which otherwise dominate the cost of inserting a large number of entities. The memory is reserved
+// geometrically, so many small batches (or commits) are still amortized constant time per entity.
+template <typename TIdToIndexMap>
+void reserveForInsert(std::vector<std::optional<Entity>> &entities, TIdToIndexMap &entityIndexById,
+                      const EmptySlots &emptySlots, const size_t numberOfEntitiesToInsert) {
+  if (numberOfEntitiesToInsert > emptySlots.size()) {
+    reserveGeometrically(entities, entities.size() + numberOfEntitiesToInsert - emptySlots.size());
+  }
+  reserveMapGeometrically(entityIndexById, entityIndexById.size() + numberOfEntitiesToInsert);
+}
 
-  if (emptyIndices.empty()) {
-    insertEntity(std::move(entity));
-  } else {
-    assignEntityToEmptyIndex(std::move(entity));
+template <typename TIdIndex>
+BasicRootStore<TIdIndex> BasicRootStore<TIdIndex>::fromUniqueEntities(EntityVector &&entities,
+                                                                     std::shared_ptr<const std::string> internedStrings) {
+  BasicRootStore store;
+  store.m_entities = std::move(entities);
+  store.m_entityIndexById.reserve(store.m_entities.size());
+  for (size_t index{0U}; index < store.m_entities.size(); ++index) {
+    store.m_entityIndexById.emplace(store.m_entities[index]->id(), index);
   }
+  MY_ASSERT(store.m_entityIndexById.size() == store.m_entities.size(), "The ids of the entities must be unique");
+  store.keepAlive(std::move(internedStrings));
+  return store;
 }
 
-template <SameAsProperties TProperties>
-bool doInsert(std::vector<std::optional<Entity>> &entities, std::unordered_map<EntityId, size_t> &entityIndexById,
-              std::set<size_t> &emptyIndices, const EntityId id, TProperties &&properties) {
-  auto it = entityIndexById.find(id);
-  if (it != entityIndexById.end()) {
-    return false;
-  };
-  doInsert(entities, entityIndexById, emptyIndices, Entity{id, std::forward<TProperties>(properties)});
-  return true;
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::keepAlive(std::shared_ptr<const std::string> strings) {
+  m_ownedStrings.push_back(std::move(strings));
+}
+
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::insert(const EntityId id, Properties &&properties) {
+  return doInsert(m_entities, m_entityIndexById, m_emptySlots, m_propertyIndices, id, std::move(properties));
+}
+
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::insert(const EntityId id, const Properties &properties) {
+  return doInsert(m_entities, m_entityIndexById, m_emptySlots, m_propertyIndices, id, properties);
 }
 
-bool RootStore::insert(const EntityId id, Properties &&properties) {
-  return doInsert(m_entities, m_entityIndexById, m_emptyIndices, id, std::move(properties));
+template <typename TIdIndex>
+const Properties *BasicRootStore<TIdIndex>::update(const EntityId id, Properties &&properties) {
+  return doUpdate(m_entities, m_entityIndexById, m_propertyIndices, id, std::move(properties));
 }
 
-bool RootStore::insert(const EntityId id, const Properties &properties) {
-  return doInsert(m_entities, m_entityIndexById, m_emptyIndices, id, properties);
+template <typename TIdIndex>
+const Properties *BasicRootStore<TIdIndex>::update(const EntityId id, const Properties &properties) {
+  return doUpdate(m_entities, m_entityIndexById, m_propertyIndices, id, properties);
 }
 
-const Properties *RootStore::update(const EntityId id, Properties &&properties) {
-  return doUpdate(m_entities, m_entityIndexById, id, std::move(properties));
+// The batch functions call the free functions directly instead of the virtual member functions, so there is only one
+// virtual dispatch per batch.
+template <typename TIdToIndexMap, typename TEntity>
+BatchResult doInsertBatch(std::vector<std::optional<Entity>> &entities, TIdToIndexMap &entityIndexById,
+                          EmptySlots &emptySlots, PropertyIndices &propertyIndices,
+                          std::span<TEntity> entitiesToInsert) {
+  reserveForInsert(entities, entityIndexById, emptySlots, entitiesToInsert.size());
+  return processBatch(entitiesToInsert, [&](TEntity &entity) {
+    return doInsert(entities, entityIndexById, emptySlots, propertyIndices, entity.id(), forwardProperties(entity));
+  });
 }
 
-const Properties *RootStore::update(const EntityId id, const Properties &properties) {
-  return doUpdate(m_entities, m_entityIndexById, id, properties);
+template <typename TIdToIndexMap, typename TEntity>
+BatchResult doUpdateBatch(std::vector<std::optional<Entity>> &entities, TIdToIndexMap &entityIndexById,
+                          PropertyIndices &propertyIndices, std::span<TEntity> entitiesToUpdate) {
+  return processBatch(entitiesToUpdate, [&](TEntity &entity) {
+    return doUpdate(entities, entityIndexById, propertyIndices, entity.id(), forwardProperties(entity)) != nullptr;
+  });
 }
 
-bool RootStore::contains(const EntityId id) const {
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::contains(const EntityId id) const {
   return m_entityIndexById.find(id) != m_entityIndexById.end();
 }
 
-const Properties *RootStore::tryGet(const EntityId id) const {
+template <typename TIdIndex>
+const Properties *BasicRootStore<TIdIndex>::tryGet(const EntityId id) const {
   auto it = m_entityIndexById.find(id);
   if (it == m_entityIndexById.end()) {
     return nullptr;
@@ -82,7 +137,8 @@ const Properties *RootStore::tryGet(const EntityId id) const {
   return &m_entities[it->second]->properties();
 }
 
-const Properties &RootStore::get(const EntityId id) const {
+template <typename TIdIndex>
+const Properties &BasicRootStore<TIdIndex>::get(const EntityId id) const {
   const auto *propertiesPtr = tryGet(id);
   if (propertiesPtr == nullptr) {
     throw DoesNotHaveEntityException(id);
@@ -90,7 +146,8 @@ const Properties &RootStore::get(const EntityId id) const {
   return *propertiesPtr;
 }
 
-bool RootStore::remove(const EntityId id) {
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::remove(const EntityId id) {
   auto it = m_entityIndexById.find(id);
   if (it == m_entityIndexById.end()) {
     return false;
@@ -98,34 +155,139 @@ bool RootStore::remove(const EntityId id) {
 
   auto index = it->second;
   m_entityIndexById.erase(it);
+  m_propertyIndices.remove(id, m_entities[index]->properties());
   m_entities[index] = std::nullopt;
-  m_emptyIndices.insert(index);
+  m_emptySlots.insert(index);
 
   return true;
 }
 
-std::unordered_set<EntityId> RootStore::filterIds(const EntityPredicate &predicate) const {
-  std::unordered_set<EntityId> result;
+template <typename TIdIndex>
+BatchResult BasicRootStore<TIdIndex>::insertBatch(std::span<Entity> entities) {
+  return doInsertBatch(m_entities, m_entityIndexById, m_emptySlots, m_propertyIndices, entities);
+}
 
-  for (const auto &entityHolder: m_entities) {
-    if (!entityHolder.has_value()) {
-      continue;
+template <typename TIdIndex>
+BatchResult BasicRootStore<TIdIndex>::insertBatch(std::span<const Entity> entities) {
+  return doInsertBatch(m_entities, m_entityIndexById, m_emptySlots, m_propertyIndices, entities);
+}
+
+template <typename TIdIndex>
+BatchResult BasicRootStore<TIdIndex>::updateBatch(std::span<Entity> entities) {
+  return doUpdateBatch(m_entities, m_entityIndexById, m_propertyIndices, entities);
+}
+
+template <typename TIdIndex>
+BatchResult BasicRootStore<TIdIndex>::updateBatch(std::span<const Entity> entities) {
+  return doUpdateBatch(m_entities, m_entityIndexById, m_propertyIndices, entities);
+}
+
+template <typename TIdIndex>
+BatchResult BasicRootStore<TIdIndex>::removeBatch(std::span<const EntityId> ids) {
+  return processBatch(ids, [this](const EntityId id) { return BasicRootStore::remove(id); });
+}
+
+// The changes are applied in a single pass without the batch functions: the removals free the slots first, so the
+// insertions can reuse them, the memory is reserved only once, and the entities are moved into their slots with a
+// single lookup in the id map per entity. As the memory is reserved geometrically, a lot of small commits don't
+// reallocate the whole store either, see the StoreSmallCommits benchmark.
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::applyChanges(ChangeSet &&changes) {
+  for (const auto id: changes.removed) {
+    if (!BasicRootStore::remove(id)) {
+      throw std::logic_error("Cannot remove Entity while committing changes to parent!");
+    }
+  }
+  for (auto &entity: changes.updated) {
+    if (doUpdate(m_entities, m_entityIndexById, m_propertyIndices, entity.id(), std::move(entity).properties()) ==
+        nullptr) {
+      throw std::logic_error("Cannot update Entity while committing changes to parent!");
     }
-    const auto &entity = *entityHolder;
-    if (predicate(entity.id(), entity.properties())) {
-      result.insert(entity.id());
+  }
+  reserveForInsert(m_entities, m_entityIndexById, m_emptySlots, changes.inserted.size());
+  for (auto &entity: changes.inserted) {
+    if (!doInsert(m_entities, m_entityIndexById, m_emptySlots, m_propertyIndices, entity.id(),
+                  std::move(entity).properties())) {
+      throw std::logic_error("Cannot insert Entity while committing changes to parent!");
     }
   }
-  return result;
 }
 
-void RootStore::commit() {
+template <typename TIdIndex>
+EntityIdSet BasicRootStore<TIdIndex>::filterIds(const EntityPredicate &predicate, const QueryExecutor *executor) const {
+  return filterIdsInlined(predicate, executor);
+}
+
+template <typename TIdIndex>
+EntityIdSet BasicRootStore<TIdIndex>::filterIds(const EntityPredicate &predicate, const IndexLookup &lookup,
+                                                const QueryExecutor *executor) const {
+  return filterIdsInlined(predicate, lookup, executor);
 }
 
-void RootStore::rollback() {
+template <typename TIdIndex>
+std::optional<IndexEstimate> BasicRootStore<TIdIndex>::estimate(const IndexLookup &lookup,
+                                                                const size_t maxMatchingEntities) const {
+  const auto *propertyIndex = m_propertyIndices.tryGet(lookup.propertyId);
+  if (propertyIndex == nullptr || !propertyIndex->canServe(lookup)) {
+    return std::nullopt;
+  }
+  return propertyIndex->estimate(lookup, maxMatchingEntities);
 }
 
-void RootStore::shrink() {
+template <typename TIdIndex>
+AnyAggregator BasicRootStore<TIdIndex>::aggregate(const EntityPredicate &predicate, const IndexLookup *lookup,
+                                                  const AnyAggregator &emptyAggregator,
+                                                  const QueryExecutor *executor) const {
+  if (lookup != nullptr) {
+    return aggregateInlined(predicate, *lookup, emptyAggregator, executor);
+  }
+  return aggregateInlined(predicate, emptyAggregator, executor);
+}
+
+// Only the default store can be used by the inlined filter functions, the other ones are queried through the virtual
+// functions.
+template <typename TIdIndex>
+const RootStore *BasicRootStore<TIdIndex>::asRootStore() const {
+  if constexpr (std::is_same_v<TIdIndex, FlatIdIndex>) {
+    return this;
+  } else {
+    return nullptr;
+  }
+}
+
+template <typename TIdIndex>
+const NestedStore *BasicRootStore<TIdIndex>::asNestedStore() const {
+  return nullptr;
+}
+
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  if (!m_propertyIndices.create(propertyId, indexType)) {
+    return false;
+  }
+  for (const auto &entityHolder: m_entities) {
+    if (entityHolder.has_value()) {
+      m_propertyIndices.insert(propertyId, entityHolder->id(), entityHolder->properties());
+    }
+  }
+  return true;
+}
+
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::dropIndex(const PropertyId propertyId) {
+  return m_propertyIndices.drop(propertyId);
+}
+
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::commit() {
+}
+
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::rollback() {
+}
+
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::shrink() {
   if (m_entities.size() == m_entityIndexById.size()) {
     return;
   }
@@ -133,6 +295,7 @@ void RootStore::shrink() {
   if (m_entityIndexById.empty()) {
     m_entities.clear();
     m_entities.shrink_to_fit();
+    m_emptySlots.clear();
     return;
   }
 
@@ -187,22 +350,55 @@ void RootStore::shrink() {
     shrinkWithCopy();
   }
   assert(m_entities.size() == m_entityIndexById.size());
-  m_emptyIndices.clear();
+  m_emptySlots.clear();
 }
-RootStore::Iterator RootStore::begin() {
+
+// The last entity is moved into the first empty slot, so every moved entity makes the vector shorter by at least one.
+// The capacity of the vector is not released, that would need to move every entity at once, see shrink.
+template <typename TIdIndex>
+bool BasicRootStore<TIdIndex>::compact(const size_t maxMovedEntities) {
+  removeTrailingEmptySlots();
+  for (size_t numberOfMovedEntities{0U}; numberOfMovedEntities < maxMovedEntities && !m_emptySlots.empty();
+       ++numberOfMovedEntities) {
+    const auto newIndex = m_emptySlots.extractFirst();
+    auto &entityHolder = m_entities.back();
+    m_entityIndexById.at(entityHolder->id()) = newIndex;
+    m_entities[newIndex] = std::move(entityHolder);
+    m_entities.pop_back();
+    removeTrailingEmptySlots();
+  }
+  return m_emptySlots.empty();
+}
+
+template <typename TIdIndex>
+void BasicRootStore<TIdIndex>::removeTrailingEmptySlots() {
+  while (!m_entities.empty() && !m_entities.back().has_value()) {
+    m_emptySlots.erase(m_entities.size() - 1U);
+    m_entities.pop_back();
+  }
+}
+
+template <typename TIdIndex>
+typename BasicRootStore<TIdIndex>::Iterator BasicRootStore<TIdIndex>::begin() {
   return m_entities.begin();
 }
 
-RootStore::Iterator RootStore::end() {
+template <typename TIdIndex>
+typename BasicRootStore<TIdIndex>::Iterator BasicRootStore<TIdIndex>::end() {
   return m_entities.end();
 }
 
-RootStore::ConstIterator RootStore::begin() const {
+template <typename TIdIndex>
+typename BasicRootStore<TIdIndex>::ConstIterator BasicRootStore<TIdIndex>::begin() const {
   return m_entities.begin();
 }
 
-RootStore::ConstIterator RootStore::end() const {
+template <typename TIdIndex>
+typename BasicRootStore<TIdIndex>::ConstIterator BasicRootStore<TIdIndex>::end() const {
   return m_entities.end();
 }
 
+template class BasicRootStore<FlatIdIndex>;
+template class BasicRootStore<NodeIdIndex>;
+
 } // namespace EntityStore
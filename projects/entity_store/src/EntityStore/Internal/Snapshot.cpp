@@ -0,0 +1,200 @@
+#include "EntityStore/Internal/Snapshot.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/Internal/BinaryFormat.hpp"
+#include "EntityStore/Internal/EntityPredicate.hpp"
+#include "EntityStore/Internal/FileIO.hpp"
+#include "EntityStore/StoreExceptions.hpp"
+
+namespace EntityStore {
+
+constexpr std::array<char, 8> kSnapshotMagic{'E', 'S', 'S', 'N', 'A', 'P', 'S', 'H'};
+constexpr uint32_t kSnapshotVersion{2U};
+constexpr uint32_t kNullStringIndex{std::numeric_limits<uint32_t>::max()};
+// The encoded entities are written into the file in batches of this size, so the whole snapshot doesn't have to be in
+// the memory at the same time.
+constexpr size_t kWriteBatchSize{1U << 20U};
+// An entity takes at least this many bytes (id and property mask), which is used to validate the number of entities
+// before reserving memory for them.
+constexpr size_t kMinEncodedEntitySize{sizeof(EntityId) + sizeof(uint32_t)};
+
+class StringInterner {
+public:
+  uint32_t intern(const char *value) {
+    if (value == nullptr) {
+      return kNullStringIndex;
+    }
+    const auto [it, inserted] = m_indices.emplace(std::string_view{value}, static_cast<uint32_t>(m_strings.size()));
+    if (inserted) {
+      if (m_strings.size() == kNullStringIndex) {
+        throw InvalidPersistedDataException("too many distinct C strings to be persisted");
+      }
+      m_strings.push_back(it->first);
+    }
+    return it->second;
+  }
+
+  [[nodiscard]] const std::vector<std::string_view> &strings() const {
+    return m_strings;
+  }
+
+  [[nodiscard]] uint32_t indexOf(const char *value) const {
+    return value == nullptr ? kNullStringIndex : m_indices.at(std::string_view{value});
+  }
+
+private:
+  std::unordered_map<std::string_view, uint32_t> m_indices;
+  std::vector<std::string_view> m_strings;
+};
+
+void saveSnapshot(const IStore &store, const std::filesystem::path &path, const uint64_t logSequenceNumber) {
+  const auto ids = store.filterIds(AllEntitiesPredicate{}, nullptr);
+
+  // The strings have to be interned before the entities are written, because the interned strings precede them.
+  StringInterner interner;
+  for (const auto id: ids) {
+    forEachPresentProperty(store.get(id), [&interner](const PropertyId /*propertyId*/, const auto &value) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(value)>, const char *>) {
+        static_cast<void>(interner.intern(value));
+      }
+    });
+  }
+
+  writeFileAtomically(path, [&](OutputFile &file) {
+    BinaryWriter writer;
+    writer.write(kSnapshotMagic);
+    writer.write(kSnapshotVersion);
+    writer.write(logSequenceNumber);
+    writer.write(static_cast<uint64_t>(interner.strings().size()));
+    writer.write(static_cast<uint64_t>(ids.size()));
+    for (const auto &internedString: interner.strings()) {
+      writer.writeString(internedString);
+    }
+
+    for (const auto id: ids) {
+      const auto &properties = store.get(id);
+      writer.write(id);
+      writer.write(serializePropertyMask(properties.mask()));
+      forEachPresentProperty(properties, [&writer, &interner](const PropertyId /*propertyId*/, const auto &value) {
+        using TProperty = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<TProperty, std::string>) {
+          writer.writeString(value);
+        } else if constexpr (std::is_same_v<TProperty, const char *>) {
+          writer.write(interner.indexOf(value));
+        } else {
+          writer.write(value);
+        }
+      });
+      if (writer.size() >= kWriteBatchSize) {
+        file.write(writer.bytes());
+        writer.clear();
+      }
+    }
+    file.write(writer.bytes());
+  });
+}
+
+// The interned strings are copied into a single buffer separated by null characters, so the const char * properties
+// can point into it and only one allocation is necessary for all of them.
+std::pair<std::shared_ptr<const std::string>, std::vector<const char *>>
+readInternedStrings(BinaryReader &reader, const uint64_t numberOfStrings) {
+  std::vector<std::string_view> strings;
+  size_t bufferSize{0U};
+  for (uint64_t index{0U}; index < numberOfStrings; ++index) {
+    strings.push_back(reader.readString());
+    bufferSize += strings.back().size() + 1U;
+  }
+
+  auto buffer = std::make_shared<std::string>();
+  buffer->reserve(bufferSize);
+  std::vector<size_t> offsets;
+  offsets.reserve(strings.size());
+  for (const auto &value: strings) {
+    offsets.push_back(buffer->size());
+    buffer->append(value);
+    buffer->push_back('\0');
+  }
+
+  std::vector<const char *> pointers;
+  pointers.reserve(offsets.size());
+  for (const auto offset: offsets) {
+    pointers.push_back(buffer->data() + offset);
+  }
+  return {std::move(buffer), std::move(pointers)};
+}
+
+Properties readProperties(BinaryReader &reader, const std::vector<const char *> &internedStrings) {
+  const auto mask = deserializePropertyMask(reader.read<SerializedPropertyMask>());
+
+  Properties properties;
+  for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+       ++propertyIndex) {
+    const auto propertyId = static_cast<PropertyId>(propertyIndex);
+    if (!mask.test(propertyIndex)) {
+      continue;
+    }
+    switch (getPropertyType(propertyId)) {
+    case PropertyType::String:
+      properties.setAs(propertyId, std::string{reader.readString()});
+      break;
+    case PropertyType::Double:
+      properties.setAs(propertyId, reader.readDoubleProperty());
+      break;
+    case PropertyType::ConstCharPtr: {
+      const auto stringIndex = reader.read<uint32_t>();
+      if (stringIndex != kNullStringIndex && stringIndex >= internedStrings.size()) {
+        throw InvalidPersistedDataException("invalid interned string index in snapshot");
+      }
+      properties.setAs(propertyId, stringIndex == kNullStringIndex ? nullptr : internedStrings[stringIndex]);
+      break;
+    }
+    }
+  }
+  return properties;
+}
+
+LoadedSnapshot loadSnapshot(const std::filesystem::path &path) {
+  const MappedFile file{path};
+  BinaryReader reader{file.bytes()};
+  if (reader.read<std::array<char, 8>>() != kSnapshotMagic) {
+    throw InvalidPersistedDataException("not a snapshot file");
+  }
+  if (reader.read<uint32_t>() != kSnapshotVersion) {
+    throw InvalidPersistedDataException("unsupported snapshot version");
+  }
+  const auto logSequenceNumber = reader.read<uint64_t>();
+
+  const auto numberOfStrings = reader.read<uint64_t>();
+  const auto numberOfEntities = reader.read<uint64_t>();
+  auto [internedStringsBuffer, internedStrings] = readInternedStrings(reader, numberOfStrings);
+  if (numberOfEntities > (file.bytes().size() - reader.position()) / kMinEncodedEntitySize) {
+    throw InvalidPersistedDataException("the number of entities doesn't match the size of the snapshot");
+  }
+
+  RootStore::EntityVector entities;
+  entities.reserve(numberOfEntities);
+  for (uint64_t index{0U}; index < numberOfEntities; ++index) {
+    const auto id = reader.read<EntityId>();
+    // The ids are saved in ascending order, which makes it cheap to check their uniqueness.
+    if (!entities.empty() && entities.back()->id() >= id) {
+      throw InvalidPersistedDataException("the ids in the snapshot are not in ascending order");
+    }
+    entities.emplace_back(std::in_place, id, readProperties(reader, internedStrings));
+  }
+  if (!reader.atEnd()) {
+    throw InvalidPersistedDataException("unexpected data at the end of the snapshot");
+  }
+  return LoadedSnapshot{RootStore::fromUniqueEntities(std::move(entities), std::move(internedStringsBuffer)),
+                        logSequenceNumber};
+}
+
+} // namespace EntityStore
@@ -0,0 +1,59 @@
+#include "EntityStore/Internal/StringDictionary.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+namespace EntityStore {
+
+StringDictionary::StringDictionary(const StringDictionary &other)
+  : m_strings{other.m_strings}
+  , m_codeByString{} {
+  m_codeByString.reserve(m_strings.size());
+  for (size_t index{0U}; index < m_strings.size(); ++index) {
+    m_codeByString.emplace(m_strings[index], static_cast<Code>(index));
+  }
+}
+
+StringDictionary &StringDictionary::operator=(const StringDictionary &other) {
+  if (&other != this) {
+    *this = StringDictionary(other);
+  }
+  return *this;
+}
+
+StringDictionary::Code StringDictionary::encode(const std::string &value) {
+  const auto it = m_codeByString.find(value);
+  if (it != m_codeByString.end()) {
+    return it->second;
+  }
+  if (m_strings.size() > std::numeric_limits<Code>::max()) {
+    throw std::length_error("The string dictionary is full!");
+  }
+  const auto code = static_cast<Code>(m_strings.size());
+  const auto &storedValue = m_strings.emplace_back(value);
+  try {
+    m_codeByString.emplace(storedValue, code);
+  } catch (...) {
+    m_strings.pop_back();
+    throw;
+  }
+  return code;
+}
+
+std::optional<StringDictionary::Code> StringDictionary::tryFind(const std::string_view value) const {
+  const auto it = m_codeByString.find(value);
+  if (it == m_codeByString.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+const std::string &StringDictionary::decode(const Code code) const {
+  return m_strings[code];
+}
+
+size_t StringDictionary::size() const {
+  return m_strings.size();
+}
+
+} // namespace EntityStore
@@ -0,0 +1,299 @@
+#include "EntityStore/Internal/WriteAheadLog.hpp"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/StoreExceptions.hpp"
+
+namespace EntityStore {
+
+constexpr size_t kPayloadSizeOffset{0U};
+constexpr size_t kChecksumOffset{kPayloadSizeOffset + sizeof(uint32_t)};
+constexpr size_t kChecksumBegin{kChecksumOffset + sizeof(uint32_t)};
+constexpr size_t kRecordHeaderSize{kChecksumBegin + sizeof(uint64_t) + sizeof(LogRecordType)};
+
+// FNV-1a is not the strongest checksum, but it is simple and good enough to detect the torn records.
+uint32_t calculateChecksum(std::span<const std::byte> bytes) {
+  constexpr uint32_t kOffsetBasis{2166136261U};
+  constexpr uint32_t kPrime{16777619U};
+  auto checksum = kOffsetBasis;
+  for (const auto byte: bytes) {
+    checksum ^= static_cast<uint32_t>(byte);
+    checksum *= kPrime;
+  }
+  return checksum;
+}
+
+WriteAheadLog::WriteAheadLog(std::filesystem::path path, const WriteAheadLogOptions &options,
+                             const uint64_t lastLogSequenceNumber)
+  : m_path{std::move(path)}
+  , m_options{options}
+  , m_file{m_path, OutputFile::Mode::Append}
+  , m_lastLogSequenceNumber{lastLogSequenceNumber} {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  try {
+    sync();
+  } catch (...) { // NOLINT(bugprone-empty-catch)
+  }
+}
+
+BinaryWriter &WriteAheadLog::startRecord(const LogRecordType type) {
+  MY_ASSERT(!m_hasStartedRecord, "The previous record has to be finished or canceled first");
+  m_hasStartedRecord = true;
+  m_recordStart = m_buffer.size();
+  // The size and the checksum are filled when the record is finished.
+  m_buffer.write(uint32_t{0U});
+  m_buffer.write(uint32_t{0U});
+  m_buffer.write(m_lastLogSequenceNumber + 1U);
+  m_buffer.write(type);
+  return m_buffer;
+}
+
+void WriteAheadLog::checkRecordSize() const {
+  MY_ASSERT(m_hasStartedRecord, "There is no record to check");
+  if (m_buffer.size() - m_recordStart - kRecordHeaderSize > std::numeric_limits<uint32_t>::max()) {
+    throw InvalidPersistedDataException("the modification is too big to be logged");
+  }
+}
+
+void WriteAheadLog::finishRecord() {
+  checkRecordSize();
+  const auto payloadSize = m_buffer.size() - m_recordStart - kRecordHeaderSize;
+  m_buffer.writeAt(m_recordStart + kPayloadSizeOffset, static_cast<uint32_t>(payloadSize));
+  m_buffer.writeAt(m_recordStart + kChecksumOffset,
+                   calculateChecksum(m_buffer.bytes().subspan(m_recordStart + kChecksumBegin)));
+  m_hasStartedRecord = false;
+  ++m_lastLogSequenceNumber;
+  ++m_numberOfBufferedRecords;
+  if (m_numberOfBufferedRecords >= m_options.groupCommitSize) {
+    sync();
+  }
+}
+
+void WriteAheadLog::cancelRecord() {
+  MY_ASSERT(m_hasStartedRecord, "There is no record to cancel");
+  m_hasStartedRecord = false;
+  m_buffer.truncate(m_recordStart);
+}
+
+void WriteAheadLog::sync() {
+  if (m_numberOfBufferedRecords == 0U) {
+    return;
+  }
+  m_file.write(m_buffer.bytes());
+  m_file.sync();
+  m_buffer.clear();
+  m_numberOfBufferedRecords = 0U;
+}
+
+void WriteAheadLog::truncate() {
+  MY_ASSERT(!m_hasStartedRecord, "The log cannot be truncated while a record is being written");
+  m_buffer.clear();
+  m_numberOfBufferedRecords = 0U;
+  m_file.close();
+  m_file = OutputFile{m_path, OutputFile::Mode::Truncate};
+  m_file.sync();
+}
+
+uint64_t WriteAheadLog::lastLogSequenceNumber() const {
+  return m_lastLogSequenceNumber;
+}
+
+void writeLogEntity(BinaryWriter &writer, const EntityId id, const Properties &properties) {
+  writer.write(id);
+  writer.write(serializePropertyMask(properties.mask()));
+  forEachPresentProperty(properties, [&writer](const PropertyId /*propertyId*/, const auto &value) {
+    using TProperty = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<TProperty, std::string>) {
+      writer.writeString(value);
+    } else if constexpr (std::is_same_v<TProperty, const char *>) {
+      writer.write(static_cast<uint8_t>(value == nullptr ? 0U : 1U));
+      if (value != nullptr) {
+        writer.writeString(value);
+      }
+    } else {
+      writer.write(value);
+    }
+  });
+}
+
+void writeLogEntities(BinaryWriter &writer, std::span<const Entity> entities) {
+  writer.write(static_cast<uint64_t>(entities.size()));
+  for (const auto &entity: entities) {
+    writeLogEntity(writer, entity.id(), entity.properties());
+  }
+}
+
+void writeLogIds(BinaryWriter &writer, std::span<const EntityId> ids) {
+  writer.write(static_cast<uint64_t>(ids.size()));
+  for (const auto id: ids) {
+    writer.write(id);
+  }
+}
+
+void writeLogChanges(BinaryWriter &writer, const ChangeSet &changes) {
+  writeLogIds(writer, changes.removed);
+  writeLogEntities(writer, changes.updated);
+  writeLogEntities(writer, changes.inserted);
+}
+
+class LogRecordReader {
+public:
+  explicit LogRecordReader(RootStore &store)
+    : m_store{store} {
+  }
+
+  void apply(const LogRecordType type, BinaryReader &reader) {
+    switch (type) {
+    case LogRecordType::Insert: {
+      auto entities = readEntities(reader);
+      static_cast<void>(m_store.insertBatch(std::span<Entity>{entities}));
+      break;
+    }
+    case LogRecordType::Update: {
+      auto entities = readEntities(reader);
+      static_cast<void>(m_store.updateBatch(std::span<Entity>{entities}));
+      break;
+    }
+    case LogRecordType::Remove:
+      static_cast<void>(m_store.removeBatch(readIds(reader)));
+      break;
+    case LogRecordType::Changes: {
+      ChangeSet changes;
+      changes.removed = readIds(reader);
+      changes.updated = readEntities(reader);
+      changes.inserted = readEntities(reader);
+      m_store.applyChanges(std::move(changes));
+      break;
+    }
+    default:
+      throw InvalidPersistedDataException("unknown write-ahead log record type");
+    }
+    if (!reader.atEnd()) {
+      throw InvalidPersistedDataException("unexpected data at the end of the write-ahead log record");
+    }
+  }
+
+private:
+  // The count is validated against the remaining bytes before reserving memory for the items.
+  static uint64_t readCount(BinaryReader &reader, const size_t minItemSize) {
+    const auto count = reader.read<uint64_t>();
+    if (count > reader.remainingSize() / minItemSize) {
+      throw InvalidPersistedDataException("the number of items doesn't match the size of the write-ahead log record");
+    }
+    return count;
+  }
+
+  std::vector<EntityId> readIds(BinaryReader &reader) {
+    const auto count = readCount(reader, sizeof(EntityId));
+    std::vector<EntityId> ids;
+    ids.reserve(count);
+    for (uint64_t index{0U}; index < count; ++index) {
+      ids.push_back(reader.read<EntityId>());
+    }
+    return ids;
+  }
+
+  std::vector<Entity> readEntities(BinaryReader &reader) {
+    const auto count = readCount(reader, sizeof(EntityId) + sizeof(SerializedPropertyMask));
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    for (uint64_t index{0U}; index < count; ++index) {
+      const auto id = reader.read<EntityId>();
+      entities.emplace_back(id, readProperties(reader));
+    }
+    return entities;
+  }
+
+  Properties readProperties(BinaryReader &reader) {
+    const auto mask = deserializePropertyMask(reader.read<SerializedPropertyMask>());
+
+    Properties properties;
+    for (std::underlying_type_t<PropertyId> propertyIndex{0U}; propertyIndex <= asUnderlying(PropertyId::LAST);
+         ++propertyIndex) {
+      const auto propertyId = static_cast<PropertyId>(propertyIndex);
+      if (!mask.test(propertyIndex)) {
+        continue;
+      }
+      switch (getPropertyType(propertyId)) {
+      case PropertyType::String:
+        properties.setAs(propertyId, std::string{reader.readString()});
+        break;
+      case PropertyType::Double:
+        properties.setAs(propertyId, reader.readDoubleProperty());
+        break;
+      case PropertyType::ConstCharPtr:
+        properties.setAs(propertyId, reader.read<uint8_t>() == 0U ? nullptr : ownString(reader.readString()));
+        break;
+      }
+    }
+    return properties;
+  }
+
+  // Every distinct string is allocated only once, and it is kept alive by the store.
+  const char *ownString(const std::string_view value) {
+    const auto it = m_ownedStrings.find(value);
+    if (it != m_ownedStrings.end()) {
+      return it->second;
+    }
+    auto ownedString = std::make_shared<const std::string>(value);
+    const auto *result = ownedString->c_str();
+    m_ownedStrings.emplace(std::string_view{*ownedString}, result);
+    m_store.keepAlive(std::move(ownedString));
+    return result;
+  }
+
+  RootStore &m_store;
+  std::unordered_map<std::string_view, const char *> m_ownedStrings;
+};
+
+LogReplayResult replayWriteAheadLog(const std::filesystem::path &path, RootStore &store,
+                                    const uint64_t afterLogSequenceNumber) {
+  LogReplayResult result{afterLogSequenceNumber, 0U, 0U};
+  if (!std::filesystem::exists(path)) {
+    return result;
+  }
+
+  const MappedFile file{path};
+  const auto bytes = file.bytes();
+  LogRecordReader recordReader{store};
+  while (bytes.size() - result.validSize >= kRecordHeaderSize) {
+    const auto record = bytes.subspan(result.validSize);
+    BinaryReader headerReader{record.first(kRecordHeaderSize)};
+    const auto payloadSize = headerReader.read<uint32_t>();
+    const auto checksum = headerReader.read<uint32_t>();
+    const auto logSequenceNumber = headerReader.read<uint64_t>();
+    const auto type = headerReader.read<LogRecordType>();
+    if (payloadSize > record.size() - kRecordHeaderSize) {
+      break;
+    }
+    const auto recordSize = kRecordHeaderSize + payloadSize;
+    if (checksum != calculateChecksum(record.subspan(kChecksumBegin, recordSize - kChecksumBegin))) {
+      break;
+    }
+
+    // The records that are already in the snapshot are skipped. It can happen if the process crashed after the
+    // snapshot was saved, but before the log was truncated.
+    if (logSequenceNumber > afterLogSequenceNumber) {
+      if (logSequenceNumber != result.lastLogSequenceNumber + 1U) {
+        throw InvalidPersistedDataException("records are missing from the write-ahead log");
+      }
+      BinaryReader payloadReader{record.subspan(kRecordHeaderSize, payloadSize)};
+      recordReader.apply(type, payloadReader);
+      result.lastLogSequenceNumber = logSequenceNumber;
+      ++result.numberOfReplayedRecords;
+    }
+    result.validSize += recordSize;
+  }
+  return result;
+}
+
+} // namespace EntityStore
@@ -8,23 +8,54 @@ DoesNotHavePropertyException::DoesNotHavePropertyException(const std::string_vie
   : std::out_of_range(std::string("Properties does not contain ") + propertyName.data() + " property!") {
 }
 
+InvalidPropertyValueException::InvalidPropertyValueException(const std::string_view propertyName)
+  : std::invalid_argument(std::string("The value of ") + propertyName.data() + " property cannot be NaN!") {
+}
+
 bool Properties::hasProperty(const PropertyId propertyId) const {
-  return m_propertyMap.find(propertyId) != m_propertyMap.end();
+  return getSlot(propertyId).has_value();
 }
 
+// The number of slots is a compile time constant, so these loops can be unrolled by the compiler and the only branch
+// per property is whether the update contains it or not.
 void Properties::update(Properties &&properties) {
-  properties.m_propertyMap.merge(std::move(m_propertyMap));
-  m_propertyMap = std::move(properties.m_propertyMap);
+  for (size_t slotIndex{0U}; slotIndex < m_propertySlots.size(); ++slotIndex) {
+    auto &updatedSlot = properties.m_propertySlots[slotIndex];
+    if (updatedSlot.has_value()) {
+      m_propertySlots[slotIndex] = std::move(updatedSlot);
+    }
+  }
 }
 
 void Properties::update(const Properties &properties) {
-  for (const auto &[id, property]: properties.m_propertyMap) {
-    m_propertyMap.insert_or_assign(id, property);
+  for (size_t slotIndex{0U}; slotIndex < m_propertySlots.size(); ++slotIndex) {
+    const auto &updatedSlot = properties.m_propertySlots[slotIndex];
+    if (updatedSlot.has_value()) {
+      m_propertySlots[slotIndex] = updatedSlot;
+    }
+  }
+}
+
+PropertyMask Properties::mask() const {
+  PropertyMask result;
+  for (size_t slotIndex{0U}; slotIndex < m_propertySlots.size(); ++slotIndex) {
+    result.set(slotIndex, m_propertySlots[slotIndex].has_value());
+  }
+  return result;
+}
+
+Properties Properties::extract(const PropertyMask &propertyIds) && {
+  Properties result;
+  for (size_t slotIndex{0U}; slotIndex < m_propertySlots.size(); ++slotIndex) {
+    if (propertyIds.test(slotIndex)) {
+      result.m_propertySlots[slotIndex] = std::move(m_propertySlots[slotIndex]);
+    }
   }
+  return result;
 }
 
 bool operator==(const Properties &lhs, const Properties &rhs) {
-  return lhs.m_propertyMap == rhs.m_propertyMap;
+  return lhs.m_propertySlots == rhs.m_propertySlots;
 }
 
 } // namespace EntityStore
@@ -0,0 +1,116 @@
+#include "EntityStore/Query.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+namespace EntityStore {
+
+Query::Query(const Kind kind, const PropertyId propertyId, Property value, std::optional<Property> maxValue)
+  : m_kind{kind}
+  , m_propertyId{propertyId}
+  , m_value{std::move(value)}
+  , m_maxValue{std::move(maxValue)} {
+}
+
+Query::Query(const Kind kind, std::vector<Query> operands)
+  : m_kind{kind}
+  , m_operands{std::move(operands)} {
+}
+
+Query Query::has(const PropertyId propertyId) {
+  return Query{Kind::Present, propertyId, Property{}, std::nullopt};
+}
+
+Query Query::allOf(std::vector<Query> queries) {
+  return Query{Kind::And, std::move(queries)};
+}
+
+Query Query::anyOf(std::vector<Query> queries) {
+  return Query{Kind::Or, std::move(queries)};
+}
+
+Query Query::combine(const Kind kind, Query lhs, Query rhs) {
+  auto appendOperands = [kind](std::vector<Query> &operands, Query &&query) {
+    if (query.m_kind == kind) {
+      std::move(query.m_operands.begin(), query.m_operands.end(), std::back_inserter(operands));
+    } else {
+      operands.push_back(std::move(query));
+    }
+  };
+
+  std::vector<Query> operands;
+  appendOperands(operands, std::move(lhs));
+  appendOperands(operands, std::move(rhs));
+  return Query{kind, std::move(operands)};
+}
+
+Query operator&&(Query lhs, Query rhs) {
+  return Query::combine(Query::Kind::And, std::move(lhs), std::move(rhs));
+}
+
+Query operator||(Query lhs, Query rhs) {
+  return Query::combine(Query::Kind::Or, std::move(lhs), std::move(rhs));
+}
+
+Query operator!(Query query) {
+  if (query.m_kind == Query::Kind::Not) {
+    return std::move(query.m_operands.front());
+  }
+  std::vector<Query> operands;
+  operands.push_back(std::move(query));
+  return Query{Query::Kind::Not, std::move(operands)};
+}
+
+Query::Kind Query::kind() const {
+  return m_kind;
+}
+
+bool Query::isCondition() const {
+  return m_kind == Kind::Equal || m_kind == Kind::Range || m_kind == Kind::Present;
+}
+
+PropertyId Query::propertyId() const {
+  return m_propertyId;
+}
+
+const Property &Query::value() const {
+  return m_value;
+}
+
+const std::optional<Property> &Query::maxValue() const {
+  return m_maxValue;
+}
+
+const std::vector<Query> &Query::operands() const {
+  return m_operands;
+}
+
+bool Query::matches(const Properties &properties) const {
+  // The values are stored as the type of the property, so the stored alternative of the query values are always the
+  // same as the one of the property value.
+  switch (m_kind) {
+  case Kind::Equal:
+    return properties.hasProperty(m_propertyId) && properties.visit(m_propertyId, [this](const auto &propertyValue) {
+      return propertyValue == std::get<std::decay_t<decltype(propertyValue)>>(m_value);
+    });
+  case Kind::Range:
+    return properties.hasProperty(m_propertyId) && properties.visit(m_propertyId, [this](const auto &propertyValue) {
+      using TProperty = std::decay_t<decltype(propertyValue)>;
+      return propertyValue >= std::get<TProperty>(m_value) && propertyValue < std::get<TProperty>(*m_maxValue);
+    });
+  case Kind::Present:
+    return properties.hasProperty(m_propertyId);
+  case Kind::And:
+    return std::all_of(m_operands.begin(), m_operands.end(),
+                       [&properties](const Query &operand) { return operand.matches(properties); });
+  case Kind::Or:
+    return std::any_of(m_operands.begin(), m_operands.end(),
+                       [&properties](const Query &operand) { return operand.matches(properties); });
+  case Kind::Not:
+    return !m_operands.front().matches(properties);
+  }
+  return false;
+}
+
+} // namespace EntityStore
@@ -0,0 +1,21 @@
+#include "EntityStore/QueryCursor.hpp"
+
+#include "EntityStore/Internal/InlinedFilter.hpp"
+
+namespace EntityStore {
+
+StoreAggregator aggregateCursorBatch(const IStore &store, const QueryPlan &plan, const StoreAggregator &emptyAggregator,
+                                     const QueryExecutor *executor, Instrumentation *instrumentation) {
+  return std::visit(
+      [&](const auto &aggregator) {
+        const auto scan = [&](const auto &scanPredicate) {
+          return plan.lookup.has_value()
+                     ? aggregateInlined(store, scanPredicate, *plan.lookup, aggregator, executor)
+                     : aggregateInlined(store, scanPredicate, aggregator, executor);
+        };
+        return StoreAggregator{instrumentScan(instrumentation, StoreOperation::Query, plan.predicate, scan)};
+      },
+      emptyAggregator);
+}
+
+} // namespace EntityStore
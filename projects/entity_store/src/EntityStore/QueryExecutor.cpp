@@ -0,0 +1,36 @@
+#include "EntityStore/QueryExecutor.hpp"
+
+#include <algorithm>
+
+namespace EntityStore {
+
+QueryExecutor::QueryExecutor(const unsigned numberOfThreads, const size_t minChunkSize)
+  : m_taskSystem{std::make_unique<TaskSystem>(numberOfThreads)}
+  , m_minChunkSize{std::max(minChunkSize, size_t{1U})} {
+}
+
+unsigned QueryExecutor::numberOfThreads() const {
+  return m_taskSystem->numberOfThreads();
+}
+
+size_t QueryExecutor::minChunkSize() const {
+  return m_minChunkSize;
+}
+
+size_t QueryExecutor::numberOfChunks(const size_t numberOfItems) const {
+  // Using a few more chunks than threads helps to balance the load when some of the threads are slower, e.g. because
+  // their chunks contain more matching entities.
+  constexpr size_t chunksPerThread{4U};
+  const auto maxNumberOfChunks = size_t{numberOfThreads()} * chunksPerThread;
+  return std::clamp(numberOfItems / m_minChunkSize, size_t{1U}, maxNumberOfChunks);
+}
+
+QueryOptions QueryOptions::sequential() {
+  return QueryOptions{nullptr};
+}
+
+QueryOptions QueryOptions::parallel(const QueryExecutor &executor) {
+  return QueryOptions{&executor};
+}
+
+} // namespace EntityStore
@@ -1,7 +1,20 @@
 #include "EntityStore/Store.hpp"
 
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "EntityStore/Internal/ColumnarStore.hpp"
+#include "EntityStore/Internal/ConcurrentStore.hpp"
+#include "EntityStore/Internal/InlinedFilter.hpp"
+#include "EntityStore/Internal/LoggingStore.hpp"
 #include "EntityStore/Internal/NestedStore.hpp"
+#include "EntityStore/Internal/ObservedStore.hpp"
+#include "EntityStore/Internal/OptimisticStore.hpp"
+#include "EntityStore/Internal/QueryPlan.hpp"
 #include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Internal/Snapshot.hpp"
 
 namespace EntityStore {
 
@@ -10,39 +23,265 @@ Store::Store(std::unique_ptr<IStore> store)
 }
 
 Store Store::create() {
+  return create(StoreBackend::RowBased);
+}
+
+Store Store::create(const StoreBackend backend) {
+  switch (backend) {
+  case StoreBackend::Columnar:
+    return Store(std::make_unique<ColumnarStore>());
+  case StoreBackend::RowBased:
+    break;
+  }
   return Store(std::make_unique<RootStore>());
 }
 
+Store Store::createConcurrent() {
+  auto concurrentStore = std::make_unique<ConcurrentStore>();
+  auto *concurrentStorePtr = concurrentStore.get();
+  auto store = Store(std::move(concurrentStore));
+  store.m_concurrentStore = concurrentStorePtr;
+  return store;
+}
+
+Store Store::createTransactional() {
+  auto optimisticStore = std::make_unique<OptimisticStore>();
+  auto *optimisticStorePtr = optimisticStore.get();
+  auto store = Store(std::move(optimisticStore));
+  store.m_optimisticStore = optimisticStorePtr;
+  return store;
+}
+
 bool Store::contains(const EntityId id) const {
-  return m_store->contains(id);
+  return instrument(m_instrumentation.get(), StoreOperation::Read, [&] { return m_store->contains(id); });
 }
 
 const Properties *Store::tryGet(const EntityId id) const {
-  return m_store->tryGet(id);
+  return instrument(m_instrumentation.get(), StoreOperation::Read, [&] { return m_store->tryGet(id); });
 }
 
 const Properties &Store::get(const EntityId id) const {
-  return m_store->get(id);
+  return instrument(m_instrumentation.get(), StoreOperation::Read,
+                    [&]() -> const Properties & { return m_store->get(id); });
 }
 
 bool Store::remove(const EntityId id) {
-  return m_store->remove(id);
+  return instrument(m_instrumentation.get(), StoreOperation::Remove, [&] { return m_store->remove(id); });
+}
+
+BatchResult Store::insertBatch(std::span<const Entity> entities) {
+  return instrument(m_instrumentation.get(), StoreOperation::Insert, [&] { return m_store->insertBatch(entities); });
+}
+
+BatchResult Store::insertBatch(std::vector<Entity> &&entities) {
+  return instrument(m_instrumentation.get(), StoreOperation::Insert,
+                    [&] { return m_store->insertBatch(std::span<Entity>{entities}); });
+}
+
+BatchResult Store::updateBatch(std::span<const Entity> entities) {
+  return instrument(m_instrumentation.get(), StoreOperation::Update, [&] { return m_store->updateBatch(entities); });
+}
+
+BatchResult Store::updateBatch(std::vector<Entity> &&entities) {
+  return instrument(m_instrumentation.get(), StoreOperation::Update,
+                    [&] { return m_store->updateBatch(std::span<Entity>{entities}); });
+}
+
+BatchResult Store::removeBatch(std::span<const EntityId> ids) {
+  return instrument(m_instrumentation.get(), StoreOperation::Remove, [&] { return m_store->removeBatch(ids); });
 }
 
 void Store::shrink() {
-  m_store->shrink();
+  instrument(m_instrumentation.get(), StoreOperation::Shrink, [this] { m_store->shrink(); });
+}
+
+bool Store::compact(const size_t maxMovedEntities) {
+  return instrument(m_instrumentation.get(), StoreOperation::Shrink,
+                    [&] { return m_store->compact(maxMovedEntities); });
+}
+
+void Store::saveSnapshot(const std::filesystem::path &path) const {
+  EntityStore::saveSnapshot(*m_store, path);
+}
+
+Store Store::loadSnapshot(const std::filesystem::path &path) {
+  return Store(std::make_unique<RootStore>(EntityStore::loadSnapshot(path).store));
+}
+
+Store Store::open(const std::filesystem::path &snapshotPath, const std::filesystem::path &logPath,
+                  const WriteAheadLogOptions &options) {
+  auto loggingStore = LoggingStore::open(snapshotPath, logPath, options);
+  auto *loggingStorePtr = loggingStore.get();
+  auto store = Store(std::move(loggingStore));
+  store.m_loggingStore = loggingStorePtr;
+  return store;
+}
+
+bool Store::checkpoint() {
+  if (m_loggingStore == nullptr) {
+    return false;
+  }
+  m_loggingStore->checkpoint();
+  return true;
+}
+
+bool Store::syncWriteAheadLog() {
+  if (m_loggingStore == nullptr) {
+    return false;
+  }
+  m_loggingStore->syncLog();
+  return true;
+}
+
+Store Store::readSnapshot() const {
+  if (m_concurrentStore == nullptr) {
+    throw std::logic_error("Only a concurrent store can be read by snapshots!");
+  }
+  auto snapshot = Store(m_concurrentStore->createSnapshot());
+  snapshot.m_queryExecutor = m_queryExecutor;
+  snapshot.m_instrumentation = m_instrumentation;
+  return snapshot;
 }
 
 Store Store::createChild() {
-  return Store(std::make_unique<NestedStore>(*m_store));
+  if (m_optimisticStore != nullptr) {
+    auto transaction = Store(m_optimisticStore->beginTransaction());
+    transaction.m_queryExecutor = m_queryExecutor;
+    transaction.m_instrumentation = m_instrumentation;
+    return transaction;
+  }
+  auto nestedStore = std::make_unique<NestedStore>(*m_store);
+  auto *nestedStorePtr = nestedStore.get();
+  nestedStorePtr->setInstrumentation(m_instrumentation.get());
+  auto child = Store(std::move(nestedStore));
+  child.m_nestedStore = nestedStorePtr;
+  child.m_queryExecutor = m_queryExecutor;
+  child.m_instrumentation = m_instrumentation;
+  return child;
+}
+
+// The store is wrapped only by the first subscription, so the stores without subscriptions don't pay for the extra
+// virtual calls.
+std::shared_ptr<ChangeSubscription> Store::subscribe(const size_t capacity) {
+  if (m_optimisticStore != nullptr || m_store->asNestedStore() != nullptr) {
+    throw std::logic_error("Only the root stores that are not transactional can be subscribed to!");
+  }
+  if (m_observedStore == nullptr) {
+    auto observedStore = std::make_unique<ObservedStore>(std::move(m_store), m_concurrentStore != nullptr);
+    m_observedStore = observedStore.get();
+    m_store = std::move(observedStore);
+  }
+  return m_observedStore->subscribe(capacity);
+}
+
+bool Store::enableInstrumentation() {
+  if constexpr (!kIsInstrumentationEnabled) {
+    return false;
+  }
+  if (m_instrumentation != nullptr) {
+    return false;
+  }
+  m_instrumentation = std::make_shared<Instrumentation>();
+  if (m_nestedStore != nullptr) {
+    m_nestedStore->setInstrumentation(m_instrumentation.get());
+  }
+  return true;
+}
+
+std::optional<StoreStatistics> Store::statistics() const {
+  if (m_instrumentation == nullptr) {
+    return std::nullopt;
+  }
+  return m_instrumentation->snapshot();
+}
+
+void Store::resetStatistics() {
+  if (m_instrumentation != nullptr) {
+    m_instrumentation->reset();
+  }
+}
+
+void Store::setQueryExecutor(const QueryExecutor *executor) {
+  m_queryExecutor = executor;
+}
+
+const QueryExecutor *Store::queryExecutor() const {
+  return m_queryExecutor;
+}
+
+bool Store::createIndex(const PropertyId propertyId, const IndexType indexType) {
+  return m_store->createIndex(propertyId, indexType);
+}
+
+bool Store::dropIndex(const PropertyId propertyId) {
+  return m_store->dropIndex(propertyId);
+}
+
+EntityIdSet Store::filter(const Query &query, const QueryOptions &options) const {
+  const auto plan = planQuery(query, *m_store);
+  const auto *executor = getExecutor(options);
+  return instrumentScan(m_instrumentation.get(), StoreOperation::Query, plan.predicate, [&](const auto &scanPredicate) {
+    if (plan.lookup.has_value()) {
+      return filterIdsInlined(*m_store, scanPredicate, *plan.lookup, executor);
+    }
+    return filterIdsInlined(*m_store, scanPredicate, executor);
+  });
+}
+
+// The predicate is passed by its concrete type, so the scan loops are compiled for it without virtual calls. They are
+// compiled for every type of Property by the visit.
+EntityIdSet Store::queryLookup(const IndexLookup &lookup, const QueryOptions &options) const {
+  const auto *executor = getExecutor(options);
+  const auto scan = [&](const auto &predicate) {
+    return instrumentScan(m_instrumentation.get(), StoreOperation::Query, predicate, [&](const auto &scanPredicate) {
+      return filterIdsInlined(*m_store, scanPredicate, lookup, executor);
+    });
+  };
+  return std::visit(
+      [&]<typename TProperty>(const TProperty &value) {
+        if (lookup.isEquality()) {
+          return scan(SimpleQueryEntityPredicate<TProperty, TProperty>(lookup.propertyId, value));
+        }
+        return scan(RangeQueryEntityPredicate<TProperty, TProperty, TProperty>(
+            lookup.propertyId, value, std::get<TProperty>(*lookup.upperBound)));
+      },
+      lookup.lowerBound);
+}
+
+EntityIdSet Store::filterWithoutIndex(const EntityPredicate &predicate, const QueryOptions &options) const {
+  const auto *executor = getExecutor(options);
+  return instrumentScan(m_instrumentation.get(), StoreOperation::Query, predicate,
+                        [&](const auto &scanPredicate) { return m_store->filterIds(scanPredicate, executor); });
+}
+
+StoreAggregator Store::aggregate(const Query &query, const StoreAggregator &emptyAggregator,
+                                 const QueryOptions &options) const {
+  const auto plan = planQuery(query, *m_store);
+  const auto *executor = getExecutor(options);
+  return std::visit(
+      [&](const auto &aggregator) {
+        const auto scan = [&](const auto &scanPredicate) {
+          if (plan.lookup.has_value()) {
+            return aggregateInlined(*m_store, scanPredicate, *plan.lookup, aggregator, executor);
+          }
+          return aggregateInlined(*m_store, scanPredicate, aggregator, executor);
+        };
+        return StoreAggregator{
+            instrumentScan(m_instrumentation.get(), StoreOperation::Aggregate, plan.predicate, scan)};
+      },
+      emptyAggregator);
+}
+
+const QueryExecutor *Store::getExecutor(const QueryOptions &options) const {
+  return options.executor.value_or(m_queryExecutor);
 }
 
 void Store::commit() {
-  m_store->commit();
+  instrument(m_instrumentation.get(), StoreOperation::Commit, [this] { m_store->commit(); });
 }
 
 void Store::rollback() {
-  m_store->rollback();
+  instrument(m_instrumentation.get(), StoreOperation::Rollback, [this] { m_store->rollback(); });
 }
 
 } // namespace EntityStore
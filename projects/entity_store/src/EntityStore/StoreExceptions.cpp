@@ -1,5 +1,7 @@
 #include "EntityStore/StoreExceptions.hpp"
 
+#include <string>
+
 namespace EntityStore {
 
 DoesNotHaveEntityException::DoesNotHaveEntityException(const EntityId id)
@@ -10,4 +12,12 @@ InvalidRangeException::InvalidRangeException()
   : std::logic_error("The specified range is invalid!") {
 }
 
+InvalidPersistedDataException::InvalidPersistedDataException(const std::string_view reason)
+  : std::runtime_error("Invalid persisted data: " + std::string{reason}) {
+}
+
+TransactionConflictException::TransactionConflictException()
+  : std::runtime_error("The transaction conflicts with an earlier commit!") {
+}
+
 } // namespace EntityStore
@@ -0,0 +1,42 @@
+#include "EntityStore/StoreStatistics.hpp"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace EntityStore {
+
+size_t Log2Histogram::bucketOf(const uint64_t value) {
+  return static_cast<size_t>(std::bit_width(value));
+}
+
+uint64_t Log2Histogram::percentileUpperBound(const double percentile) const {
+  if (count == 0U) {
+    return 0U;
+  }
+  const auto rank = static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(count)));
+  uint64_t seen{0U};
+  for (size_t bucket{0U}; bucket < kNumberOfBuckets; ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank && seen != 0U) {
+      if (bucket == kNumberOfBuckets - 1U) {
+        return std::numeric_limits<uint64_t>::max();
+      }
+      return uint64_t{1U} << bucket;
+    }
+  }
+  return std::numeric_limits<uint64_t>::max();
+}
+
+double Log2Histogram::mean() const {
+  if (count == 0U) {
+    return 0.0;
+  }
+  return static_cast<double>(sum) / static_cast<double>(count);
+}
+
+const Log2Histogram &StoreStatistics::latency(const StoreOperation operation) const {
+  return latencies[asUnderlying(operation)];
+}
+
+} // namespace EntityStore
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace utils::containers {
+
+// A resizable bitset that stores its bits in 64 bit words. Unlike std::vector<bool>, it gives access to the words, so
+// the set bits can be iterated by skipping a whole word of unset bits at once and bitwise operations can be done word
+// by word.
+// The bits that are beyond the size of the bitset are always unset, so the words can be used directly without masking.
+class DynamicBitset {
+public:
+  using WordType = uint64_t;
+  static constexpr size_t kBitsPerWord = 64U;
+
+  DynamicBitset() = default;
+  explicit DynamicBitset(const size_t size, const bool value = false) {
+    resize(size, value);
+  }
+
+  // Complexity: constant
+  [[nodiscard]] size_t size() const noexcept {
+    return m_size;
+  }
+
+  // Complexity: constant
+  [[nodiscard]] bool empty() const noexcept {
+    return m_size == 0U;
+  }
+
+  // The new bits are initialized with the specified value.
+  // Complexity: linear in the difference between the old and new size
+  void resize(const size_t size, const bool value = false) {
+    if (value && size > m_size) {
+      // Fill the unused bits of the last word first, the new words are filled by the vector
+      const auto firstNewBit = m_size;
+      m_size = std::min(size, wordCount(m_size) * kBitsPerWord);
+      for (auto index = firstNewBit; index < m_size; ++index) {
+        set(index);
+      }
+    }
+    m_words.resize(wordCount(size), value ? ~WordType{0U} : WordType{0U});
+    m_size = size;
+    clearUnusedBits();
+  }
+
+  void pushBack(const bool value) {
+    resize(m_size + 1U);
+    set(m_size - 1U, value);
+  }
+
+  // Complexity: linear in the size of the bitset
+  void clear() noexcept {
+    m_words.clear();
+    m_size = 0U;
+  }
+
+  void shrinkToFit() {
+    m_words.shrink_to_fit();
+  }
+
+  // The index must be less than the size of the bitset.
+  // Complexity: constant
+  [[nodiscard]] bool test(const size_t index) const {
+    return (m_words[index / kBitsPerWord] & mask(index)) != 0U;
+  }
+
+  void set(const size_t index) {
+    m_words[index / kBitsPerWord] |= mask(index);
+  }
+
+  void set(const size_t index, const bool value) {
+    if (value) {
+      set(index);
+    } else {
+      reset(index);
+    }
+  }
+
+  void reset(const size_t index) {
+    m_words[index / kBitsPerWord] &= ~mask(index);
+  }
+
+  // Complexity: linear in the number of words
+  [[nodiscard]] size_t count() const noexcept {
+    size_t result{0U};
+    for (const auto word: m_words) {
+      result += static_cast<size_t>(std::popcount(word));
+    }
+    return result;
+  }
+
+  [[nodiscard]] bool none() const noexcept {
+    return std::all_of(m_words.begin(), m_words.end(), [](const WordType word) { return word == 0U; });
+  }
+
+  [[nodiscard]] bool any() const noexcept {
+    return !none();
+  }
+
+  // Returns the index of the first set bit which index is not less than the specified index. If there is no such bit,
+  // then the size of the bitset is returned.
+  // Complexity: linear in the number of words after the specified index
+  [[nodiscard]] size_t findNext(const size_t from) const noexcept {
+    if (from >= m_size) {
+      return m_size;
+    }
+    auto wordIndex = from / kBitsPerWord;
+    auto word = m_words[wordIndex] & (~WordType{0U} << (from % kBitsPerWord));
+    while (word == 0U) {
+      ++wordIndex;
+      if (wordIndex == m_words.size()) {
+        return m_size;
+      }
+      word = m_words[wordIndex];
+    }
+    return wordIndex * kBitsPerWord + static_cast<size_t>(std::countr_zero(word));
+  }
+
+  [[nodiscard]] size_t findFirst() const noexcept {
+    return findNext(0U);
+  }
+
+  // Calls the function with the index of every set bit in increasing order.
+  template <typename TFunc>
+  void forEachSetBit(TFunc &&func) const {
+    for (size_t wordIndex{0U}; wordIndex < m_words.size(); ++wordIndex) {
+      auto word = m_words[wordIndex];
+      while (word != 0U) {
+        func(wordIndex * kBitsPerWord + static_cast<size_t>(std::countr_zero(word)));
+        word &= word - 1U;
+      }
+    }
+  }
+
+  [[nodiscard]] const std::vector<WordType> &words() const noexcept {
+    return m_words;
+  }
+
+  // The bitwise operators work on bitsets with different sizes: the missing bits are treated as unset bits and the size
+  // of the left hand side operand is kept.
+  DynamicBitset &operator&=(const DynamicBitset &other) {
+    for (size_t wordIndex{0U}; wordIndex < m_words.size(); ++wordIndex) {
+      m_words[wordIndex] &= wordIndex < other.m_words.size() ? other.m_words[wordIndex] : WordType{0U};
+    }
+    return *this;
+  }
+
+  DynamicBitset &operator|=(const DynamicBitset &other) {
+    const auto commonWordCount = std::min(m_words.size(), other.m_words.size());
+    for (size_t wordIndex{0U}; wordIndex < commonWordCount; ++wordIndex) {
+      m_words[wordIndex] |= other.m_words[wordIndex];
+    }
+    clearUnusedBits();
+    return *this;
+  }
+
+  // Unsets every bit that is set in the other bitset.
+  DynamicBitset &subtract(const DynamicBitset &other) {
+    const auto commonWordCount = std::min(m_words.size(), other.m_words.size());
+    for (size_t wordIndex{0U}; wordIndex < commonWordCount; ++wordIndex) {
+      m_words[wordIndex] &= ~other.m_words[wordIndex];
+    }
+    return *this;
+  }
+
+  friend bool operator==(const DynamicBitset &lhs, const DynamicBitset &rhs) = default;
+
+private:
+  [[nodiscard]] static constexpr size_t wordCount(const size_t size) noexcept {
+    return (size + kBitsPerWord - 1U) / kBitsPerWord;
+  }
+
+  [[nodiscard]] static constexpr WordType mask(const size_t index) noexcept {
+    return WordType{1U} << (index % kBitsPerWord);
+  }
+
+  void clearUnusedBits() noexcept {
+    const auto usedBitsInLastWord = m_size % kBitsPerWord;
+    if (usedBitsInLastWord != 0U) {
+      m_words.back() &= ~(~WordType{0U} << usedBitsInLastWord);
+    }
+  }
+
+  std::vector<WordType> m_words;
+  size_t m_size{0U};
+};
+
+} // namespace utils::containers
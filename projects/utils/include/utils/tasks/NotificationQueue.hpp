@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace utils::tasks {
+
+// A simple task queue protected by a mutex. The try_ functions never block, so the workers of a task system can try to
+// use other queues if the lock of a queue is held by someone else.
+class NotificationQueue {
+public:
+  using Task = std::function<void()>;
+
+  void done() {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_done = true;
+    }
+    m_ready.notify_all();
+  }
+
+  // Blocks until a task is available or the queue is done. Returns false if the queue is done and empty.
+  bool pop(Task &task) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_ready.wait(lock, [this] { return !m_tasks.empty() || m_done; });
+    if (m_tasks.empty()) {
+      return false;
+    }
+    task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    return true;
+  }
+
+  bool tryPop(Task &task) {
+    std::unique_lock<std::mutex> lock{m_mutex, std::try_to_lock};
+    if (!lock || m_tasks.empty()) {
+      return false;
+    }
+    task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    return true;
+  }
+
+  template <typename TFunc>
+  void push(TFunc &&func) {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_tasks.emplace_back(std::forward<TFunc>(func));
+    }
+    m_ready.notify_one();
+  }
+
+  // The function is only moved from if the push was successful.
+  template <typename TFunc>
+  bool tryPush(TFunc &&func) {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex, std::try_to_lock};
+      if (!lock) {
+        return false;
+      }
+      m_tasks.emplace_back(std::forward<TFunc>(func));
+    }
+    m_ready.notify_one();
+    return true;
+  }
+
+private:
+  std::deque<Task> m_tasks{};
+  bool m_done{false};
+  std::mutex m_mutex{};
+  std::condition_variable m_ready{};
+};
+
+} // namespace utils::tasks
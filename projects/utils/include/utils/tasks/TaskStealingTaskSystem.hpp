@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <latch>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils/tasks/NotificationQueue.hpp"
+
+namespace utils::tasks {
+
+// The production ready version of the task stealing task system from experiments/task_systems: every worker has its
+// own queue, but before blocking on it, the workers try to steal tasks from the other queues for K rounds. The same
+// happens when a task is pushed, so the tasks are distributed evenly even if some of the queues are busy.
+template <size_t K>
+class TaskStealingTaskSystem {
+public:
+  explicit TaskStealingTaskSystem(const unsigned numberOfThreads = std::thread::hardware_concurrency())
+    : m_count{std::max(numberOfThreads, 1U)}
+    , m_queues(m_count) {
+    m_threads.reserve(m_count);
+    for (unsigned n = 0; n != m_count; ++n) {
+      m_threads.emplace_back([this, n] { run(n); });
+    }
+  }
+
+  ~TaskStealingTaskSystem() {
+    for (auto &queue: m_queues) {
+      queue.done();
+    }
+    for (auto &thread: m_threads) {
+      thread.join();
+    }
+  }
+
+  TaskStealingTaskSystem(const TaskStealingTaskSystem &) = delete;
+  TaskStealingTaskSystem(TaskStealingTaskSystem &&) = delete;
+  TaskStealingTaskSystem &operator=(const TaskStealingTaskSystem &) = delete;
+  TaskStealingTaskSystem &operator=(TaskStealingTaskSystem &&) = delete;
+
+  [[nodiscard]] unsigned numberOfThreads() const noexcept {
+    return m_count;
+  }
+
+  template <typename TFunc>
+  void async(TFunc &&func) {
+    auto index = m_index++;
+    for (unsigned n = 0; n != m_count * K; ++n) {
+      if (m_queues[(index + n) % m_count].tryPush(std::forward<TFunc>(func))) {
+        return;
+      }
+    }
+    m_queues[index % m_count].push(std::forward<TFunc>(func));
+  }
+
+  // Calls the function with every index in [0, numberOfTasks) on the worker threads and waits until all of them are
+  // finished. If any of the calls throws, then the first exception (by index) is rethrown after every task finished.
+  // Mustn't be called from a worker thread of the same task system, because that can lead to a deadlock.
+  template <typename TFunc>
+  void runAndWait(const size_t numberOfTasks, const TFunc &func) {
+    std::latch finished{static_cast<std::ptrdiff_t>(numberOfTasks)};
+    std::vector<std::exception_ptr> exceptions(numberOfTasks);
+    for (size_t taskIndex{0U}; taskIndex < numberOfTasks; ++taskIndex) {
+      async([&func, &finished, &exceptions, taskIndex] {
+        try {
+          func(taskIndex);
+        } catch (...) {
+          exceptions[taskIndex] = std::current_exception();
+        }
+        finished.count_down();
+      });
+    }
+    finished.wait();
+    for (const auto &exception: exceptions) {
+      if (exception) {
+        std::rethrow_exception(exception);
+      }
+    }
+  }
+
+private:
+  void run(const unsigned index) {
+    while (true) {
+      NotificationQueue::Task task;
+      for (unsigned n = 0; n != m_count * K; ++n) {
+        if (m_queues[(index + n) % m_count].tryPop(task)) {
+          break;
+        }
+      }
+      if (!task && !m_queues[index].pop(task)) {
+        break;
+      }
+      task();
+    }
+  }
+
+  const unsigned m_count;
+  std::vector<NotificationQueue> m_queues;
+  std::vector<std::thread> m_threads;
+  std::atomic<unsigned> m_index{0};
+};
+
+} // namespace utils::tasks
@@ -1,12 +1,32 @@
-﻿#include <numeric>
+﻿#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
 #include <set>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 
 #include <catch2/catch.hpp>
 #include "EntityStore/EntityUtils.hpp"
+#include "EntityStore/Internal/LoggingStore.hpp"
+#include "EntityStore/Internal/ObservedStore.hpp"
+#include "EntityStore/Internal/OptimisticStore.hpp"
+#include "EntityStore/Internal/QueryPlan.hpp"
+#include "EntityStore/Internal/RootStore.hpp"
+#include "EntityStore/Internal/Snapshot.hpp"
+#include "EntityStore/Internal/StringDictionary.hpp"
 #include "EntityStore/Store.hpp"
 
-// TODO(antaljanosbenjamin) Add proper unit tests for Property, Properties, RootStore and NestedStore
+// TODO(antaljanosbenjamin) Add proper unit tests for Property, RootStore and NestedStore
 using Store = EntityStore::Store;
 using Properties = EntityStore::Properties;
 using PropertyId = EntityStore::PropertyId;
@@ -295,6 +315,91 @@ public:
   }
 };
 
+TEST_CASE("Properties") {
+  using PropertyMask = EntityStore::PropertyMask;
+  const auto maskOf = [](std::initializer_list<PropertyId> propertyIds) {
+    PropertyMask mask;
+    for (const auto propertyId: propertyIds) {
+      mask.set(EntityStore::asUnderlying(propertyId));
+    }
+    return mask;
+  };
+
+  SECTION("Update") {
+    Properties properties;
+    properties.set<PropertyId::Title>("Title").set<PropertyId::Description>("Description");
+    const auto updates = Properties().set<PropertyId::Title>("New Title").setAs(PropertyId::Timestamp, 2.0);
+
+    SECTION("Copy") {
+      properties.update(updates);
+      CHECK(updates.get<PropertyId::Title>() == "New Title");
+    }
+    SECTION("Move") {
+      auto movedUpdates = updates;
+      properties.update(std::move(movedUpdates));
+    }
+    // The set slots of the update overwrite the existing ones, the empty ones keep them as they are.
+    CHECK(properties.get<PropertyId::Title>() == "New Title");
+    CHECK(properties.get<PropertyId::Description>() == "Description");
+    CHECK(properties.get<PropertyId::Timestamp>() == 2.0);
+    CHECK_FALSE(properties.hasProperty(PropertyId::CStyledString));
+    CHECK(properties.mask() == maskOf({PropertyId::Title, PropertyId::Description, PropertyId::Timestamp}));
+  }
+
+  SECTION("UpdateWithEmpty") {
+    auto properties = Properties().set<PropertyId::Title>("Title");
+    const auto original = properties;
+    properties.update(Properties{});
+    CHECK(properties == original);
+  }
+
+  SECTION("Mask") {
+    CHECK(Properties{}.mask().none());
+    const auto properties = Properties().set<PropertyId::Description>("Description").setAs(PropertyId::Timestamp, 1.0);
+    CHECK(properties.mask() == maskOf({PropertyId::Description, PropertyId::Timestamp}));
+  }
+
+  SECTION("Extract") {
+    auto properties = Properties()
+                          .set<PropertyId::Title>("Title")
+                          .set<PropertyId::Description>("Description")
+                          .setAs(PropertyId::Timestamp, 3.0);
+
+    // The mask can contain properties that are not set, they remain empty in the result.
+    const auto extracted =
+        std::move(properties).extract(maskOf({PropertyId::Title, PropertyId::Timestamp, PropertyId::CStyledString}));
+    CHECK(extracted.mask() == maskOf({PropertyId::Title, PropertyId::Timestamp}));
+    CHECK(extracted.get<PropertyId::Title>() == "Title");
+    CHECK(extracted.get<PropertyId::Timestamp>() == 3.0);
+    CHECK(extracted == Properties().set<PropertyId::Title>("Title").setAs(PropertyId::Timestamp, 3.0));
+  }
+
+  SECTION("ExtractNothing") {
+    auto properties = Properties().set<PropertyId::Title>("Title");
+    CHECK(std::move(properties).extract(PropertyMask{}) == Properties{});
+  }
+
+  SECTION("Equality") {
+    CHECK(Properties{} == Properties{});
+    const auto properties = Properties().set<PropertyId::Title>("Title");
+    CHECK(properties == Properties().set<PropertyId::Title>("Title"));
+    // An empty slot is not equal to any value, not even to a default constructed one.
+    CHECK_FALSE(properties == Properties{});
+    CHECK_FALSE(Properties().set<PropertyId::Title>("") == Properties{});
+    CHECK_FALSE(properties == Properties().set<PropertyId::Title>("Other Title"));
+    CHECK_FALSE(properties == Properties().set<PropertyId::Title>("Title").set<PropertyId::Description>("Title"));
+    CHECK_FALSE(Properties().set<PropertyId::Title>("Title") == Properties().set<PropertyId::Description>("Title"));
+  }
+
+  SECTION("NaN") {
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    auto properties = Properties().set<PropertyId::Timestamp>(1.0);
+    CHECK_THROWS_AS(properties.set<PropertyId::Timestamp>(nan), EntityStore::InvalidPropertyValueException);
+    CHECK_THROWS_AS(properties.setAs(PropertyId::Timestamp, nan), EntityStore::InvalidPropertyValueException);
+    CHECK(properties == Properties().set<PropertyId::Timestamp>(1.0));
+  }
+}
+
 TEST_CASE("SimpleInsert") {
   const auto init = [](Store & /*store*/) {};
 
@@ -916,3 +1021,1920 @@ TEST_CASE("SimpleOutput") {
                                "\tdescription => Road 60\n";
   CHECK(expectedOutput == ss.str());
 }
+
+TEST_CASE("IndexedQuery") {
+  constexpr EntityId numberOfEntities = 50;
+  constexpr auto numberOfTitles = 5U;
+  const auto makeTitle = [](const EntityId id) { return "Title " + std::to_string(id % numberOfTitles); };
+  const auto makeTimestamp = [](const EntityId id) { return static_cast<double>(id % 10); };
+
+  Store indexed = Store::create();
+  Store notIndexed = Store::create();
+  CHECK(indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Hash));
+  CHECK_FALSE(indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Ordered));
+
+  const auto forBoth = [&indexed, &notIndexed](const auto &func) {
+    func(indexed);
+    func(notIndexed);
+  };
+
+  forBoth([&](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      store.insert(id,
+                   Properties().set<PropertyId::Title>(makeTitle(id)).set<PropertyId::Timestamp>(makeTimestamp(id)));
+    }
+  });
+  // The index must contain the entities that were inserted before its creation
+  CHECK(indexed.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered));
+
+  const auto checkQueries = [&](const Store &lhs, const Store &rhs) {
+    for (auto titleIndex{0U}; titleIndex <= numberOfTitles; ++titleIndex) {
+      const auto title = "Title " + std::to_string(titleIndex);
+      CHECK(lhs.query<PropertyId::Title>(title) == rhs.query<PropertyId::Title>(title));
+      CHECK(lhs.queryAs<std::string>(PropertyId::Title, title.c_str()) ==
+            rhs.queryAs<std::string>(PropertyId::Title, title.c_str()));
+    }
+    for (auto timestamp{-1}; timestamp <= 11; ++timestamp) {
+      CHECK(lhs.query<PropertyId::Timestamp>(timestamp) == rhs.query<PropertyId::Timestamp>(timestamp));
+      CHECK(lhs.rangeQuery<PropertyId::Timestamp>(timestamp, 5.5) ==
+            rhs.rangeQuery<PropertyId::Timestamp>(timestamp, 5.5));
+      CHECK(lhs.rangeQueryAs<double>(PropertyId::Timestamp, 2, timestamp) ==
+            rhs.rangeQueryAs<double>(PropertyId::Timestamp, 2, timestamp));
+    }
+    // NaN cannot be stored, so it matches nothing, but the lookups must not confuse the indices either
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    CHECK(lhs.query<PropertyId::Timestamp>(nan).empty());
+    CHECK(rhs.query<PropertyId::Timestamp>(nan).empty());
+    CHECK(lhs.rangeQuery<PropertyId::Timestamp>(nan, 5.5) == rhs.rangeQuery<PropertyId::Timestamp>(nan, 5.5));
+    CHECK(lhs.rangeQuery<PropertyId::Timestamp>(2, nan) == rhs.rangeQuery<PropertyId::Timestamp>(2, nan));
+  };
+
+  checkQueries(indexed, notIndexed);
+  CHECK(indexed.query<PropertyId::Title>("Title 2").size() == numberOfEntities / numberOfTitles);
+  CHECK(indexed.rangeQuery<PropertyId::Timestamp>(2, 4).size() == numberOfEntities / 5);
+
+  forBoth([&](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; id += 3) {
+      store.update(id, Properties().set<PropertyId::Title>("Updated").set<PropertyId::Timestamp>(-1.0));
+    }
+    for (EntityId id{1}; id < numberOfEntities; id += 4) {
+      store.update(id, Properties().set<PropertyId::Description>("Doesn't change the indexed properties"));
+    }
+    for (EntityId id{0}; id < numberOfEntities; id += 5) {
+      store.remove(id);
+    }
+    store.shrink();
+  });
+
+  checkQueries(indexed, notIndexed);
+  CHECK(indexed.query<PropertyId::Title>("Updated") == notIndexed.query<PropertyId::Title>("Updated"));
+  CHECK_FALSE(indexed.query<PropertyId::Title>("Updated").empty());
+
+  {
+    auto indexedChild = indexed.createChild();
+    auto notIndexedChild = notIndexed.createChild();
+    CHECK_FALSE(indexedChild.createIndex(PropertyId::Description, EntityStore::IndexType::Hash));
+    for (auto *child: {&indexedChild, &notIndexedChild}) {
+      child->remove(1);
+      child->update(2, Properties().set<PropertyId::Title>("Title 0").set<PropertyId::Timestamp>(3.5));
+      child->insert(numberOfEntities, Properties().set<PropertyId::Title>("Title 0"));
+    }
+    checkQueries(indexedChild, notIndexedChild);
+    indexedChild.commit();
+    notIndexedChild.commit();
+  }
+  checkQueries(indexed, notIndexed);
+
+  CHECK(indexed.dropIndex(PropertyId::Title));
+  CHECK_FALSE(indexed.dropIndex(PropertyId::Title));
+  checkQueries(indexed, notIndexed);
+}
+
+TEST_CASE("ColumnarStore") {
+  constexpr EntityId numberOfEntities = 50;
+  const auto makeProperties = [](const EntityId id) {
+    auto properties = Properties().set<PropertyId::Title>("Title " + std::to_string(id % 5));
+    if (id % 2 == 0) {
+      properties.set<PropertyId::Timestamp>(static_cast<double>(id % 10));
+    }
+    if (id % 3 == 0) {
+      properties.set<PropertyId::CStyledString>("C styled");
+    }
+    return properties;
+  };
+
+  Store columnar = Store::create(EntityStore::StoreBackend::Columnar);
+  Store rowBased = Store::create(EntityStore::StoreBackend::RowBased);
+  CHECK_FALSE(columnar.createIndex(PropertyId::Title, EntityStore::IndexType::Hash));
+
+  const auto forBoth = [&columnar, &rowBased](const auto &func) {
+    func(columnar);
+    func(rowBased);
+  };
+
+  const auto checkStores = [&](const Store &lhs, const Store &rhs) {
+    for (EntityId id{0}; id <= numberOfEntities; ++id) {
+      CHECK(lhs.contains(id) == rhs.contains(id));
+      if (rhs.contains(id)) {
+        CHECK(lhs.get(id) == rhs.get(id));
+      } else {
+        checkStoreDoesNotContainEntity(lhs, id);
+      }
+    }
+    for (auto titleIndex{0U}; titleIndex <= 5; ++titleIndex) {
+      const auto title = "Title " + std::to_string(titleIndex);
+      CHECK(lhs.query<PropertyId::Title>(title) == rhs.query<PropertyId::Title>(title));
+    }
+    CHECK(lhs.rangeQuery<PropertyId::Title>("Title 1", "Title 3") ==
+          rhs.rangeQuery<PropertyId::Title>("Title 1", "Title 3"));
+    CHECK(lhs.query<PropertyId::Description>("Updated") == rhs.query<PropertyId::Description>("Updated"));
+    CHECK(lhs.query<PropertyId::CStyledString>("C styled") == rhs.query<PropertyId::CStyledString>("C styled"));
+    for (auto timestamp{-1}; timestamp <= 11; ++timestamp) {
+      CHECK(lhs.query<PropertyId::Timestamp>(timestamp) == rhs.query<PropertyId::Timestamp>(timestamp));
+      CHECK(lhs.rangeQuery<PropertyId::Timestamp>(timestamp, 5.5) ==
+            rhs.rangeQuery<PropertyId::Timestamp>(timestamp, 5.5));
+    }
+  };
+
+  forBoth([&](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      store.insert(id, makeProperties(id));
+    }
+  });
+  checkStores(columnar, rowBased);
+
+  forBoth([&](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; id += 3) {
+      store.update(id, Properties().set<PropertyId::Title>("Title 5").set<PropertyId::Description>("Updated"));
+    }
+    for (EntityId id{0}; id < numberOfEntities; id += 4) {
+      store.remove(id);
+    }
+  });
+  checkStores(columnar, rowBased);
+
+  forBoth([&](Store &store) {
+    store.shrink();
+    // Reuses the slots of the removed entities before shrinking
+    store.insert(0, makeProperties(1));
+  });
+  checkStores(columnar, rowBased);
+
+  // There is nothing to drop or move, so shrinking again must keep every entity as it is
+  forBoth([](Store &store) { store.shrink(); });
+  checkStores(columnar, rowBased);
+
+  {
+    auto columnarChild = columnar.createChild();
+    auto rowBasedChild = rowBased.createChild();
+    for (auto *child: {&columnarChild, &rowBasedChild}) {
+      child->remove(1);
+      child->update(2, Properties().set<PropertyId::Title>("Title 0").set<PropertyId::Timestamp>(3.5));
+      child->insert(numberOfEntities, makeProperties(numberOfEntities));
+    }
+    checkStores(columnarChild, rowBasedChild);
+    columnarChild.commit();
+    rowBasedChild.commit();
+  }
+  checkStores(columnar, rowBased);
+
+  // The updates refresh the cached properties in place, so the pointers returned by the point reads remain valid
+  const auto *properties = columnar.tryGet(2);
+  REQUIRE(properties != nullptr);
+  columnar.update(2, Properties().set<PropertyId::Description>("Updated again"));
+  CHECK(columnar.tryGet(2) == properties);
+  CHECK(properties->get<PropertyId::Description>() == "Updated again");
+
+  // The point reads fill the cache, so they have to be safe to call from many threads at the same time
+  constexpr EntityId numberOfReadEntities = 2000;
+  for (EntityId id{numberOfEntities + 1}; id <= numberOfEntities + numberOfReadEntities; ++id) {
+    columnar.insert(id, makeProperties(id));
+  }
+  std::atomic<size_t> numberOfWrongReads{0U};
+  std::vector<std::thread> readers;
+  for (size_t readerIndex{0U}; readerIndex < 4U; ++readerIndex) {
+    readers.emplace_back([&columnar, &makeProperties, &numberOfWrongReads]() {
+      for (EntityId id{numberOfEntities + 1}; id <= numberOfEntities + numberOfReadEntities; ++id) {
+        const auto *readProperties = columnar.tryGet(id);
+        if (readProperties == nullptr || *readProperties != makeProperties(id)) {
+          ++numberOfWrongReads;
+        }
+      }
+    });
+  }
+  for (auto &reader: readers) {
+    reader.join();
+  }
+  CHECK(numberOfWrongReads.load() == 0U);
+}
+
+TEST_CASE("StringDictionary") {
+  EntityStore::StringDictionary dictionary;
+  const auto lightsaberCode = dictionary.encode("Darth Bane's lightsaber");
+  const auto blasterCode = dictionary.encode("Blaster");
+  CHECK(lightsaberCode != blasterCode);
+  CHECK(dictionary.encode("Darth Bane's lightsaber") == lightsaberCode);
+  CHECK(dictionary.size() == 2U);
+  CHECK(dictionary.tryFind("Blaster") == blasterCode);
+  CHECK_FALSE(dictionary.tryFind("Lightsaber").has_value());
+
+  // The copy must not refer to the strings of the original dictionary.
+  auto copy = std::make_unique<EntityStore::StringDictionary>(dictionary);
+  dictionary = EntityStore::StringDictionary();
+  CHECK(copy->tryFind("Darth Bane's lightsaber") == lightsaberCode);
+  CHECK(copy->decode(blasterCode) == "Blaster");
+  CHECK(dictionary.size() == 0U);
+}
+
+TEST_CASE("BatchOperations") {
+  constexpr EntityId numberOfEntities = 20;
+  std::vector<Entity> entities;
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    entities.emplace_back(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+  }
+  // The duplicated id must fail exactly as with the single item insert
+  entities.emplace_back(0, Properties().set<PropertyId::Title>("Duplicated"));
+
+  std::vector<Entity> updates;
+  for (EntityId id{numberOfEntities / 2}; id < numberOfEntities + 2; ++id) {
+    updates.emplace_back(id, Properties().set<PropertyId::Title>("Updated " + std::to_string(id)));
+  }
+  const std::vector<EntityId> idsToRemove{1, 3, numberOfEntities + 5, 3};
+
+  const auto checkBatchResult = [](const EntityStore::BatchResult &result, const auto &expectedSuccess) {
+    REQUIRE(result.size() == expectedSuccess.size());
+    for (size_t index{0U}; index < result.size(); ++index) {
+      CHECK(result.test(index) == expectedSuccess[index]);
+    }
+  };
+
+  const auto checkBatches = [&](Store &store, Store &expected, const bool moveEntities) {
+    std::vector<bool> expectedInsertSuccess;
+    for (const auto &entity: entities) {
+      expectedInsertSuccess.push_back(expected.insert(entity.id(), entity.properties()));
+    }
+    std::vector<bool> expectedUpdateSuccess;
+    for (const auto &entity: updates) {
+      expectedUpdateSuccess.push_back(expected.update(entity.id(), entity.properties()) != nullptr);
+    }
+    std::vector<bool> expectedRemoveSuccess;
+    for (const auto id: idsToRemove) {
+      expectedRemoveSuccess.push_back(expected.remove(id));
+    }
+
+    if (moveEntities) {
+      checkBatchResult(store.insertBatch(std::vector<Entity>{entities}), expectedInsertSuccess);
+      checkBatchResult(store.updateBatch(std::vector<Entity>{updates}), expectedUpdateSuccess);
+    } else {
+      checkBatchResult(store.insertBatch(entities), expectedInsertSuccess);
+      checkBatchResult(store.updateBatch(updates), expectedUpdateSuccess);
+    }
+    checkBatchResult(store.removeBatch(idsToRemove), expectedRemoveSuccess);
+
+    for (EntityId id{0}; id < numberOfEntities + 5; ++id) {
+      REQUIRE(store.contains(id) == expected.contains(id));
+      if (expected.contains(id)) {
+        CHECK(store.get(id) == expected.get(id));
+      }
+    }
+  };
+
+  for (const auto backend: {EntityStore::StoreBackend::RowBased, EntityStore::StoreBackend::Columnar}) {
+    for (const auto moveEntities: {false, true}) {
+      {
+        INFO("Root store");
+        Store store = Store::create(backend);
+        Store expected = Store::create();
+        store.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+        checkBatches(store, expected, moveEntities);
+        CHECK(store.query<PropertyId::Title>("Updated 11") == EntityStore::EntityIdSet{11});
+      }
+      {
+        INFO("Child store");
+        Store store = Store::create(backend);
+        Store expected = Store::create();
+        for (auto *storeToInit: {&store, &expected}) {
+          storeToInit->insert(numberOfEntities + 1, Properties());
+        }
+        auto child = store.createChild();
+        checkBatches(child, expected, moveEntities);
+      }
+    }
+  }
+}
+
+TEST_CASE("ParallelQuery") {
+  constexpr EntityId numberOfEntities = 10000;
+  constexpr size_t minChunkSize = 64;
+  const EntityStore::QueryExecutor executor(4U, minChunkSize);
+  CHECK(executor.numberOfChunks(minChunkSize - 1) == 1);
+  CHECK(executor.numberOfChunks(numberOfEntities) > 1);
+
+  Store store = Store::create();
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    store.insert(id, Properties()
+                         .set<PropertyId::Title>("Title " + std::to_string(id % 7))
+                         .set<PropertyId::Timestamp>(static_cast<double>(id % 100)));
+  }
+  for (EntityId id{0}; id < numberOfEntities; id += 3) {
+    store.remove(id);
+  }
+
+  const auto checkQueries = [&executor](const Store &checkedStore) {
+    const auto sequential = EntityStore::QueryOptions::sequential();
+    const auto parallel = EntityStore::QueryOptions::parallel(executor);
+    for (auto titleIndex{0}; titleIndex < 8; ++titleIndex) {
+      const auto title = "Title " + std::to_string(titleIndex);
+      const auto expected = checkedStore.query<PropertyId::Title>(title, sequential);
+      CHECK(checkedStore.query<PropertyId::Title>(title, parallel) == expected);
+      CHECK(checkedStore.query<PropertyId::Title>(title) == expected);
+      CHECK(checkedStore.queryAs<std::string>(PropertyId::Title, title, parallel) == expected);
+    }
+    const auto expected = checkedStore.rangeQuery<PropertyId::Timestamp>(10, 50.5, sequential);
+    CHECK(checkedStore.rangeQuery<PropertyId::Timestamp>(10, 50.5, parallel) == expected);
+    CHECK(checkedStore.rangeQueryAs<double>(PropertyId::Timestamp, 10, 50.5, parallel) == expected);
+    CHECK(checkedStore.checkedRangeQuery<PropertyId::Timestamp>(10, 50.5) == expected);
+  };
+
+  checkQueries(store);
+  store.setQueryExecutor(&executor);
+  CHECK(store.queryExecutor() == &executor);
+  checkQueries(store);
+
+  auto child = store.createChild();
+  CHECK(child.queryExecutor() == &executor);
+  child.remove(1);
+  child.update(2, Properties().set<PropertyId::Title>("Title 0"));
+  child.insert(numberOfEntities, Properties().set<PropertyId::Title>("Title 0").set<PropertyId::Timestamp>(20));
+  checkQueries(child);
+  CHECK(child.query<PropertyId::Title>("Title 0").count(2) == 1);
+
+  store.setQueryExecutor(nullptr);
+  CHECK(store.queryExecutor() == nullptr);
+}
+
+TEST_CASE("EntityIdSet") {
+  using EntityIdSet = EntityStore::EntityIdSet;
+  const EntityIdSet lhs{5, 1, 3, 7, 3};
+  const EntityIdSet rhs{2, 3, 4, 5};
+  CHECK(lhs.size() == 4);
+  CHECK(std::is_sorted(lhs.begin(), lhs.end()));
+  CHECK(lhs.contains(7));
+  CHECK_FALSE(lhs.contains(2));
+  CHECK(lhs.count(1) == 1);
+  CHECK(EntityIdSet::fromUnsorted({3, 1, 2, 1}) == EntityIdSet::fromSorted({1, 2, 3}));
+
+  CHECK((lhs & rhs) == EntityIdSet{3, 5});
+  CHECK((lhs | rhs) == EntityIdSet{1, 2, 3, 4, 5, 7});
+  CHECK((lhs - rhs) == EntityIdSet{1, 7});
+  CHECK((lhs & EntityIdSet{}).empty());
+  CHECK((lhs | EntityIdSet{}) == lhs);
+
+  auto result = lhs;
+  result -= rhs;
+  CHECK(result == EntityIdSet{1, 7});
+  result |= rhs;
+  CHECK(result == EntityIdSet{1, 2, 3, 4, 5, 7});
+  result &= EntityIdSet{1, 4, 8};
+  CHECK(result == EntityIdSet{1, 4});
+  result |= EntityIdSet{0, 2, 4, 9};
+  CHECK(result == EntityIdSet{0, 1, 2, 4, 9});
+  result |= EntityIdSet{1, 9};
+  CHECK(result == EntityIdSet{0, 1, 2, 4, 9});
+
+  Store store = Store::create();
+  store.insert(1, Properties().set<PropertyId::Title>("A").set<PropertyId::Timestamp>(1));
+  store.insert(2, Properties().set<PropertyId::Title>("B").set<PropertyId::Timestamp>(2));
+  store.insert(3, Properties().set<PropertyId::Title>("A").set<PropertyId::Timestamp>(3));
+  auto child = store.createChild();
+  child.update(1, Properties().set<PropertyId::Title>("B"));
+  child.insert(4, Properties().set<PropertyId::Title>("A").set<PropertyId::Timestamp>(4));
+  CHECK(child.query<PropertyId::Title>("A") == EntityIdSet{3, 4});
+  CHECK((child.query<PropertyId::Title>("A") & child.rangeQuery<PropertyId::Timestamp>(2, 4)) == EntityIdSet{3});
+}
+
+TEST_CASE("CompoundQuery") {
+  using Query = EntityStore::Query;
+  constexpr EntityId numberOfEntities = 500;
+
+  const auto fillStore = [](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      auto properties = Properties()
+                            .set<PropertyId::Title>("Title " + std::to_string(id % 5))
+                            .set<PropertyId::Timestamp>(static_cast<double>(id % 100));
+      if (id % 2 == 0) {
+        properties.set<PropertyId::Description>("Even");
+      }
+      store.insert(id, std::move(properties));
+    }
+  };
+
+  const auto titleIs = [](const Properties &properties, const std::string &title) {
+    const auto *value = properties.tryGet<PropertyId::Title>();
+    return value != nullptr && *value == title;
+  };
+  const auto timestampIn = [](const Properties &properties, const double minValue, const double maxValue) {
+    const auto *value = properties.tryGet<PropertyId::Timestamp>();
+    return value != nullptr && *value >= minValue && *value < maxValue;
+  };
+  const auto hasDescription = [](const Properties &properties) {
+    return properties.hasProperty(PropertyId::Description);
+  };
+
+  const std::vector<std::pair<Query, std::function<bool(const Properties &)>>> queries{
+      {Query::equal<PropertyId::Title>("Title 1") && Query::inRange<PropertyId::Timestamp>(10, 50),
+       [&](const Properties &p) { return titleIs(p, "Title 1") && timestampIn(p, 10, 50); }},
+      {Query::equal<PropertyId::Title>("Title 1") || Query::equal<PropertyId::Title>("Title 2"),
+       [&](const Properties &p) { return titleIs(p, "Title 1") || titleIs(p, "Title 2"); }},
+      {!Query::has(PropertyId::Description) && Query::inRangeAs<double>(PropertyId::Timestamp, 0.0, 20.0),
+       [&](const Properties &p) { return !hasDescription(p) && timestampIn(p, 0, 20); }},
+      {Query::has(PropertyId::Description) &&
+           (Query::equalAs<std::string>(PropertyId::Title, "Title 3") || !Query::inRange<PropertyId::Timestamp>(5, 95)),
+       [&](const Properties &p) { return hasDescription(p) && (titleIs(p, "Title 3") || !timestampIn(p, 5, 95)); }},
+      {!!Query::equal<PropertyId::Timestamp>(42) && Query::allOf({}),
+       [&](const Properties &p) { return timestampIn(p, 42, 42.5); }},
+      {Query::anyOf({}), [](const Properties & /*p*/) { return false; }},
+  };
+
+  const auto checkQueries = [&queries](const Store &store) {
+    for (const auto &[query, expectedPredicate]: queries) {
+      std::vector<EntityId> expectedIds;
+      for (EntityId id{0}; id <= numberOfEntities; ++id) {
+        const auto *properties = store.tryGet(id);
+        if (properties != nullptr && expectedPredicate(*properties)) {
+          expectedIds.push_back(id);
+        }
+      }
+      CHECK(store.filter(query) == EntityStore::EntityIdSet::fromSorted(std::move(expectedIds)));
+    }
+  };
+
+  Store notIndexed = Store::create();
+  Store indexed = Store::create();
+  Store columnar = Store::create(EntityStore::StoreBackend::Columnar);
+  // The transactional store doesn't have inlined aggregate functions, so it is aggregated through IStore::aggregate
+  Store transactional = Store::createTransactional();
+  indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+  indexed.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  transactional.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (auto *store: {&notIndexed, &indexed, &columnar, &transactional}) {
+    fillStore(*store);
+    checkQueries(*store);
+    auto child = store->createChild();
+    child.remove(11);
+    child.update(12, Properties().set<PropertyId::Title>("Title 1"));
+    child.insert(numberOfEntities, Properties().set<PropertyId::Title>("Title 3").set<PropertyId::Timestamp>(1));
+    checkQueries(child);
+  }
+
+  CHECK_THROWS_AS(Query::equalAs<double>(PropertyId::Title, 1.0), EntityStore::InvalidPropertyTypeException);
+
+  // The most selective indexed condition is used as the lookup, regardless of the order in which the query was built,
+  // and the operands of the AND are ordered by their estimated cost and selectivity
+  EntityStore::RootStore rootStore;
+  rootStore.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+  rootStore.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    rootStore.insert(id, Properties()
+                             .set<PropertyId::Title>("Title " + std::to_string(id % 5))
+                             .set<PropertyId::Timestamp>(static_cast<double>(id % 100)));
+  }
+  const auto plan = EntityStore::planQuery(Query::inRange<PropertyId::Timestamp>(0, 90) &&
+                                               Query::equal<PropertyId::Title>("Title 1") &&
+                                               Query::equal<PropertyId::Timestamp>(3),
+                                           rootStore);
+  REQUIRE(plan.lookup.has_value());
+  CHECK(plan.lookup->propertyId == PropertyId::Timestamp);
+  CHECK(plan.lookup->isEquality());
+  const auto &operands = plan.predicate.query().operands();
+  REQUIRE(operands.size() == 3);
+  CHECK(operands[0].kind() == Query::Kind::Equal);
+  CHECK(operands[0].propertyId() == PropertyId::Timestamp);
+  CHECK(operands[2].kind() == Query::Kind::Range);
+
+  // Without indices the type of the conditions decide the order
+  const EntityStore::RootStore emptyStore;
+  const auto notIndexedPlan = EntityStore::planQuery(
+      Query::inRange<PropertyId::Timestamp>(0, 90) && Query::equal<PropertyId::Title>("Title 1"), emptyStore);
+  REQUIRE(notIndexedPlan.lookup.has_value());
+  CHECK(notIndexedPlan.lookup->propertyId == PropertyId::Title);
+
+  // The conditions under an OR cannot be used as a lookup, so their matches must not limit the counting of the ones
+  // that can be. Otherwise both range lookups are counted only up to 0 matches, and the less selective one is chosen.
+  EntityStore::RootStore orderedStore;
+  orderedStore.createIndex(PropertyId::Title, EntityStore::IndexType::Ordered);
+  orderedStore.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    orderedStore.insert(id, Properties()
+                                .set<PropertyId::Title>((id % 100 == 0 ? "rare " : "title ") + std::to_string(id))
+                                .set<PropertyId::Timestamp>(static_cast<double>(id)));
+  }
+  const auto rangeLookups = Query::inRange<PropertyId::Timestamp>(0, 1e9) && Query::inRange<PropertyId::Title>("r", "s");
+  const auto planWithOr = EntityStore::planQuery(
+      Query::anyOf({Query::equal<PropertyId::Timestamp>(-5), Query::has(PropertyId::Description)}) && rangeLookups,
+      orderedStore);
+  REQUIRE(planWithOr.lookup.has_value());
+  CHECK(planWithOr.lookup->propertyId == PropertyId::Title);
+  const auto planWithoutOr = EntityStore::planQuery(rangeLookups, orderedStore);
+  REQUIRE(planWithoutOr.lookup.has_value());
+  CHECK(planWithoutOr.lookup->propertyId == PropertyId::Title);
+
+  // The matches of the conditions under an OR are not limited by the lookups either, otherwise the range that matches
+  // every entity would look as selective as the rare title, and it would be evaluated after the other title
+  const auto planWithBroadOr = EntityStore::planQuery(
+      Query::equal<PropertyId::Title>("rare 0") &&
+          Query::anyOf({Query::equal<PropertyId::Title>("rare 100"), Query::inRange<PropertyId::Timestamp>(0, 1e9)}),
+      orderedStore);
+  REQUIRE(planWithBroadOr.lookup.has_value());
+  CHECK(planWithBroadOr.lookup->propertyId == PropertyId::Title);
+  const auto &plannedAnd = planWithBroadOr.predicate.query().operands();
+  const auto orIt = std::find_if(plannedAnd.begin(), plannedAnd.end(),
+                                 [](const Query &operand) { return operand.kind() == Query::Kind::Or; });
+  REQUIRE(orIt != plannedAnd.end());
+  CHECK(orIt->operands().front().kind() == Query::Kind::Range);
+
+  // Counting up to 0 matches doesn't count any
+  const auto zeroEstimate =
+      orderedStore.estimate(EntityStore::IndexLookup::inRange(PropertyId::Timestamp, 0.0, 1e9), 0U);
+  REQUIRE(zeroEstimate.has_value());
+  CHECK(zeroEstimate->matchingEntities == 0U);
+}
+
+TEST_CASE("Snapshot") {
+  constexpr EntityId numberOfEntities = 1000;
+  const std::array<const char *, 3> cStrings{"first", "second", "first"};
+  const auto snapshotPath = std::filesystem::temp_directory_path() / "entity_store_snapshot_test.bin";
+
+  Store store = Store::create();
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    auto properties = Properties()
+                          .set<PropertyId::Title>("Title " + std::to_string(id))
+                          .set<PropertyId::Timestamp>(static_cast<double>(id) / 3.0);
+    if (id % 3 == 0) {
+      properties.set<PropertyId::Description>(std::string(id % 50, 'x'));
+    }
+    if (id % 4 == 0) {
+      properties.set<PropertyId::CStyledString>(id % 8 == 0 ? nullptr : cStrings[id % cStrings.size()]);
+    }
+    store.insert(id, std::move(properties));
+  }
+  for (EntityId id{0}; id < numberOfEntities; id += 7) {
+    store.remove(id);
+  }
+
+  // The C strings are interned, so the loaded properties point to different, but equal strings
+  const auto checkSameEntities = [](const Store &expected, const Store &actual) {
+    for (EntityId id{0}; id <= numberOfEntities; ++id) {
+      REQUIRE(expected.contains(id) == actual.contains(id));
+      if (!expected.contains(id)) {
+        continue;
+      }
+      const auto &expectedProperties = expected.get(id);
+      const auto &actualProperties = actual.get(id);
+      CHECK(expectedProperties.tryGet<PropertyId::Title>() != nullptr);
+      CHECK(*expectedProperties.tryGet<PropertyId::Title>() == *actualProperties.tryGet<PropertyId::Title>());
+      CHECK(expectedProperties.get<PropertyId::Timestamp>() == actualProperties.get<PropertyId::Timestamp>());
+      REQUIRE(expectedProperties.hasProperty(PropertyId::Description) ==
+              actualProperties.hasProperty(PropertyId::Description));
+      if (expectedProperties.hasProperty(PropertyId::Description)) {
+        CHECK(expectedProperties.get<PropertyId::Description>() == actualProperties.get<PropertyId::Description>());
+      }
+      REQUIRE(expectedProperties.hasProperty(PropertyId::CStyledString) ==
+              actualProperties.hasProperty(PropertyId::CStyledString));
+      if (expectedProperties.hasProperty(PropertyId::CStyledString)) {
+        const auto *expectedCString = expectedProperties.get<PropertyId::CStyledString>();
+        const auto *actualCString = actualProperties.get<PropertyId::CStyledString>();
+        REQUIRE((expectedCString == nullptr) == (actualCString == nullptr));
+        if (expectedCString != nullptr) {
+          CHECK(std::string_view{expectedCString} == std::string_view{actualCString});
+        }
+      }
+    }
+  };
+
+  store.saveSnapshot(snapshotPath);
+  {
+    const auto loaded = Store::loadSnapshot(snapshotPath);
+    checkSameEntities(store, loaded);
+    CHECK(loaded.query<PropertyId::Title>("Title 5") == EntityStore::EntityIdSet{5});
+  }
+
+  {
+    auto child = store.createChild();
+    child.remove(1);
+    child.update(2, Properties().set<PropertyId::CStyledString>(cStrings[1]));
+    child.insert(numberOfEntities, Properties().set<PropertyId::Title>("New").set<PropertyId::Timestamp>(1.0));
+    child.saveSnapshot(snapshotPath);
+    auto loaded = Store::loadSnapshot(snapshotPath);
+    checkSameEntities(child, loaded);
+    // The loaded store is a fully functional store
+    CHECK(loaded.insert(numberOfEntities + 1, Properties().set<PropertyId::Title>("Inserted")));
+    CHECK(loaded.remove(2));
+  }
+
+  std::filesystem::resize_file(snapshotPath, std::filesystem::file_size(snapshotPath) - 1);
+  CHECK_THROWS_AS(Store::loadSnapshot(snapshotPath), EntityStore::InvalidPersistedDataException);
+  std::filesystem::remove(snapshotPath);
+  CHECK_THROWS_AS(Store::loadSnapshot(snapshotPath), std::system_error);
+}
+
+TEST_CASE("WriteAheadLog") {
+  const auto snapshotPath = std::filesystem::temp_directory_path() / "entity_store_wal_test_snapshot.bin";
+  const auto logPath = std::filesystem::temp_directory_path() / "entity_store_wal_test_log.bin";
+  std::filesystem::remove(snapshotPath);
+  std::filesystem::remove(logPath);
+  const auto numberOfRecords = [&snapshotPath, &logPath]() {
+    auto snapshot = std::filesystem::exists(snapshotPath) ? EntityStore::loadSnapshot(snapshotPath)
+                                                          : EntityStore::LoadedSnapshot{EntityStore::RootStore{}, 0U};
+    return EntityStore::replayWriteAheadLog(logPath, snapshot.store, snapshot.logSequenceNumber)
+        .numberOfReplayedRecords;
+  };
+
+  {
+    Store store = Store::open(snapshotPath, logPath);
+    CHECK(store.insert(entity1.id(), entity1.properties()));
+    CHECK(store.insert(entity2.id(), entity2.properties()));
+    CHECK(store.update(entity1.id(), Properties().set<PropertyId::CStyledString>("C string")) != nullptr);
+    CHECK(store.insertBatch(std::vector<Entity>{entity3, entity4, entity5}).count() == 3);
+    CHECK(store.remove(entity5.id()));
+    // The failed modifications are not logged
+    CHECK_FALSE(store.insert(entity1.id(), entity1.properties()));
+    CHECK_FALSE(store.remove(entity5.id()));
+    CHECK(numberOfRecords() == 5);
+
+    // The whole change set of a child store is logged as a single record
+    auto child = store.createChild();
+    child.insert(entity6.id(), entity6.properties());
+    child.update(entity2.id(), entity3.properties());
+    child.remove(entity3.id());
+    child.remove(entity4.id());
+    child.insert(entity4.id(), entity1.properties());
+    child.commit();
+    CHECK(numberOfRecords() == 6);
+  }
+
+  const auto checkEntities = [](const Store &store) {
+    CHECK_FALSE(store.contains(entity3.id()));
+    CHECK_FALSE(store.contains(entity5.id()));
+    CHECK(std::string_view{store.get(entity1.id()).get<PropertyId::CStyledString>()} == "C string");
+    CHECK(store.get(entity2.id()) == entity3.properties());
+    CHECK(store.get(entity4.id()) == entity1.properties());
+    CHECK(store.get(entity6.id()) == entity6.properties());
+  };
+
+  {
+    Store store = Store::open(snapshotPath, logPath);
+    checkEntities(store);
+    CHECK(store.checkpoint());
+    CHECK(std::filesystem::file_size(logPath) == 0U);
+    CHECK(store.remove(entity6.id()));
+  }
+
+  {
+    // The log is replayed on top of the snapshot
+    Store store = Store::open(snapshotPath, logPath);
+    CHECK_FALSE(store.contains(entity6.id()));
+    CHECK(store.insert(entity6.id(), entity6.properties()));
+    CHECK(store.insert(entity5.id(), entity5.properties()));
+  }
+
+  // A torn record at the end of the log is dropped, but the records before it are kept
+  std::filesystem::resize_file(logPath, std::filesystem::file_size(logPath) - 1);
+  {
+    Store store = Store::open(snapshotPath, logPath);
+    checkEntities(store);
+    CHECK(store.insert(entity3.id(), entity3.properties()));
+  }
+  {
+    Store store = Store::open(snapshotPath, logPath);
+    CHECK(store.contains(entity3.id()));
+    CHECK_FALSE(store.contains(entity5.id()));
+  }
+
+  SECTION("Group commit") {
+    std::filesystem::remove(logPath);
+    Store store = Store::open(snapshotPath, logPath, EntityStore::WriteAheadLogOptions{3U});
+    CHECK(store.insert(entity5.id(), entity5.properties()));
+    CHECK(store.remove(entity6.id()));
+    CHECK(std::filesystem::file_size(logPath) == 0U);
+    CHECK(store.remove(entity5.id()));
+    CHECK(numberOfRecords() == 3);
+    CHECK(store.remove(entity4.id()));
+    CHECK(numberOfRecords() == 3);
+    CHECK(store.syncWriteAheadLog());
+    CHECK(numberOfRecords() == 4);
+  }
+
+  SECTION("Failed logging") {
+    // Every write to /dev/full fails, so the record of the first modification cannot be synced
+    const std::filesystem::path fullDevicePath{"/dev/full"};
+    if (std::filesystem::exists(fullDevicePath)) {
+      EntityStore::LoggingStore store{EntityStore::RootStore{}, snapshotPath, fullDevicePath, {}, 0U};
+      CHECK_THROWS_AS(store.insert(entity1.id(), entity1.properties()), std::system_error);
+      // The modification was applied before it was logged, but the following ones are rejected
+      CHECK(store.contains(entity1.id()));
+      CHECK_THROWS_AS(store.insert(entity2.id(), entity2.properties()), std::logic_error);
+      CHECK_THROWS_AS(store.remove(entity1.id()), std::logic_error);
+      CHECK_FALSE(store.contains(entity2.id()));
+      CHECK(store.contains(entity1.id()));
+    }
+  }
+
+  SECTION("Not opened store") {
+    Store store = Store::create();
+    CHECK_FALSE(store.checkpoint());
+    CHECK_FALSE(store.syncWriteAheadLog());
+  }
+
+  std::filesystem::remove(snapshotPath);
+  std::filesystem::remove(logPath);
+}
+
+TEST_CASE("ConcurrentStore") {
+  Store store = Store::createConcurrent();
+  store.insert(entity1.id(), entity1.properties());
+  store.insert(entity2.id(), entity2.properties());
+  store.commit();
+
+  SECTION("Snapshots see the committed state") {
+    store.update(entity1.id(), entity3.properties());
+    store.remove(entity2.id());
+    store.insert(entity4.id(), entity4.properties());
+    CHECK(store.get(entity1.id()) == entity3.properties());
+    {
+      const auto snapshot = store.readSnapshot();
+      CHECK(snapshot.get(entity1.id()) == entity1.properties());
+      CHECK(snapshot.contains(entity2.id()));
+      CHECK_FALSE(snapshot.contains(entity4.id()));
+      CHECK(snapshot.query<PropertyId::Title>("The 1 Entity") == EntityStore::EntityIdSet{entity1.id()});
+    }
+    store.commit();
+    const auto snapshot = store.readSnapshot();
+    CHECK(snapshot.get(entity1.id()) == entity3.properties());
+    CHECK_FALSE(snapshot.contains(entity2.id()));
+    CHECK(snapshot.contains(entity4.id()));
+  }
+
+  SECTION("Rollback") {
+    store.remove(entity1.id());
+    store.rollback();
+    CHECK(store.contains(entity1.id()));
+    store.commit();
+    CHECK(store.readSnapshot().contains(entity1.id()));
+  }
+
+  SECTION("Child stores") {
+    auto child = store.createChild();
+    child.remove(entity1.id());
+    child.insert(entity3.id(), entity3.properties());
+    child.commit();
+    CHECK(store.readSnapshot().contains(entity1.id()));
+    store.commit();
+    const auto snapshot = store.readSnapshot();
+    CHECK_FALSE(snapshot.contains(entity1.id()));
+    CHECK(snapshot.contains(entity3.id()));
+  }
+
+  SECTION("Snapshots of the writer thread") {
+    // The commit would wait forever for the snapshot of the committing thread
+    auto snapshot = store.readSnapshot();
+    store.remove(entity1.id());
+    CHECK_THROWS_AS(store.commit(), std::logic_error);
+    CHECK(snapshot.contains(entity1.id()));
+    // The snapshot can be destroyed by another thread
+    std::thread([destroyedSnapshot = std::move(snapshot)] { CHECK(destroyedSnapshot.contains(entity1.id())); }).join();
+    store.commit();
+    CHECK_FALSE(store.readSnapshot().contains(entity1.id()));
+
+    // The snapshots that were created by other threads are waited for
+    std::atomic<bool> isSnapshotCreated{false};
+    std::atomic<bool> isCommitStarted{false};
+    std::thread reader([&store, &isSnapshotCreated, &isCommitStarted] {
+      const auto readerSnapshot = store.readSnapshot();
+      isSnapshotCreated.store(true);
+      while (!isCommitStarted.load()) {
+        std::this_thread::yield();
+      }
+    });
+    while (!isSnapshotCreated.load()) {
+      std::this_thread::yield();
+    }
+    store.insert(entity1.id(), entity1.properties());
+    isCommitStarted.store(true);
+    store.commit();
+    reader.join();
+    CHECK(store.readSnapshot().contains(entity1.id()));
+  }
+
+  SECTION("Snapshots are read only") {
+    auto snapshot = store.readSnapshot();
+    CHECK_THROWS_AS(snapshot.insert(entity3.id(), entity3.properties()), std::logic_error);
+    CHECK_THROWS_AS(Store::create().readSnapshot(), std::logic_error);
+  }
+
+  SECTION("Readers and a writer") {
+    // Every commit inserts a pair of entities, so a consistent snapshot always contains both or neither of them.
+    constexpr EntityId numberOfCommits = 200;
+    constexpr size_t numberOfReaders = 4U;
+    std::atomic<bool> isWriterFinished{false};
+    std::atomic<size_t> numberOfInconsistentReads{0U};
+    std::vector<std::thread> readers;
+    for (size_t readerIndex{0U}; readerIndex < numberOfReaders; ++readerIndex) {
+      readers.emplace_back([&store, &isWriterFinished, &numberOfInconsistentReads]() {
+        while (!isWriterFinished.load()) {
+          const auto snapshot = store.readSnapshot();
+          const auto ids = snapshot.rangeQuery<PropertyId::Timestamp>(0.0, static_cast<double>(numberOfCommits));
+          for (const auto id: ids) {
+            if (!snapshot.contains(id ^ 1)) {
+              ++numberOfInconsistentReads;
+            }
+          }
+        }
+      });
+    }
+    for (EntityId commitIndex{0}; commitIndex < numberOfCommits; ++commitIndex) {
+      const auto timestamp = static_cast<double>(commitIndex);
+      store.insert(100 + 2 * commitIndex, Properties().set<PropertyId::Timestamp>(timestamp));
+      store.insert(100 + 2 * commitIndex + 1, Properties().set<PropertyId::Timestamp>(timestamp));
+      store.commit();
+    }
+    isWriterFinished.store(true);
+    for (auto &reader: readers) {
+      reader.join();
+    }
+    CHECK(numberOfInconsistentReads.load() == 0U);
+    CHECK(store.readSnapshot().rangeQuery<PropertyId::Timestamp>(0.0, static_cast<double>(numberOfCommits)).size() ==
+          2 * numberOfCommits);
+  }
+}
+
+TEST_CASE("OptimisticTransactions") {
+  Store store = Store::createTransactional();
+  store.insert(entity1.id(), entity1.properties());
+  store.insert(entity2.id(), entity2.properties());
+
+  SECTION("First committer wins") {
+    auto first = store.createChild();
+    auto second = store.createChild();
+    first.update(entity1.id(), entity3.properties());
+    CHECK(second.get(entity1.id()) == entity1.properties());
+    second.remove(entity1.id());
+    first.commit();
+    CHECK(store.get(entity1.id()) == entity3.properties());
+    CHECK_THROWS_AS(second.commit(), EntityStore::TransactionConflictException);
+    // The failed transaction is rolled back, so it can be retried
+    CHECK(second.get(entity1.id()) == entity3.properties());
+    CHECK(second.remove(entity1.id()));
+    second.commit();
+    CHECK_FALSE(store.contains(entity1.id()));
+  }
+
+  SECTION("Reads are validated") {
+    auto first = store.createChild();
+    auto second = store.createChild();
+    // The second transaction decides based on an entity that is changed by the first one
+    CHECK(second.contains(entity2.id()));
+    second.insert(entity3.id(), entity3.properties());
+    CHECK(first.remove(entity2.id()));
+    first.commit();
+    CHECK_THROWS_AS(second.commit(), EntityStore::TransactionConflictException);
+    CHECK_FALSE(store.contains(entity3.id()));
+  }
+
+  SECTION("Concurrent inserts of the same entity") {
+    auto first = store.createChild();
+    auto second = store.createChild();
+    first.insert(entity3.id(), entity3.properties());
+    second.insert(entity3.id(), entity4.properties());
+    second.commit();
+    CHECK_THROWS_AS(first.commit(), EntityStore::TransactionConflictException);
+    CHECK(store.get(entity3.id()) == entity4.properties());
+  }
+
+  SECTION("Not conflicting transactions") {
+    auto first = store.createChild();
+    auto second = store.createChild();
+    first.update(entity1.id(), entity3.properties());
+    CHECK(second.query<PropertyId::Title>("The 2 Entity") == EntityStore::EntityIdSet{entity2.id()});
+    second.update(entity2.id(), entity4.properties());
+    first.commit();
+    second.commit();
+    CHECK(store.get(entity1.id()) == entity3.properties());
+    CHECK(store.get(entity2.id()) == entity4.properties());
+  }
+
+  SECTION("Parallel workers") {
+    // Every worker increments the same counter, so the conflicting increments have to be retried. If no increment is
+    // lost, then the validation works.
+    constexpr EntityId counterId = 100;
+    constexpr size_t numberOfWorkers = 4U;
+    constexpr size_t numberOfIncrements = 100U;
+    store.insert(counterId, Properties().set<PropertyId::Timestamp>(0.0));
+    std::vector<std::thread> workers;
+    for (size_t workerIndex{0U}; workerIndex < numberOfWorkers; ++workerIndex) {
+      workers.emplace_back([&store]() {
+        auto transaction = store.createChild();
+        for (size_t increment{0U}; increment < numberOfIncrements; ++increment) {
+          while (true) {
+            const auto counter = transaction.get(counterId).get<PropertyId::Timestamp>();
+            transaction.update(counterId, Properties().set<PropertyId::Timestamp>(counter + 1.0));
+            try {
+              transaction.commit();
+              break;
+            } catch (const EntityStore::TransactionConflictException &) {
+              std::this_thread::yield();
+            }
+          }
+        }
+      });
+    }
+    for (auto &worker: workers) {
+      worker.join();
+    }
+    CHECK(store.get(counterId).get<PropertyId::Timestamp>() ==
+          static_cast<double>(numberOfWorkers * numberOfIncrements));
+  }
+
+  SECTION("Versions of a long-lived transaction") {
+    // The reader lives as long as the writer, but it restarts after every commit of the writer, so the versions of the
+    // entities modified before its restart are not needed anymore.
+    EntityStore::OptimisticStore optimisticStore;
+    auto reader = optimisticStore.beginTransaction();
+    auto writer = optimisticStore.beginTransaction();
+    for (EntityId id{1}; id <= 1000; ++id) {
+      writer->insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+      writer->commit();
+      CHECK(optimisticStore.numberOfTrackedEntities() == 1U);
+      CHECK(reader->get(id).get<PropertyId::Timestamp>() == static_cast<double>(id));
+      reader->rollback();
+      CHECK(optimisticStore.numberOfTrackedEntities() == 0U);
+    }
+
+    // The versions newer than the start of the reader are still needed to detect the conflicts
+    CHECK(reader->contains(1));
+    writer->remove(1);
+    writer->commit();
+    reader->insert(1001, Properties().set<PropertyId::Timestamp>(1001.0));
+    CHECK_THROWS_AS(reader->commit(), EntityStore::TransactionConflictException);
+    CHECK(optimisticStore.numberOfTrackedEntities() == 0U);
+  }
+
+  SECTION("Aggregations during commits") {
+    // The writer removes and inserts a group of entities in alternating transactions, so the aggregations have to see
+    // either every entity of the group or none of them. The aggregated entities must not be removed during the scans.
+    constexpr EntityId firstGroupId = 100;
+    constexpr EntityId groupSize = 200;
+    constexpr size_t numberOfRounds = 50U;
+    const auto baseCount = store.count<PropertyId::Title>();
+    const auto insertGroup = [](Store &target) {
+      for (EntityId id{firstGroupId}; id < firstGroupId + groupSize; ++id) {
+        target.insert(id, Properties().set<PropertyId::Title>("Group").set<PropertyId::Timestamp>(1.0));
+      }
+    };
+    insertGroup(store);
+
+    std::atomic<bool> isWriterDone{false};
+    std::thread writer([&store, &insertGroup, &isWriterDone]() {
+      auto transaction = store.createChild();
+      for (size_t round{0U}; round < numberOfRounds; ++round) {
+        for (EntityId id{firstGroupId}; id < firstGroupId + groupSize; ++id) {
+          transaction.remove(id);
+        }
+        transaction.commit();
+        insertGroup(transaction);
+        transaction.commit();
+      }
+      isWriterDone = true;
+    });
+
+    const auto isConsistent = [baseCount](const size_t count) {
+      return count == baseCount || count == baseCount + groupSize;
+    };
+    std::vector<std::thread> readers;
+    std::atomic<size_t> numberOfInconsistentResults{0U};
+    for (size_t readerIndex{0U}; readerIndex < 2U; ++readerIndex) {
+      readers.emplace_back([&store, &isWriterDone, &isConsistent, &numberOfInconsistentResults]() {
+        auto transaction = store.createChild();
+        while (!isWriterDone) {
+          const auto count = store.count<PropertyId::Title>();
+          const auto groupQuery = EntityStore::Query::equal<PropertyId::Title>("Group");
+          const auto sum = store.sum<PropertyId::Timestamp>(groupQuery);
+          const auto ordered =
+              store.orderBy<PropertyId::Timestamp>(EntityStore::SortOrder::Ascending, groupSize, groupQuery);
+          const auto countInTransaction = transaction.count<PropertyId::Title>();
+          transaction.rollback();
+          if (!isConsistent(count) || (sum != 0.0 && sum != static_cast<double>(groupSize)) ||
+              (!ordered.empty() && ordered.size() != groupSize) || !isConsistent(countInTransaction)) {
+            ++numberOfInconsistentResults;
+          }
+        }
+      });
+    }
+    writer.join();
+    for (auto &reader: readers) {
+      reader.join();
+    }
+    CHECK(numberOfInconsistentResults == 0U);
+    CHECK(store.count<PropertyId::Title>() == baseCount + groupSize);
+  }
+}
+
+TEST_CASE("DeeplyNestedReads") {
+  constexpr EntityId numberOfEntities = 1000;
+  constexpr EntityId numberOfLevels = 8;
+  Store store = Store::create();
+  std::map<EntityId, double> expectedTimestamps;
+  for (EntityId id{1}; id <= numberOfEntities; ++id) {
+    store.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+    expectedTimestamps[id] = static_cast<double>(id);
+  }
+
+  // Every level touches a different set of entities, and it also reinserts some of the entities that were removed by
+  // the previous levels, so the reads have to find the right level.
+  std::vector<Store> levels;
+  levels.reserve(numberOfLevels);
+  for (EntityId level{0}; level < numberOfLevels; ++level) {
+    auto &parent = levels.empty() ? store : levels.back();
+    auto &child = levels.emplace_back(parent.createChild());
+    for (auto id = level + 1; id <= numberOfEntities; id += numberOfLevels) {
+      if (id % 3 == 0) {
+        CHECK(child.remove(id));
+        expectedTimestamps.erase(id);
+      } else {
+        const auto timestamp = static_cast<double>(id + (level + 1) * numberOfEntities);
+        CHECK(child.update(id, Properties().set<PropertyId::Timestamp>(timestamp)) != nullptr);
+        expectedTimestamps[id] = timestamp;
+      }
+    }
+    if (level > 0) {
+      // The entity is removed by the previous level.
+      auto removedId = level;
+      while (removedId % 3 != 0) {
+        removedId += numberOfLevels;
+      }
+      CHECK(child.insert(removedId, Properties().set<PropertyId::Timestamp>(-1.0)));
+      expectedTimestamps[removedId] = -1.0;
+    }
+  }
+
+  const auto checkReads = [&expectedTimestamps](const Store &leaf) {
+    for (EntityId id{1}; id <= numberOfEntities + 1; ++id) {
+      const auto it = expectedTimestamps.find(id);
+      const auto *properties = leaf.tryGet(id);
+      REQUIRE(leaf.contains(id) == (it != expectedTimestamps.end()));
+      REQUIRE((properties != nullptr) == (it != expectedTimestamps.end()));
+      if (properties != nullptr) {
+        CHECK(properties->get<PropertyId::Timestamp>() == it->second);
+      }
+    }
+  };
+  checkReads(levels.back());
+
+  // The modifications of the ancestors are visible even after the child was created. The entity 2 is touched only by
+  // the second level, so its modification by the third level is visible.
+  CHECK(levels[2].update(2, Properties().set<PropertyId::Timestamp>(-2.0)) != nullptr);
+  expectedTimestamps[2] = -2.0;
+  CHECK(store.insert(numberOfEntities + 1, Properties().set<PropertyId::Timestamp>(-3.0)));
+  expectedTimestamps[numberOfEntities + 1] = -3.0;
+  checkReads(levels.back());
+
+  while (!levels.empty()) {
+    levels.back().commit();
+    levels.pop_back();
+  }
+  checkReads(store);
+}
+
+TEST_CASE("NestedQueriesAfterModifications") {
+  // The touched ids of the child are maintained incrementally between the queries, so the queries are interleaved with
+  // every kind of modification, including the ones that make an entity untouched again.
+  constexpr EntityId numberOfEntities = 2000;
+  Store store = Store::create();
+  std::map<EntityId, std::string> expectedTitles;
+  for (EntityId id{1}; id <= numberOfEntities; ++id) {
+    store.insert(id, Properties().set<PropertyId::Title>("A"));
+    expectedTitles[id] = "A";
+  }
+  auto child = store.createChild();
+  const auto getExpectedIds = [&expectedTitles](const std::string &title) {
+    std::vector<EntityId> ids;
+    for (const auto &[id, expectedTitle]: expectedTitles) {
+      if (expectedTitle == title) {
+        ids.push_back(id);
+      }
+    }
+    return EntityStore::EntityIdSet::fromSorted(std::move(ids));
+  };
+
+  for (EntityId round{0}; round < 8; ++round) {
+    for (auto id = round + 1; id <= numberOfEntities + numberOfEntities / 2; id += 3) {
+      const auto title = round % 2 == 0 ? "B" : "A";
+      switch ((id + round) % 4) {
+      case 0:
+        CHECK(child.remove(id) == (expectedTitles.erase(id) == 1));
+        break;
+      case 1:
+        if (expectedTitles.contains(id)) {
+          CHECK(child.update(id, Properties().set<PropertyId::Title>(title)) != nullptr);
+          expectedTitles[id] = title;
+        }
+        break;
+      case 2:
+        CHECK(child.insert(id, Properties().set<PropertyId::Title>(title)) == expectedTitles.emplace(id, title).second);
+        break;
+      default:
+        // Inserting and removing a new entity leaves it untouched.
+        if (!expectedTitles.contains(id)) {
+          CHECK(child.insert(id, Properties().set<PropertyId::Title>(title)));
+          CHECK(child.remove(id));
+        }
+        break;
+      }
+    }
+    // The queries don't modify the child, so they can run concurrently even right after the modifications
+    std::vector<EntityStore::EntityIdSet> concurrentResults(4U);
+    std::vector<std::thread> readers;
+    for (auto &result: concurrentResults) {
+      readers.emplace_back([&child, &result]() { result = child.query<PropertyId::Title>("A"); });
+    }
+    for (auto &reader: readers) {
+      reader.join();
+    }
+    for (const auto &result: concurrentResults) {
+      CHECK(result == getExpectedIds("A"));
+    }
+    CHECK(child.query<PropertyId::Title>("B") == getExpectedIds("B"));
+  }
+
+  child.commit();
+  CHECK(store.query<PropertyId::Title>("A") == getExpectedIds("A"));
+  CHECK(store.query<PropertyId::Title>("B") == getExpectedIds("B"));
+}
+
+TEST_CASE("LargeCommit") {
+  // The parent applies the changes in a single pass, so the freed slots are reused by the insertions and the indices
+  // have to follow every kind of change.
+  constexpr EntityId numberOfEntities = 10000;
+  Store store = Store::create();
+  CHECK(store.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered));
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    store.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+  }
+
+  auto child = store.createChild();
+  for (EntityId id{0}; id < numberOfEntities; id += 2) {
+    CHECK(child.remove(id));
+  }
+  for (EntityId id{1}; id < numberOfEntities; id += 2) {
+    CHECK(child.update(id, Properties().set<PropertyId::Timestamp>(-1.0)) != nullptr);
+  }
+  for (EntityId id{0}; id < numberOfEntities; id += 4) {
+    CHECK(child.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id))));
+  }
+  for (auto id = numberOfEntities; id < 2 * numberOfEntities; ++id) {
+    CHECK(child.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id))));
+  }
+  child.commit();
+
+  std::vector<EntityId> expectedIds;
+  for (EntityId id{0}; id < 2 * numberOfEntities; ++id) {
+    if (id >= numberOfEntities || id % 4 == 0) {
+      expectedIds.push_back(id);
+    }
+  }
+  CHECK(store.rangeQuery<PropertyId::Timestamp>(0.0, 2.0 * numberOfEntities) ==
+        EntityStore::EntityIdSet::fromSorted(expectedIds));
+  CHECK(store.query<PropertyId::Timestamp>(-1.0).size() == numberOfEntities / 2);
+  CHECK_FALSE(store.contains(2));
+  CHECK(store.contains(4));
+}
+
+TEST_CASE("Compact") {
+  constexpr EntityId numberOfEntities = 10000;
+  const auto fill = [](auto &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      store.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+    }
+    for (EntityId id{0}; id < numberOfEntities; id += 3) {
+      CHECK(store.remove(id));
+    }
+  };
+  const auto checkEntities = [](const auto &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      REQUIRE(store.contains(id) == (id % 3 != 0));
+      if (id % 3 != 0) {
+        CHECK(store.get(id).template get<PropertyId::Timestamp>() == static_cast<double>(id));
+      }
+    }
+  };
+
+  SECTION("Root store") {
+    EntityStore::RootStore store;
+    fill(store);
+    const auto numberOfRemainingEntities = numberOfEntities - (numberOfEntities + 2) / 3;
+
+    // The smallest empty slot is reused first.
+    EntityStore::RootStore smallStore;
+    for (EntityId id{0}; id < 30; ++id) {
+      smallStore.insert(id, Properties());
+    }
+    CHECK(smallStore.remove(20));
+    CHECK(smallStore.remove(10));
+    CHECK(smallStore.insert(100, Properties()));
+    CHECK((*(smallStore.begin() + 10))->id() == 100);
+
+    size_t numberOfCalls{1U};
+    while (!store.compact(100U)) {
+      ++numberOfCalls;
+      checkEntities(store);
+    }
+    CHECK(numberOfCalls > 1U);
+    CHECK(static_cast<size_t>(std::distance(store.begin(), store.end())) == numberOfRemainingEntities);
+    CHECK(std::all_of(store.begin(), store.end(), [](const auto &entityHolder) { return entityHolder.has_value(); }));
+    checkEntities(store);
+    CHECK(store.compact(100U));
+  }
+
+  SECTION("Columnar store") {
+    auto store = Store::create(EntityStore::StoreBackend::Columnar);
+    fill(store);
+    size_t numberOfCalls{1U};
+    while (!store.compact(100U)) {
+      ++numberOfCalls;
+      checkEntities(store);
+    }
+    CHECK(numberOfCalls > 1U);
+    checkEntities(store);
+    CHECK(store.compact(100U));
+    CHECK(store.count<PropertyId::Timestamp>() ==
+          static_cast<size_t>(numberOfEntities - (numberOfEntities + 2) / 3));
+    // The compacted store can be modified as before
+    CHECK(store.insert(0, Properties().set<PropertyId::Timestamp>(0.0)));
+    CHECK(store.remove(1));
+    CHECK(store.get(0).get<PropertyId::Timestamp>() == 0.0);
+  }
+
+  SECTION("Concurrent store") {
+    auto store = Store::createConcurrent();
+    fill(store);
+    store.commit();
+    while (!store.compact(1000U)) {
+    }
+    store.commit();
+    checkEntities(store);
+    checkEntities(store.readSnapshot());
+  }
+}
+
+TEMPLATE_TEST_CASE("IdIndexPolicies", "", EntityStore::FlatIdIndex, EntityStore::NodeIdIndex) {
+  constexpr EntityId numberOfEntities = 10000;
+  EntityStore::BasicRootStore<TestType> store;
+  std::vector<Entity> entities;
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    entities.emplace_back(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(id)));
+  }
+  CHECK(store.insertBatch(std::span<const Entity>{entities}).count() == numberOfEntities);
+  CHECK_FALSE(store.insert(0, Properties()));
+  for (EntityId id{0}; id < numberOfEntities; id += 2) {
+    CHECK(store.remove(id));
+  }
+  CHECK(store.update(1, Properties().set<PropertyId::Timestamp>(-1.0)) != nullptr);
+  CHECK(store.update(0, Properties()) == nullptr);
+  store.shrink();
+
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    REQUIRE(store.contains(id) == (id % 2 == 1));
+  }
+  CHECK(store.get(1).template get<PropertyId::Timestamp>() == -1.0);
+  CHECK(store.get(3).template get<PropertyId::Timestamp>() == 3.0);
+  const auto negativeTimestamps = store.filterIdsInlined(
+      [](const EntityId, const Properties &properties) {
+        const auto *timestamp = properties.tryGet<PropertyId::Timestamp>();
+        return timestamp != nullptr && *timestamp < 0.0;
+      },
+      nullptr);
+  CHECK(negativeTimestamps == EntityStore::EntityIdSet::fromUnsorted({1}));
+  CHECK((store.asRootStore() != nullptr) == std::is_same_v<TestType, EntityStore::FlatIdIndex>);
+}
+
+TEST_CASE("ChildStoreReset") {
+  // The states of the child are released at once by every commit and rollback, the child has to work as a new one after
+  // them.
+  constexpr EntityId numberOfEntities = 10000;
+  Store store = Store::create();
+  for (EntityId id{0}; id < numberOfEntities; id += 2) {
+    store.insert(id, Properties());
+  }
+
+  auto child = store.createChild();
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    if (id % 2 == 0) {
+      CHECK(child.remove(id));
+    } else {
+      CHECK(child.insert(id, Properties()));
+    }
+  }
+  child.rollback();
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    REQUIRE(child.contains(id) == (id % 2 == 0));
+  }
+
+  auto movedChild = std::move(child);
+  for (EntityId id{1}; id < numberOfEntities; id += 2) {
+    CHECK(movedChild.insert(id, Properties()));
+  }
+  movedChild.commit();
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    REQUIRE(store.contains(id));
+  }
+  CHECK(movedChild.remove(0));
+  movedChild.rollback();
+  CHECK(movedChild.contains(0));
+}
+
+class ThrowingBatchStore : public EntityStore::RootStore {
+public:
+  EntityStore::BatchResult insertBatch(std::span<const Entity> /*entities*/) override {
+    throw std::runtime_error("The batch failed");
+  }
+};
+
+TEST_CASE("ChangeStream") {
+  using EntityStore::ChangeEvent;
+  using EntityStore::ChangeType;
+  using Mask = ChangeEvent::PropertyMask;
+  const auto maskOf = [](std::initializer_list<PropertyId> propertyIds) {
+    Mask mask;
+    for (const auto propertyId: propertyIds) {
+      mask.set(EntityStore::asUnderlying(propertyId));
+    }
+    return mask;
+  };
+
+  Store store = Store::create();
+  store.insert(1, Properties());
+  auto subscription = store.subscribe(16);
+  CHECK(subscription->capacity() == 16U);
+  std::vector<ChangeEvent> events;
+
+  SECTION("Single modifications") {
+    CHECK(store.insert(2, Properties().set<PropertyId::Title>("Title").set<PropertyId::Timestamp>(2.0)));
+    CHECK_FALSE(store.insert(2, Properties()));
+    CHECK(store.update(1, Properties().set<PropertyId::Description>("Description")) != nullptr);
+    CHECK(store.update(3, Properties()) == nullptr);
+    CHECK(store.remove(1));
+    CHECK_FALSE(store.remove(1));
+
+    CHECK(subscription->drain(events) == 3U);
+    CHECK(events == std::vector<ChangeEvent>{
+                        {ChangeType::Inserted, 2, maskOf({PropertyId::Title, PropertyId::Timestamp})},
+                        {ChangeType::Updated, 1, maskOf({PropertyId::Description})},
+                        {ChangeType::Removed, 1, Mask{}},
+                    });
+    CHECK(subscription->drain(events) == 0U);
+    CHECK_FALSE(subscription->checkAndClearOverflow());
+  }
+
+  SECTION("Batches") {
+    std::vector<Entity> entities{Entity{1, Properties()}, Entity{2, Properties().set<PropertyId::Timestamp>(2.0)}};
+    CHECK(store.insertBatch(std::move(entities)).count() == 1U);
+    const std::array<EntityId, 3> ids{1, 2, 3};
+    CHECK(store.removeBatch(ids).count() == 2U);
+
+    CHECK(subscription->drain(events, 2U) == 2U);
+    CHECK(subscription->drain(events) == 1U);
+    CHECK(events == std::vector<ChangeEvent>{
+                        {ChangeType::Inserted, 2, maskOf({PropertyId::Timestamp})},
+                        {ChangeType::Removed, 1, Mask{}},
+                        {ChangeType::Removed, 2, Mask{}},
+                    });
+  }
+
+  SECTION("Child stores") {
+    auto child = store.createChild();
+    CHECK_THROWS_AS(child.subscribe(16), std::logic_error);
+    CHECK(child.remove(1));
+    CHECK(child.insert(1, Properties().set<PropertyId::Title>("Reinserted")));
+    CHECK(child.insert(2, Properties()));
+    CHECK(subscription->drain(events) == 0U);
+    child.commit();
+    CHECK(subscription->drain(events) == 3U);
+    CHECK(events == std::vector<ChangeEvent>{
+                        {ChangeType::Removed, 1, Mask{}},
+                        {ChangeType::Inserted, 1, maskOf({PropertyId::Title})},
+                        {ChangeType::Inserted, 2, Mask{}},
+                    });
+
+    CHECK(child.update(2, Properties().set<PropertyId::Timestamp>(1.0)) != nullptr);
+    child.rollback();
+    CHECK(subscription->drain(events) == 0U);
+  }
+
+  SECTION("Throwing batch") {
+    // The events of a batch that throws are dropped, so the next modification doesn't publish them
+    EntityStore::ObservedStore observedStore(std::make_unique<ThrowingBatchStore>(), false);
+    auto throwingSubscription = observedStore.subscribe(16);
+    const std::array<Entity, 2> batch{Entity{1, Properties()}, Entity{2, Properties()}};
+    CHECK_THROWS_AS(observedStore.insertBatch(std::span<const Entity>{batch}), std::runtime_error);
+    CHECK(throwingSubscription->drain(events) == 0U);
+    CHECK(observedStore.insert(3, Properties()));
+    CHECK(throwingSubscription->drain(events) == 1U);
+    CHECK(events == std::vector<ChangeEvent>{{ChangeType::Inserted, 3, Mask{}}});
+  }
+
+  SECTION("Concurrent store") {
+    // The modifications of a concurrent store are visible only after they are committed, so are their events
+    Store concurrentStore = Store::createConcurrent();
+    auto concurrentSubscription = concurrentStore.subscribe(16);
+    CHECK(concurrentStore.insert(1, Properties()));
+    concurrentStore.rollback();
+    CHECK_FALSE(concurrentStore.contains(1));
+    CHECK(concurrentSubscription->drain(events) == 0U);
+
+    CHECK(concurrentStore.insert(2, Properties().set<PropertyId::Timestamp>(2.0)));
+    CHECK(concurrentStore.remove(2));
+    CHECK(concurrentStore.insert(3, Properties()));
+    CHECK(concurrentSubscription->drain(events) == 0U);
+    concurrentStore.commit();
+    CHECK(concurrentSubscription->drain(events) == 3U);
+    CHECK(events == std::vector<ChangeEvent>{
+                        {ChangeType::Inserted, 2, maskOf({PropertyId::Timestamp})},
+                        {ChangeType::Removed, 2, Mask{}},
+                        {ChangeType::Inserted, 3, Mask{}},
+                    });
+    concurrentStore.commit();
+    CHECK(concurrentSubscription->drain(events) == 0U);
+  }
+
+  SECTION("Overflow") {
+    for (EntityId id{10}; id < 30; ++id) {
+      store.insert(id, Properties());
+    }
+    CHECK(subscription->checkAndClearOverflow());
+    CHECK_FALSE(subscription->checkAndClearOverflow());
+    CHECK(subscription->drain(events) == 16U);
+    CHECK(events.back().id == 25);
+    CHECK(store.remove(10));
+    CHECK(subscription->drain(events) == 1U);
+    CHECK(events.back() == ChangeEvent{ChangeType::Removed, 10, Mask{}});
+  }
+
+  SECTION("Concurrent consumer") {
+    // The producer waits for the consumer to avoid the overflow, so the positions of the buffer wrap around many times.
+    constexpr size_t numberOfEntities = 10000;
+    std::atomic<size_t> numberOfDrainedEvents{0U};
+    std::thread consumer([&subscription, &events, &numberOfDrainedEvents] {
+      while (events.size() < numberOfEntities) {
+        if (subscription->drain(events) == 0U) {
+          std::this_thread::yield();
+        }
+        numberOfDrainedEvents.store(events.size());
+      }
+    });
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      while (id - numberOfDrainedEvents.load() >= subscription->capacity()) {
+        std::this_thread::yield();
+      }
+      store.insert(100 + id, Properties());
+    }
+    consumer.join();
+    CHECK_FALSE(subscription->checkAndClearOverflow());
+    for (EntityId index{0}; index < numberOfEntities; ++index) {
+      REQUIRE(events[index].id == 100 + index);
+    }
+  }
+
+  subscription.reset();
+  CHECK(store.insert(1'000'000, Properties()));
+}
+
+TEST_CASE("Aggregations") {
+  using Query = EntityStore::Query;
+  constexpr EntityId numberOfEntities = 1000;
+  constexpr size_t minChunkSize = 64;
+  const EntityStore::QueryExecutor executor(4U, minChunkSize);
+  const std::vector<double> bounds{0.0, 10.0, 50.0, 90.0};
+
+  // The results of the temporary aggregators are returned by value, so they can be iterated without dangling
+  static_assert(std::is_same_v<decltype(EntityStore::MinAggregator<double>{}.result()), std::optional<double>>);
+  static_assert(
+      std::is_same_v<decltype(EntityStore::HistogramAggregator<double>{bounds}.result()), std::vector<size_t>>);
+  using TimestampOrder = EntityStore::OrderByAggregator<PropertyId::Timestamp>;
+  static_assert(std::is_same_v<decltype(TimestampOrder{1U, EntityStore::SortOrder::Ascending}.result()),
+                               std::vector<TimestampOrder::Key>>);
+
+  const auto fillStore = [](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      auto properties = Properties().set<PropertyId::Title>("Title " + std::to_string(id % 5));
+      if (id % 4 != 0) {
+        properties.set<PropertyId::Timestamp>(static_cast<double>(id % 100));
+      }
+      store.insert(id, std::move(properties));
+    }
+  };
+
+  // The expected results are computed by filtering the ids, then looking up the entities one by one
+  const auto checkAggregations = [&](const Store &store, const Query &query, const EntityStore::QueryOptions &options) {
+    size_t expectedCount{0U};
+    std::optional<double> expectedMin;
+    std::optional<double> expectedMax;
+    double expectedSum{0.0};
+    std::vector<size_t> expectedHistogram(bounds.size() - 1U, 0U);
+    for (const auto id: store.filter(query)) {
+      const auto *timestamp = store.get(id).tryGet<PropertyId::Timestamp>();
+      if (timestamp == nullptr) {
+        continue;
+      }
+      ++expectedCount;
+      expectedMin = std::min(expectedMin.value_or(*timestamp), *timestamp);
+      expectedMax = std::max(expectedMax.value_or(*timestamp), *timestamp);
+      expectedSum += *timestamp;
+      for (size_t bucket{0U}; bucket + 1U < bounds.size(); ++bucket) {
+        if (*timestamp >= bounds[bucket] && *timestamp < bounds[bucket + 1U]) {
+          ++expectedHistogram[bucket];
+        }
+      }
+    }
+    CHECK(store.count<PropertyId::Timestamp>(query, options) == expectedCount);
+    CHECK(store.min<PropertyId::Timestamp>(query, options) == expectedMin);
+    CHECK(store.max<PropertyId::Timestamp>(query, options) == expectedMax);
+    CHECK(store.sum<PropertyId::Timestamp>(query, options) == expectedSum);
+    CHECK(store.histogram<PropertyId::Timestamp>(bounds, query, options) == expectedHistogram);
+  };
+
+  const std::vector<Query> queries{
+      Query::allOf({}),
+      Query::anyOf({}),
+      Query::equal<PropertyId::Title>("Title 1"),
+      Query::equal<PropertyId::Title>("Title 1") && Query::inRange<PropertyId::Timestamp>(10, 60),
+      !Query::equal<PropertyId::Title>("Title 2"),
+  };
+  const auto checkStore = [&](const Store &store) {
+    for (const auto &query: queries) {
+      checkAggregations(store, query, EntityStore::QueryOptions::sequential());
+      checkAggregations(store, query, EntityStore::QueryOptions::parallel(executor));
+    }
+  };
+
+  Store notIndexed = Store::create();
+  Store indexed = Store::create();
+  Store columnar = Store::create(EntityStore::StoreBackend::Columnar);
+  // The transactional store doesn't have inlined aggregate functions, so it is aggregated through IStore::aggregate
+  Store transactional = Store::createTransactional();
+  indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+  indexed.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  transactional.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (auto *store: {&notIndexed, &indexed, &columnar, &transactional}) {
+    fillStore(*store);
+    checkStore(*store);
+    CHECK(store->count<PropertyId::Title>() == numberOfEntities);
+    CHECK(store->count<PropertyId::Description>() == 0U);
+    CHECK_FALSE(store->min<PropertyId::Description>().has_value());
+    CHECK(store->max<PropertyId::Title>() == "Title 4");
+
+    auto child = store->createChild();
+    child.remove(11);
+    child.update(12, Properties().set<PropertyId::Title>("Title 1").set<PropertyId::Timestamp>(-5));
+    child.update(13, Properties().set<PropertyId::Title>("Title 1"));
+    child.insert(numberOfEntities, Properties().set<PropertyId::Title>("Title 1").set<PropertyId::Timestamp>(500));
+    checkStore(child);
+    CHECK(child.min<PropertyId::Timestamp>() == -5.0);
+    CHECK(child.max<PropertyId::Timestamp>(Query::equal<PropertyId::Title>("Title 1")) == 500.0);
+
+    auto grandChild = child.createChild();
+    grandChild.remove(12);
+    grandChild.update(14, Properties().set<PropertyId::Timestamp>(1000));
+    checkStore(grandChild);
+    CHECK(grandChild.min<PropertyId::Timestamp>() == 1.0);
+  }
+
+  CHECK_THROWS_AS(notIndexed.histogram<PropertyId::Timestamp>({1.0}), EntityStore::InvalidRangeException);
+  CHECK_THROWS_AS(notIndexed.histogram<PropertyId::Timestamp>({1.0, 2.0, 2.0}), EntityStore::InvalidRangeException);
+}
+
+TEST_CASE("OrderByAndCursors") {
+  using Query = EntityStore::Query;
+  using SortOrder = EntityStore::SortOrder;
+  constexpr EntityId numberOfEntities = 500;
+  constexpr size_t minChunkSize = 64;
+  const EntityStore::QueryExecutor executor(4U, minChunkSize);
+
+  const auto fillStore = [](Store &store) {
+    for (EntityId id{0}; id < numberOfEntities; ++id) {
+      auto properties = Properties().set<PropertyId::Title>("Title " + std::to_string(id % 3));
+      if (id % 5 != 0) {
+        properties.set<PropertyId::Timestamp>(static_cast<double>((id * 7) % 50));
+      }
+      store.insert(id, std::move(properties));
+    }
+  };
+
+  // The expected orders are computed by sorting the result of filter
+  const auto expectedOrder = [](const Store &store, const Query &query, const SortOrder order) {
+    std::vector<std::pair<double, EntityId>> keys;
+    for (const auto id: store.filter(query)) {
+      const auto *timestamp = store.get(id).tryGet<PropertyId::Timestamp>();
+      if (timestamp != nullptr) {
+        keys.emplace_back(*timestamp, id);
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    if (order == SortOrder::Descending) {
+      std::reverse(keys.begin(), keys.end());
+    }
+    std::vector<EntityId> ids;
+    std::transform(keys.begin(), keys.end(), std::back_inserter(ids), [](const auto &key) { return key.second; });
+    return ids;
+  };
+
+  const auto collect = [](auto cursor) {
+    std::vector<EntityId> ids;
+    for (auto batch = cursor.next(); !batch.empty(); batch = cursor.next()) {
+      CHECK(batch.size() <= 7U);
+      ids.insert(ids.end(), batch.begin(), batch.end());
+    }
+    CHECK(cursor.isFinished());
+    CHECK(cursor.next().empty());
+    return ids;
+  };
+
+  const std::vector<Query> queries{
+      Query::allOf({}),
+      Query::anyOf({}),
+      Query::equal<PropertyId::Title>("Title 1"),
+      Query::inRange<PropertyId::Timestamp>(10, 30),
+      !Query::equal<PropertyId::Title>("Title 2"),
+  };
+  const auto checkStore = [&](const Store &store) {
+    for (const auto &query: queries) {
+      for (const auto &options:
+           {EntityStore::QueryOptions::sequential(), EntityStore::QueryOptions::parallel(executor)}) {
+        for (const auto order: {SortOrder::Ascending, SortOrder::Descending}) {
+          const auto expected = expectedOrder(store, query, order);
+          const auto top = store.orderBy<PropertyId::Timestamp>(order, 20U, query, options);
+          const auto topSize = static_cast<ptrdiff_t>(std::min(expected.size(), size_t{20U}));
+          CHECK(top == std::vector<EntityId>(expected.begin(), expected.begin() + topSize));
+          CHECK(collect(store.orderedCursor<PropertyId::Timestamp>(order, 7U, query, options)) == expected);
+        }
+        CHECK(collect(store.cursor(7U, query, options)) == store.filter(query).ids());
+      }
+    }
+  };
+
+  Store notIndexed = Store::create();
+  Store indexed = Store::create();
+  Store columnar = Store::create(EntityStore::StoreBackend::Columnar);
+  // The transactional store doesn't have inlined aggregate functions, so it is aggregated through IStore::aggregate
+  Store transactional = Store::createTransactional();
+  indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+  indexed.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  transactional.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (auto *store: {&notIndexed, &indexed, &columnar, &transactional}) {
+    fillStore(*store);
+    checkStore(*store);
+    CHECK(store->orderBy<PropertyId::Timestamp>(SortOrder::Ascending, 0U).empty());
+    CHECK(store->cursor(0U).next().empty());
+    CHECK(store->orderBy<PropertyId::Title>(SortOrder::Descending, 2U) == std::vector<EntityId>{497, 494});
+
+    auto child = store->createChild();
+    child.remove(1);
+    child.update(2, Properties().set<PropertyId::Timestamp>(-1));
+    child.insert(numberOfEntities, Properties().set<PropertyId::Timestamp>(100));
+    checkStore(child);
+    CHECK(child.orderBy<PropertyId::Timestamp>(SortOrder::Ascending, 1U) == std::vector<EntityId>{2});
+
+    auto grandChild = child.createChild();
+    grandChild.remove(2);
+    grandChild.update(numberOfEntities, Properties().set<PropertyId::Timestamp>(-2));
+    checkStore(grandChild);
+    CHECK(grandChild.orderBy<PropertyId::Timestamp>(SortOrder::Descending, 1U) == std::vector<EntityId>{457});
+  }
+
+  // The modifications between two batches are visible to the following batches
+  auto cursor = notIndexed.cursor(10U);
+  CHECK(cursor.next() == std::vector<EntityId>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  notIndexed.remove(10);
+  notIndexed.insert(-1, Properties());
+  CHECK(cursor.next() == std::vector<EntityId>{11, 12, 13, 14, 15, 16, 17, 18, 19, 20});
+  notIndexed.remove(21);
+  notIndexed.remove(25);
+  CHECK(cursor.next() == std::vector<EntityId>{22, 23, 24, 26, 27, 28, 29, 30, 31, 32});
+
+  // Every batch of an ordered cursor walks the ordered index from the last returned entity, so walking the cursor to
+  // the end visits every entity only once instead of scanning the store for every batch
+  Store instrumented = Store::create();
+  instrumented.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (EntityId id{0}; id < numberOfEntities; ++id) {
+    instrumented.insert(id, Properties().set<PropertyId::Timestamp>(static_cast<double>(numberOfEntities - id)));
+  }
+  if (instrumented.enableInstrumentation()) {
+    auto walkedCursor = instrumented.orderedCursor<PropertyId::Timestamp>(SortOrder::Ascending, 10U);
+    std::vector<EntityId> walkedIds;
+    for (auto batch = walkedCursor.next(); !batch.empty(); batch = walkedCursor.next()) {
+      CHECK(batch.size() == 10U);
+      walkedIds.insert(walkedIds.end(), batch.begin(), batch.end());
+    }
+    CHECK(walkedIds.size() == static_cast<size_t>(numberOfEntities));
+    CHECK(std::is_sorted(walkedIds.rbegin(), walkedIds.rend()));
+    CHECK(instrumented.statistics()->scannedEntities == static_cast<uint64_t>(numberOfEntities));
+  }
+}
+
+TEST_CASE("Instrumentation") {
+  using Query = EntityStore::Query;
+  using StoreOperation = EntityStore::StoreOperation;
+  constexpr auto kNumberOfEntities{100};
+  Store store = Store::create();
+  CHECK_FALSE(store.statistics().has_value());
+  auto childBeforeInstrumentation = store.createChild();
+  if constexpr (!EntityStore::kIsInstrumentationEnabled) {
+    CHECK_FALSE(store.enableInstrumentation());
+    CHECK_FALSE(store.statistics().has_value());
+    return;
+  }
+  REQUIRE(store.enableInstrumentation());
+  CHECK_FALSE(store.enableInstrumentation());
+  CHECK_FALSE(childBeforeInstrumentation.statistics().has_value());
+
+  for (EntityId id{0}; id < kNumberOfEntities; ++id) {
+    store.insert(id, Properties().set<PropertyId::Timestamp>(id));
+  }
+  CHECK_FALSE(store.insert(0, Properties()));
+  CHECK(store.contains(1));
+  CHECK(store.tryGet(kNumberOfEntities) == nullptr);
+  CHECK(store.get(2).get<PropertyId::Timestamp>() == 2);
+  auto statistics = store.statistics().value();
+  CHECK(statistics.latency(StoreOperation::Insert).count == kNumberOfEntities + 1);
+  CHECK(statistics.latency(StoreOperation::Read).count == 3U);
+  CHECK(statistics.latency(StoreOperation::Query).count == 0U);
+
+  CHECK(store.query<PropertyId::Timestamp>(5).size() == 1U);
+  statistics = store.statistics().value();
+  CHECK(statistics.latency(StoreOperation::Query).count == 1U);
+  CHECK(statistics.scannedEntities == kNumberOfEntities);
+  CHECK(statistics.matchedEntities == 1U);
+
+  // The chunks of a parallel scan count on their own, but the totals must be the same
+  const EntityStore::QueryExecutor executor(4U, 8U);
+  store.resetStatistics();
+  CHECK(store.rangeQuery<PropertyId::Timestamp>(10, 50, EntityStore::QueryOptions::parallel(executor)).size() == 40U);
+  statistics = store.statistics().value();
+  CHECK(statistics.scannedEntities == kNumberOfEntities);
+  CHECK(statistics.matchedEntities == 40U);
+
+  // The index narrows down the scanned entities
+  store.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  store.resetStatistics();
+  const auto rangeResult = store.rangeQuery<PropertyId::Timestamp>(10, 20);
+  CHECK(store.count<PropertyId::Timestamp>(Query::inRange<PropertyId::Timestamp>(10, 20)) == rangeResult.size());
+  statistics = store.statistics().value();
+  CHECK(statistics.latency(StoreOperation::Query).count == 1U);
+  CHECK(statistics.latency(StoreOperation::Aggregate).count == 1U);
+  CHECK(statistics.latency(StoreOperation::Insert).count == 0U);
+  CHECK(statistics.matchedEntities == 2U * rangeResult.size());
+  CHECK(statistics.scannedEntities < kNumberOfEntities);
+
+  // The child stores inherit the instrumentation
+  store.resetStatistics();
+  auto child = store.createChild();
+  auto grandChild = child.createChild();
+  CHECK_FALSE(grandChild.enableInstrumentation());
+  grandChild.update(1, Properties().set<PropertyId::Timestamp>(-1));
+  child.remove(2);
+  CHECK(grandChild.get(1).get<PropertyId::Timestamp>() == -1);
+  CHECK_FALSE(grandChild.contains(2));
+  CHECK(grandChild.contains(3));
+  statistics = store.statistics().value();
+  CHECK(statistics.traversedLevels.buckets[EntityStore::Log2Histogram::bucketOf(1U)] >= 1U);
+  CHECK(statistics.traversedLevels.buckets[EntityStore::Log2Histogram::bucketOf(2U)] >= 1U);
+  CHECK(statistics.traversedLevels.buckets[EntityStore::Log2Histogram::bucketOf(3U)] >= 1U);
+
+  grandChild.commit();
+  child.commit();
+  statistics = store.statistics().value();
+  CHECK(statistics.latency(StoreOperation::Commit).count == 2U);
+  CHECK(statistics.commitSizes.count == 2U);
+  CHECK(statistics.commitSizes.sum == 3U);
+  CHECK(store.get(1).get<PropertyId::Timestamp>() == -1);
+
+  // The child stores that were created before have their own instrumentation
+  CHECK(childBeforeInstrumentation.enableInstrumentation());
+  CHECK(childBeforeInstrumentation.contains(3));
+  CHECK(childBeforeInstrumentation.statistics()->traversedLevels.count == 1U);
+  CHECK(childBeforeInstrumentation.statistics()->latency(StoreOperation::Read).count == 1U);
+
+  CHECK(statistics.latency(StoreOperation::Read).percentileUpperBound(1.0) >= 1U);
+  CHECK(EntityStore::Log2Histogram{}.percentileUpperBound(0.5) == 0U);
+}
+
+TEST_CASE("Projections") {
+  using Query = EntityStore::Query;
+  using TimestampType = EntityStore::PropertyValueType<PropertyId::Timestamp>;
+  using Pairs = std::vector<std::pair<EntityId, TimestampType>>;
+  constexpr auto kNumberOfEntities{300};
+  constexpr size_t minChunkSize = 32;
+  const EntityStore::QueryExecutor executor(3U, minChunkSize);
+
+  const auto expectedPairs = [](const Store &store, const Query &query) {
+    Pairs pairs;
+    for (const auto id: store.filter(query)) {
+      const auto *valuePtr = store.get(id).tryGet<PropertyId::Timestamp>();
+      if (valuePtr != nullptr) {
+        pairs.emplace_back(id, *valuePtr);
+      }
+    }
+    return pairs;
+  };
+  const std::vector<Query> queries{
+      Query::allOf({}),
+      Query::equal<PropertyId::Title>("Title 1"),
+      Query::inRange<PropertyId::Timestamp>(10, 30),
+  };
+  const auto checkStore = [&](const Store &store) {
+    for (const auto &query: queries) {
+      for (const auto &options:
+           {EntityStore::QueryOptions::sequential(), EntityStore::QueryOptions::parallel(executor)}) {
+        CHECK(store.project<PropertyId::Timestamp>(query, options) == expectedPairs(store, query));
+      }
+    }
+  };
+
+  Store notIndexed = Store::create();
+  Store indexed = Store::create();
+  Store columnar = Store::create(EntityStore::StoreBackend::Columnar);
+  // The transactional store doesn't have inlined aggregate functions, so it is aggregated through IStore::aggregate
+  Store transactional = Store::createTransactional();
+  indexed.createIndex(PropertyId::Title, EntityStore::IndexType::Hash);
+  indexed.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  transactional.createIndex(PropertyId::Timestamp, EntityStore::IndexType::Ordered);
+  for (auto *store: {&notIndexed, &indexed, &columnar, &transactional}) {
+    for (EntityId id{0}; id < kNumberOfEntities; ++id) {
+      Properties properties;
+      properties.set<PropertyId::Title>("Title " + std::to_string(id % 3));
+      if (id % 5 != 0) {
+        properties.set<PropertyId::Timestamp>(static_cast<TimestampType>(id % 50));
+      }
+      store->insert(id, std::move(properties));
+    }
+    checkStore(*store);
+    CHECK(store->project<PropertyId::Description>().empty());
+
+    auto child = store->createChild();
+    child.remove(1);
+    child.update(2, Properties().set<PropertyId::Timestamp>(-1));
+    child.update(5, Properties().set<PropertyId::Timestamp>(20));
+    child.insert(kNumberOfEntities, Properties().set<PropertyId::Timestamp>(25));
+    checkStore(child);
+
+    auto grandChild = child.createChild();
+    grandChild.remove(2);
+    grandChild.update(kNumberOfEntities, Properties().set<PropertyId::Title>("Title 1"));
+    checkStore(grandChild);
+  }
+}
+
+TEST_CASE("ChildUpdatesCommitOnlyTheUpdatedProperties") {
+  using EntityStore::ChangeEvent;
+  using EntityStore::ChangeType;
+
+  Store store = Store::create();
+  store.insert(1, Properties().set<PropertyId::Title>("Title").set<PropertyId::Timestamp>(1));
+  store.insert(2, Properties().set<PropertyId::Title>("Title"));
+  auto subscription = store.subscribe(16);
+
+  auto child = store.createChild();
+  // The reads of the child still see the whole entity
+  const auto *updatedPtr = child.update(1, Properties().set<PropertyId::Description>("Description"));
+  REQUIRE(updatedPtr != nullptr);
+  CHECK(updatedPtr->get<PropertyId::Title>() == std::string_view{"Title"});
+  CHECK(child.update(1, Properties().set<PropertyId::Timestamp>(2)) != nullptr);
+  CHECK(child.get(1).get<PropertyId::Description>() == std::string_view{"Description"});
+
+  auto grandChild = child.createChild();
+  CHECK(grandChild.update(2, Properties().set<PropertyId::Timestamp>(3)) != nullptr);
+  grandChild.commit();
+
+  // The parent is modified after the child updated the entity, but the commit doesn't overwrite the title
+  store.update(1, Properties().set<PropertyId::Title>("New title"));
+  std::vector<ChangeEvent> events;
+  CHECK(subscription->drain(events) == 1U);
+  events.clear();
+
+  child.commit();
+  ChangeEvent::PropertyMask descriptionAndTimestamp;
+  descriptionAndTimestamp.set(EntityStore::asUnderlying(PropertyId::Description));
+  descriptionAndTimestamp.set(EntityStore::asUnderlying(PropertyId::Timestamp));
+  ChangeEvent::PropertyMask timestamp;
+  timestamp.set(EntityStore::asUnderlying(PropertyId::Timestamp));
+  CHECK(subscription->drain(events) == 2U);
+  std::sort(events.begin(), events.end(), [](const auto &lhs, const auto &rhs) { return lhs.id < rhs.id; });
+  CHECK(events == std::vector<ChangeEvent>{
+                      {ChangeType::Updated, 1, descriptionAndTimestamp},
+                      {ChangeType::Updated, 2, timestamp},
+                  });
+  CHECK(store.get(1) == Properties()
+                            .set<PropertyId::Title>("New title")
+                            .set<PropertyId::Description>("Description")
+                            .set<PropertyId::Timestamp>(2));
+  CHECK(store.get(2) == Properties().set<PropertyId::Title>("Title").set<PropertyId::Timestamp>(3));
+}
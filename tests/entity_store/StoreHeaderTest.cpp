@@ -0,0 +1,65 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include "EntityStore/Store.hpp"
+
+// Store.hpp must not depend on the implementations of the stores, so this file includes only Store.hpp. Because of
+// that it also checks that the scans of every query and aggregation of the public API are compiled into the library.
+template <typename T>
+concept IsComplete = requires {
+  sizeof(T);
+};
+
+static_assert(!IsComplete<EntityStore::RootStore>, "Store.hpp must not include the root store");
+static_assert(!IsComplete<EntityStore::NestedStore>, "Store.hpp must not include the nested store");
+#ifdef ROBIN_HOOD_H_INCLUDED
+#error "Store.hpp must not include robin_hood"
+#endif
+
+TEST_CASE("StoreHeader") {
+  using Store = EntityStore::Store;
+  using Properties = EntityStore::Properties;
+  using PropertyId = EntityStore::PropertyId;
+  using EntityIdSet = EntityStore::EntityIdSet;
+  using Query = EntityStore::Query;
+  using SortOrder = EntityStore::SortOrder;
+  static const std::string cStyledString{"C styled"};
+
+  Store store = Store::create();
+  for (EntityStore::EntityId id{0}; id < 4; ++id) {
+    store.insert(id, Properties()
+                         .set<PropertyId::Title>("Title " + std::to_string(id % 2))
+                         .set<PropertyId::Description>("Description " + std::to_string(id))
+                         .set<PropertyId::Timestamp>(static_cast<double>(id))
+                         .set<PropertyId::CStyledString>(cStyledString.c_str()));
+  }
+
+  CHECK(store.query<PropertyId::Title>("Title 1") == EntityIdSet{1, 3});
+  CHECK(store.queryAs<std::string>(PropertyId::Description, std::string{"Description 2"}) == EntityIdSet{2});
+  CHECK(store.query<PropertyId::Timestamp>(3) == EntityIdSet{3});
+  CHECK(store.query<PropertyId::CStyledString>(cStyledString.c_str()).size() == 4U);
+  // The query value cannot be converted to the type of the property, so it is compared by the predicate only
+  CHECK(store.query<PropertyId::CStyledString>(cStyledString).size() == 4U);
+  CHECK(store.rangeQuery<PropertyId::Timestamp>(1, 3) == EntityIdSet{1, 2});
+  CHECK(store.rangeQuery<PropertyId::Title>("Title 0", "Title 1") == EntityIdSet{0, 2});
+
+  const auto titleZero = Query::equal<PropertyId::Title>("Title 0");
+  CHECK(store.count<PropertyId::CStyledString>() == 4U);
+  CHECK(store.count<PropertyId::Timestamp>(titleZero) == 2U);
+  CHECK(store.min<PropertyId::Description>() == "Description 0");
+  CHECK(store.max<PropertyId::Title>() == "Title 1");
+  CHECK(store.sum<PropertyId::Timestamp>(titleZero) == 2.0);
+  CHECK(store.histogram<PropertyId::Timestamp>({0.0, 2.0, 4.0}) == std::vector<size_t>{2U, 2U});
+  CHECK(store.project<PropertyId::Timestamp>(titleZero) ==
+        std::vector<std::pair<EntityStore::EntityId, double>>{{0, 0.0}, {2, 2.0}});
+  CHECK(store.orderBy<PropertyId::Description>(SortOrder::Descending, 1U) == std::vector<EntityStore::EntityId>{3});
+
+  auto cursor = store.cursor(3U);
+  CHECK(cursor.next() == std::vector<EntityStore::EntityId>{0, 1, 2});
+  CHECK(cursor.next() == std::vector<EntityStore::EntityId>{3});
+  CHECK(cursor.isFinished());
+  auto orderedCursor = store.orderedCursor<PropertyId::Timestamp>(SortOrder::Descending, 2U, titleZero);
+  CHECK(orderedCursor.next() == std::vector<EntityStore::EntityId>{2, 0});
+}
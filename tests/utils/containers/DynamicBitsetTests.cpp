@@ -0,0 +1,111 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "utils/containers/DynamicBitset.hpp"
+
+namespace utils::containers::tests {
+
+std::vector<size_t> collectSetBits(const DynamicBitset &bitset) {
+  std::vector<size_t> result;
+  bitset.forEachSetBit([&result](const size_t index) { result.push_back(index); });
+  return result;
+}
+
+TEST_CASE("EmptyDynamicBitset") {
+  DynamicBitset bitset;
+  CHECK(bitset.empty());
+  CHECK(0 == bitset.size());
+  CHECK(0 == bitset.count());
+  CHECK(bitset.none());
+  CHECK(0 == bitset.findFirst());
+  CHECK(collectSetBits(bitset).empty());
+}
+
+TEST_CASE("SetAndReset") {
+  static constexpr size_t kSize = 130;
+  DynamicBitset bitset(kSize);
+  CHECK(kSize == bitset.size());
+  CHECK(bitset.none());
+
+  const std::vector<size_t> indices{0, 1, 63, 64, 65, 127, 128, 129};
+  for (const auto index: indices) {
+    bitset.set(index);
+    CHECK(bitset.test(index));
+  }
+  CHECK(indices.size() == bitset.count());
+  CHECK(indices == collectSetBits(bitset));
+
+  CHECK(0 == bitset.findFirst());
+  CHECK(63 == bitset.findNext(2));
+  CHECK(127 == bitset.findNext(66));
+  CHECK(129 == bitset.findNext(129));
+  CHECK(kSize == bitset.findNext(kSize));
+
+  bitset.reset(63);
+  bitset.set(64, false);
+  CHECK_FALSE(bitset.test(63));
+  CHECK_FALSE(bitset.test(64));
+  CHECK(65 == bitset.findNext(2));
+  CHECK(indices.size() - 2 == bitset.count());
+}
+
+TEST_CASE("Resize") {
+  static constexpr size_t kInitialSize = 10;
+  static constexpr size_t kGrownSize = 100;
+  static constexpr size_t kShrunkSize = 70;
+  DynamicBitset bitset(kInitialSize, true);
+  CHECK(kInitialSize == bitset.count());
+
+  bitset.resize(kGrownSize, true);
+  CHECK(kGrownSize == bitset.count());
+
+  bitset.resize(kShrunkSize);
+  CHECK(kShrunkSize == bitset.count());
+  CHECK(kShrunkSize == bitset.size());
+
+  bitset.resize(kGrownSize);
+  CHECK(kShrunkSize == bitset.count());
+  CHECK(kGrownSize == bitset.findNext(kShrunkSize));
+
+  bitset.pushBack(true);
+  CHECK(kGrownSize + 1 == bitset.size());
+  CHECK(bitset.test(kGrownSize));
+
+  bitset.clear();
+  CHECK(bitset.empty());
+}
+
+TEST_CASE("BitwiseOperations") {
+  static constexpr size_t kSize = 200;
+  DynamicBitset evens(kSize);
+  DynamicBitset thirds(kSize);
+  for (size_t index{0}; index < kSize; ++index) {
+    evens.set(index, index % 2 == 0);
+    thirds.set(index, index % 3 == 0);
+  }
+
+  auto intersection = evens;
+  intersection &= thirds;
+  auto sum = evens;
+  sum |= thirds;
+  auto difference = evens;
+  difference.subtract(thirds);
+
+  for (size_t index{0}; index < kSize; ++index) {
+    CHECK(intersection.test(index) == (index % 6 == 0));
+    CHECK(sum.test(index) == (index % 2 == 0 || index % 3 == 0));
+    CHECK(difference.test(index) == (index % 2 == 0 && index % 3 != 0));
+  }
+
+  DynamicBitset shorter(kSize / 2, true);
+  auto truncated = evens;
+  truncated &= shorter;
+  CHECK(kSize == truncated.size());
+  CHECK(kSize / 4 == truncated.count());
+
+  CHECK(evens == evens);
+  CHECK_FALSE(evens == thirds);
+}
+
+} // namespace utils::containers::tests
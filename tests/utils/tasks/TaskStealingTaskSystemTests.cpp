@@ -0,0 +1,52 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "utils/tasks/TaskStealingTaskSystem.hpp"
+
+namespace utils::tasks::tests {
+
+using TaskSystem = TaskStealingTaskSystem<2>;
+
+TEST_CASE("RunAndWait") {
+  for (const auto numberOfThreads: {0U, 1U, 4U}) {
+    TaskSystem taskSystem(numberOfThreads);
+    CHECK(taskSystem.numberOfThreads() >= 1U);
+    static constexpr size_t kNumberOfTasks = 1000;
+    std::vector<int> results(kNumberOfTasks, 0);
+    taskSystem.runAndWait(kNumberOfTasks, [&results](const size_t taskIndex) { results[taskIndex] += 1; });
+    CHECK(results == std::vector<int>(kNumberOfTasks, 1));
+    taskSystem.runAndWait(0U, [](const size_t /*taskIndex*/) { FAIL("No task should be run"); });
+  }
+}
+
+TEST_CASE("Async") {
+  std::atomic<int> counter{0};
+  static constexpr int kNumberOfTasks = 100;
+  {
+    TaskSystem taskSystem(3U);
+    for (int task{0}; task < kNumberOfTasks; ++task) {
+      taskSystem.async([&counter] { ++counter; });
+    }
+    // The destructor waits for the scheduled tasks
+  }
+  CHECK(kNumberOfTasks == counter.load());
+}
+
+TEST_CASE("RunAndWaitRethrows") {
+  TaskSystem taskSystem(2U);
+  std::atomic<int> counter{0};
+  const auto throwingTask = [&counter](const size_t taskIndex) {
+    ++counter;
+    if (taskIndex % 2 == 1) {
+      throw std::runtime_error("Odd task");
+    }
+  };
+  CHECK_THROWS_AS(taskSystem.runAndWait(10U, throwingTask), std::runtime_error);
+  // Every task is finished before the exception is rethrown
+  CHECK(10 == counter.load());
+}
+
+} // namespace utils::tasks::tests